@@ -84,4 +84,34 @@ static void CCoinsCaching(benchmark::State& state)
     }
 }
 
+// Fill a cache the way connecting blocks does, then flush it to the parent.
+static void CCoinsCachingFlush(benchmark::State& state)
+{
+    CCoinsView coinsDummy;
+    CCoinsViewCache coinsBase(&coinsDummy);
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(10);
+    for (CTxOut& out : tx.vout) {
+        out.nValue = CENT;
+        out.scriptPubKey << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+    }
+
+    uint32_t nLockTime = 0;
+    while (state.KeepRunning()) {
+        CCoinsViewCache coins(&coinsBase);
+        for (int i = 0; i < 100; i++) {
+            tx.nLockTime = nLockTime++;
+            AddCoins(coins, tx, 1);
+        }
+        bool success = coins.Flush();
+        assert(success);
+        if (coinsBase.GetCacheSize() > 100000) {
+            coinsBase.Flush();
+        }
+    }
+}
+
 BENCHMARK(CCoinsCaching, 170 * 1000);
+BENCHMARK(CCoinsCachingFlush, 200);
@@ -8,6 +8,8 @@
 #include <validation.h>
 #include <streams.h>
 #include <consensus/validation.h>
+#include <script/sigcache.h>
+#include <script/standard.h>
 
 namespace block_bench {
 #include <bench/data/block413567.raw.h>
@@ -52,5 +54,64 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
     }
 }
 
+// Signature checks of the block. We don't have the outputs it spends, but for
+// P2PKH inputs the scriptPubKey follows from the public key in the scriptSig,
+// and the amount isn't signed before segwit. block413567 is a mainchain block,
+// so it has the mainchain header.
+static void CheckBlockScripts(benchmark::State& state, bool fBatch)
+{
+    CDataStream stream((const char*)block_bench::block413567,
+            (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CMainchainBlock block;
+    stream >> block;
+
+    InitSignatureCache();
+
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG | SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
+    std::vector<PrecomputedTransactionData> vTxData;
+    vTxData.reserve(block.vtx.size());
+    std::vector<CScriptCheck> vChecks;
+    for (const auto& tx : block.vtx) {
+        vTxData.emplace_back(*tx);
+        if (tx->IsCoinBase())
+            continue;
+        for (unsigned int i = 0; i < tx->vin.size(); i++) {
+            const CScript& scriptSig = tx->vin[i].scriptSig;
+            CScript::const_iterator pc = scriptSig.begin();
+            opcodetype opcode;
+            std::vector<unsigned char> vchSig, vchPubKey;
+            if (!scriptSig.GetOp(pc, opcode, vchSig) || !scriptSig.GetOp(pc, opcode, vchPubKey) || pc != scriptSig.end())
+                continue;
+            CPubKey pubkey(vchPubKey);
+            if (!pubkey.IsFullyValid())
+                continue;
+            vChecks.emplace_back(CTxOut(0, GetScriptForDestination(pubkey.GetID())), *tx, i, flags, false, &vTxData.back());
+        }
+    }
+    assert(!vChecks.empty());
+
+    while (state.KeepRunning()) {
+        if (fBatch) {
+            assert(RunChecks(vChecks));
+        } else {
+            for (CScriptCheck& check : vChecks)
+                assert(check());
+        }
+    }
+}
+
+static void CheckBlockScriptsTest(benchmark::State& state)
+{
+    CheckBlockScripts(state, false);
+}
+
+static void CheckBlockScriptsBatchTest(benchmark::State& state)
+{
+    CheckBlockScripts(state, true);
+}
+
 BENCHMARK(DeserializeBlockTest, 130);
 BENCHMARK(DeserializeAndCheckBlockTest, 160);
+BENCHMARK(CheckBlockScriptsTest, 1);
+BENCHMARK(CheckBlockScriptsBatchTest, 1);
@@ -0,0 +1,92 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <txdb.h>
+#include <util.h>
+#include <validation.h>
+
+#include <boost/thread/thread.hpp>
+
+// Number of coins in the database
+static const int PREFETCH_DB_COINS = 20000;
+
+// Number of them a block spends
+static const int PREFETCH_BLOCK_INPUTS = 2000;
+
+// Threads reading coins when prefetching, like the default of
+// -coinprefetchthreads used to be
+static const int PREFETCH_THREADS = 4;
+
+// Spend the inputs of a block through a coins cache on top of a database
+// opened fresh for every block, the way ConnectBlock does, optionally reading
+// the spent coins on the coin prefetch threads first.
+static void CoinsConnectBlockCold(benchmark::State& state, int nThreads)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    ClearDatadirCache();
+    fs::path pathTemp = fs::temp_directory_path() / strprintf("bench_bitcoin_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+    fs::create_directories(pathTemp);
+    gArgs.ForceSetArg("-datadir", pathTemp.string());
+
+    FastRandomContext rand(true);
+    CBlock block;
+    {
+        CCoinsViewDB db(1 << 20, false, true);
+        CCoinsViewCache cache(&db);
+        std::vector<COutPoint> vOutPoint;
+        for (int i = 0; i < PREFETCH_DB_COINS; i++) {
+            COutPoint outpoint(rand.rand256(), 0);
+            CScript scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+            cache.AddCoin(outpoint, Coin(CTxOut(CENT, scriptPubKey), 1, false), false);
+            vOutPoint.push_back(outpoint);
+        }
+        cache.SetBestBlock(rand.rand256());
+        bool fOk = cache.Flush();
+        assert(fOk);
+
+        CMutableTransaction mtx;
+        mtx.vout.resize(1);
+        for (int i = 0; i < PREFETCH_BLOCK_INPUTS; i++)
+            mtx.vin.emplace_back(vOutPoint[i * (PREFETCH_DB_COINS / PREFETCH_BLOCK_INPUTS)]);
+        block.vtx.push_back(MakeTransactionRef(CMutableTransaction()));
+        block.vtx.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nThreads; i++)
+        threadGroup.create_thread(&ThreadCoinPrefetch);
+
+    while (state.KeepRunning()) {
+        CCoinsViewDB db(1 << 20, false, false);
+        CCoinsViewCache cache(&db);
+        if (nThreads)
+            PrefetchCoins(block, cache, db);
+        for (const CTxIn& txin : block.vtx[1]->vin) {
+            bool fSpent = cache.SpendCoin(txin.prevout);
+            assert(fSpent);
+        }
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    fs::remove_all(pathTemp);
+}
+
+static void CoinsConnectBlockColdSerial(benchmark::State& state)
+{
+    CoinsConnectBlockCold(state, 0);
+}
+
+static void CoinsConnectBlockColdPrefetch(benchmark::State& state)
+{
+    CoinsConnectBlockCold(state, PREFETCH_THREADS);
+}
+
+BENCHMARK(CoinsConnectBlockColdSerial, 20);
+BENCHMARK(CoinsConnectBlockColdPrefetch, 20);
@@ -113,4 +113,49 @@ static void MempoolEviction(benchmark::State& state)
     }
 }
 
+// Evict packages from a mempool of overlapping transaction trees, where each
+// eviction walks the descendants of the package and the ancestors of every
+// transaction removed.
+static void MempoolEvictionTrees(benchmark::State& state)
+{
+    // Every transaction in a tree spends an output of each of the previous
+    // two, up to the ancestor limit
+    const int nTrees = 50;
+    const int nTreeSize = 25;
+    std::vector<CTransaction> vTx;
+    std::vector<CAmount> vFee;
+    for (int t = 0; t < nTrees; t++) {
+        size_t nRoot = vTx.size();
+        for (int i = 0; i < nTreeSize; i++) {
+            CMutableTransaction tx;
+            if (i < 2) {
+                tx.vin.resize(1);
+                tx.vin[0].prevout = i ? COutPoint(vTx[nRoot].GetHash(), 1) : COutPoint(uint256(), t);
+            } else {
+                tx.vin.resize(2);
+                tx.vin[0].prevout = COutPoint(vTx[vTx.size() - 2].GetHash(), 0);
+                tx.vin[1].prevout = COutPoint(vTx[vTx.size() - 1].GetHash(), 1);
+            }
+            tx.vin[0].scriptSig = CScript() << t << i;
+            tx.vout.resize(2);
+            tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            tx.vout[0].nValue = 10 * COIN;
+            tx.vout[1].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            tx.vout[1].nValue = 10 * COIN;
+            vTx.push_back(tx);
+            vFee.push_back(1000 + (t * 37 + i * 11) % 500);
+        }
+    }
+
+    CTxMemPool pool;
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < vTx.size(); i++)
+            AddTx(vTx[i], vFee[i], pool);
+        pool.TrimToSize(pool.DynamicMemoryUsage() / 2);
+        pool.TrimToSize(0);
+    }
+}
+
 BENCHMARK(MempoolEviction, 41000);
+BENCHMARK(MempoolEvictionTrees, 20);
@@ -0,0 +1,90 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <txmempool.h>
+
+#include <vector>
+
+// Number of transaction chains in the disconnected block
+static const int BENCH_REORG_CHAINS = 10;
+
+// Length of each chain, the default ancestor limit
+static const int BENCH_REORG_CHAIN_LENGTH = 25;
+
+// Number of in-mempool descendants hanging off each pair of block transactions
+static const int BENCH_REORG_DESCENDANTS = 4;
+
+static void AddTx(const CTransactionRef& tx, CTxMemPool& pool)
+{
+    LockPoints lp;
+    pool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(tx, 1000, 0, 1, false, false, uint256(), 4, lp));
+}
+
+static CTransactionRef MakeTx(const std::vector<COutPoint>& vPrevout, int n)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(vPrevout.size());
+    for (size_t i = 0; i < vPrevout.size(); i++) {
+        tx.vin[i].prevout = vPrevout[i];
+        tx.vin[i].scriptSig = CScript() << n;
+    }
+    tx.vout.resize(2);
+    for (CTxOut& out : tx.vout) {
+        out.scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        out.nValue = COIN;
+    }
+    return MakeTransactionRef(tx);
+}
+
+// Re-add the transactions of a disconnected block to a mempool that already
+// holds their descendants, the way UpdateMempoolForReorg does when a mainchain
+// reorg orphans sidechain blocks. The block holds chains of transactions, and
+// each pair of neighbouring block transactions is spent by a chain of mempool
+// transactions, so descendants are shared between block transactions.
+static void MempoolReorg(benchmark::State& state)
+{
+    std::vector<CTransactionRef> vBlockTx;
+    std::vector<CTransactionRef> vMempoolTx;
+    int n = 0;
+    for (int c = 0; c < BENCH_REORG_CHAINS; c++) {
+        for (int i = 0; i < BENCH_REORG_CHAIN_LENGTH; i++) {
+            std::vector<COutPoint> vPrevout;
+            if (i)
+                vPrevout.emplace_back(vBlockTx.back()->GetHash(), 0);
+            else
+                vPrevout.emplace_back(uint256(), n);
+            vBlockTx.push_back(MakeTx(vPrevout, n++));
+
+            if (!i)
+                continue;
+
+            // Spend both block transactions of the pair, then chain on
+            std::vector<COutPoint> vPair;
+            vPair.emplace_back(vBlockTx[vBlockTx.size() - 2]->GetHash(), 1);
+            vPair.emplace_back(vBlockTx.back()->GetHash(), 1);
+            vMempoolTx.push_back(MakeTx(vPair, n++));
+            for (int d = 1; d < BENCH_REORG_DESCENDANTS; d++) {
+                std::vector<COutPoint> vChild(1, COutPoint(vMempoolTx.back()->GetHash(), 0));
+                vMempoolTx.push_back(MakeTx(vChild, n++));
+            }
+        }
+    }
+
+    std::vector<uint256> vHashUpdate;
+    for (const CTransactionRef& tx : vBlockTx)
+        vHashUpdate.push_back(tx->GetHash());
+
+    while (state.KeepRunning()) {
+        CTxMemPool pool;
+        for (const CTransactionRef& tx : vMempoolTx)
+            AddTx(tx, pool);
+        for (const CTransactionRef& tx : vBlockTx)
+            AddTx(tx, pool);
+        pool.UpdateTransactionsFromBlock(vHashUpdate);
+        assert(pool.size() == vBlockTx.size() + vMempoolTx.size());
+    }
+}
+
+BENCHMARK(MempoolReorg, 10);
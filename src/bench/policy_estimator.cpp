@@ -0,0 +1,57 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/fees.h>
+#include <txmempool.h>
+
+#include <vector>
+
+// Number of transactions in each block
+static const int BENCH_BLOCK_TXS = 10000;
+
+// Number of blocks the estimator processes per iteration
+static const int BENCH_BLOCKS = 5;
+
+// Track BENCH_BLOCK_TXS transactions per block with a spread of feerates,
+// then process the block confirming them. A fresh estimator is used for each
+// iteration so the mempool entries can be reused at the same heights.
+static void PolicyEstimatorProcessBlock(benchmark::State& state)
+{
+    std::vector<std::vector<CTxMemPoolEntry>> vEntry(BENCH_BLOCKS);
+    for (int nHeight = 0; nHeight < BENCH_BLOCKS; nHeight++) {
+        vEntry[nHeight].reserve(BENCH_BLOCK_TXS);
+        for (int i = 0; i < BENCH_BLOCK_TXS; i++) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].scriptSig = CScript() << nHeight << i;
+            tx.vout.resize(1);
+            tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            tx.vout[0].nValue = COIN;
+
+            // Feerates from 1 to 1000 sat/byte
+            CAmount nFee = (i % 1000 + 1) * 100;
+            vEntry[nHeight].emplace_back(MakeTransactionRef(tx), nFee, 0, nHeight,
+                                         false, false, uint256(), 4, LockPoints());
+        }
+    }
+
+    std::vector<std::vector<const CTxMemPoolEntry*>> vBlock(BENCH_BLOCKS);
+    for (int nHeight = 0; nHeight < BENCH_BLOCKS; nHeight++) {
+        for (const CTxMemPoolEntry& entry : vEntry[nHeight])
+            vBlock[nHeight].push_back(&entry);
+    }
+
+    while (state.KeepRunning()) {
+        CBlockPolicyEstimator estimator;
+        for (int nHeight = 0; nHeight < BENCH_BLOCKS; nHeight++) {
+            for (const CTxMemPoolEntry& entry : vEntry[nHeight])
+                estimator.processTransaction(entry, true);
+            estimator.processBlock(nHeight + 1, vBlock[nHeight]);
+        }
+        assert(estimator.GetBestSeenHeight() == BENCH_BLOCKS);
+    }
+}
+
+BENCHMARK(PolicyEstimatorProcessBlock, 5);
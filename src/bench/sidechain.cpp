@@ -0,0 +1,464 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <arith_uint256.h>
+#include <base58.h>
+#include <bmmcache.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <key.h>
+#include <miner.h>
+#include <scheduler.h>
+#include <script/interpreter.h>
+#include <script/sigcache.h>
+#include <sidechain.h>
+#include <sidechainclient.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <test/mainchainmock.h>
+
+#include <boost/thread.hpp>
+
+// Number of deposits the sidechain downloads in the deposit benchmark
+static const int BENCH_DEPOSITS = 100;
+
+// Number of withdrawals in the sidechain db for the bundle benchmark
+static const int BENCH_WITHDRAWALS = 1000;
+
+// Number of mempool transactions for the block template benchmarks, every
+// other one makes a withdrawal
+static const int BENCH_TEMPLATE_TXS = 2000;
+
+// Number of transactions that arrive in the mempool between two refreshes of
+// the block template
+static const int BENCH_TEMPLATE_NEW_TXS = 10;
+
+// Number of signed transactions in the saved mempool for the load benchmarks,
+// half of them spend the other half
+static const int BENCH_MEMPOOL_LOAD_TXS = 2000;
+
+// Round trip time of a mainchain request, like a local node over loopback
+static const int64_t BENCH_MAINCHAIN_LATENCY = 100;
+
+/**
+ * Chain state for connecting sidechain blocks, set up like the unit tests'
+ * TestingSetup but on a regtest chain with BMM verified by the mock
+ * mainchain.
+ */
+class SidechainBenchSetup
+{
+public:
+    SidechainBenchSetup()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        InitSignatureCache();
+        InitScriptExecutionCache();
+        InitRefundCache();
+
+        ClearDatadirCache();
+        pathTemp = fs::temp_directory_path() / strprintf("bench_bitcoin_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+        fs::create_directories(pathTemp);
+        gArgs.ForceSetArg("-datadir", pathTemp.string());
+
+        threadGroup.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+        GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+
+        pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+        pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        psidechaintree.reset(new CSidechainTreeDB(1 << 20, true));
+        pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        bmmCache.ResetMainBlockCache();
+
+        const CChainParams& chainparams = Params();
+        CValidationState state;
+        bool fOk = LoadGenesisBlock(chainparams) && ActivateBestChain(state, chainparams);
+        assert(fOk);
+    }
+
+    ~SidechainBenchSetup()
+    {
+        threadGroup.interrupt_all();
+        threadGroup.join_all();
+        GetMainSignals().FlushBackgroundCallbacks();
+        GetMainSignals().UnregisterBackgroundSignalScheduler();
+        UnloadBlockIndex();
+        pcoinsTip.reset();
+        pcoinsdbview.reset();
+        pblocktree.reset();
+        psidechaintree.reset();
+        bmmCache.ResetMainBlockCache();
+        bmmCache.ClearBMMBlocks();
+        fs::remove_all(pathTemp);
+    }
+
+private:
+    fs::path pathTemp;
+    CScheduler scheduler;
+    boost::thread_group threadGroup;
+};
+
+// Connect a sidechain block per iteration: the BMM block is committed in a
+// new mainchain block, then RefreshBMM finds the commitment and submits the
+// block, which is fully validated against the mainchain.
+static void SidechainRefreshBMM(benchmark::State& state)
+{
+    SidechainBenchSetup setup;
+    MockMainchain mainchain(BENCH_MAINCHAIN_LATENCY);
+
+    const CScript scriptPubKey = CScript() << OP_TRUE;
+    SidechainClient client;
+
+    bool fReorg = false;
+    std::vector<uint256> vOrphan;
+    bool fOk = UpdateMainBlockHashCache(fReorg, vOrphan);
+    assert(fOk);
+
+    while (state.KeepRunning()) {
+        CBlock block;
+        std::string strError;
+        fOk = BlockAssembler(Params()).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey);
+        assert(fOk);
+        bmmCache.StoreBMMBlock(block);
+
+        mainchain.AddBMMCommit(block.hashMerkleRoot);
+        mainchain.Mine();
+        fOk = UpdateMainBlockHashCache(fReorg, vOrphan);
+        assert(fOk);
+
+        uint256 hashCreatedMerkleRoot;
+        uint256 hashConnected;
+        uint256 hashConnectedMerkleRoot;
+        uint256 txid;
+        int nTxn = 0;
+        CAmount nFees = 0;
+        fOk = client.RefreshBMM(CAmount(0), strError, hashCreatedMerkleRoot, hashConnected, hashConnectedMerkleRoot, txid, nTxn, nFees, false /* fCreateNew */);
+        assert(fOk);
+        assert(hashConnectedMerkleRoot == block.hashMerkleRoot);
+    }
+}
+
+// Download the deposits from the mainchain and sort them by CTIP spend
+// order, like the miner and the deposit sync do.
+static void SidechainDepositIngest(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    MockMainchain mainchain(BENCH_MAINCHAIN_LATENCY);
+    for (int i = 0; i < BENCH_DEPOSITS; i++) {
+        mainchain.AddDeposit("bench" + std::to_string(i), COIN);
+        if (i % 10 == 9)
+            mainchain.Mine();
+    }
+
+    SidechainClient client;
+    while (state.KeepRunning()) {
+        std::vector<SidechainDeposit> vDeposit = client.UpdateDeposits(uint256(), 0);
+        assert(vDeposit.size() == BENCH_DEPOSITS);
+
+        std::vector<SidechainDeposit> vDepositSorted;
+        bool fOk = SortDeposits(vDeposit, vDepositSorted);
+        assert(fOk);
+
+        for (const SidechainDeposit& deposit : vDepositSorted) {
+            fOk = client.VerifyDeposit(deposit.hashMainchainBlock, deposit.dtx->GetHash(), deposit.nTx);
+            assert(fOk);
+        }
+    }
+}
+
+// Build a withdrawal bundle from the withdrawals in the sidechain db
+static void SidechainWithdrawalBundle(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    MockMainchain mainchain(BENCH_MAINCHAIN_LATENCY);
+
+    std::unique_ptr<CSidechainTreeDB> psidechaintreeOld(psidechaintree.release());
+    psidechaintree.reset(new CSidechainTreeDB(1 << 20, true));
+
+    const std::vector<unsigned char>& vchPrefix = Params().Base58Prefix(CChainParams::MAINCHAIN_PUBKEY_ADDRESS);
+    std::vector<SidechainWithdrawal> vWithdrawal(BENCH_WITHDRAWALS);
+    std::vector<std::pair<uint256, const SidechainObj*>> vObj;
+    for (int i = 0; i < BENCH_WITHDRAWALS; i++) {
+        std::vector<unsigned char> vchDest(vchPrefix);
+        uint160 hash = Hash160(std::vector<unsigned char>(1, i % 256));
+        vchDest.insert(vchDest.end(), hash.begin(), hash.end());
+
+        SidechainWithdrawal& withdrawal = vWithdrawal[i];
+        withdrawal.nSidechain = THIS_SIDECHAIN;
+        withdrawal.strDestination = EncodeBase58Check(vchDest);
+        withdrawal.strRefundDestination = withdrawal.strDestination;
+        withdrawal.amount = COIN + i;
+        withdrawal.mainchainFee = (i % 100) * 1000;
+        withdrawal.hashBlindTx = GetRandHash();
+        vObj.push_back(std::make_pair(withdrawal.GetID(), &withdrawal));
+    }
+    bool fOk = psidechaintree->WriteSidechainIndex(vObj);
+    assert(fOk);
+
+    while (state.KeepRunning()) {
+        CTransactionRef withdrawalBundleTx;
+        CTransactionRef withdrawalBundleDataTx;
+        fOk = CreateWithdrawalBundleTx(1, withdrawalBundleTx, withdrawalBundleDataTx);
+        assert(fOk);
+    }
+
+    psidechaintree.reset(psidechaintreeOld.release());
+}
+
+// Build a block template from a mempool that doesn't fit in the block. Half
+// of the transactions are spam paying a high fee, the others make withdrawals
+// paying a low fee but a high mainchain fee. The block has room for all of
+// the spam.
+static void SidechainBlockTemplate(benchmark::State& state, bool fMainchainFeeScore)
+{
+    SidechainBenchSetup setup;
+    MockMainchain mainchain(BENCH_MAINCHAIN_LATENCY);
+
+    bool fReorg = false;
+    std::vector<uint256> vOrphan;
+    bool fOk = UpdateMainBlockHashCache(fReorg, vOrphan);
+    assert(fOk);
+
+    // The transactions spend outputs that are added to the coins cache
+    // directly, so the template passes validation without a funded chain
+    const CScript scriptTrue = CScript() << OP_TRUE;
+    int64_t nSpamWeight = 0;
+    {
+        LOCK2(cs_main, mempool.cs);
+        for (int i = 0; i < BENCH_TEMPLATE_TXS; i++) {
+            const COutPoint prevout(ArithToUint256(arith_uint256(i + 1)), 0);
+            pcoinsTip->AddCoin(prevout, Coin(CTxOut(10 * COIN, scriptTrue), 1, false), false);
+
+            CMutableTransaction mtx;
+            mtx.vin.resize(1);
+            mtx.vin[0].prevout = prevout;
+            CAmount nFee = 10000;
+            CAmount nChange = 10 * COIN - nFee;
+            if (i % 2) {
+                SidechainWithdrawal withdrawal;
+                withdrawal.nSidechain = THIS_SIDECHAIN;
+                withdrawal.strDestination = "bench" + std::to_string(i);
+                withdrawal.strRefundDestination = withdrawal.strDestination;
+                withdrawal.amount = COIN;
+                withdrawal.mainchainFee = 100000;
+                withdrawal.hashBlindTx = GetRandHash();
+                mtx.vout.push_back(CTxOut(withdrawal.amount, CScript() << OP_RETURN));
+                mtx.vout.push_back(CTxOut(CAmount(0), withdrawal.GetScript()));
+                nFee = 1000;
+                nChange = 10 * COIN - withdrawal.amount - nFee;
+            }
+            mtx.vout.push_back(CTxOut(nChange, scriptTrue));
+
+            CTransactionRef tx = MakeTransactionRef(std::move(mtx));
+            if (i % 2 == 0)
+                nSpamWeight += GetTransactionWeight(*tx);
+            mempool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(tx, nFee, GetTime(), 0, false, false, uint256(), 4, LockPoints()));
+        }
+    }
+
+    BlockAssembler::Options options;
+    // The coinbase reserves 4000, the rest is the spam and less than a
+    // withdrawal
+    options.nBlockMaxWeight = nSpamWeight + 4000 + 100;
+    options.fMainchainFeeScore = fMainchainFeeScore;
+
+    int nSpam = 0;
+    int nWithdrawal = 0;
+    while (state.KeepRunning()) {
+        // The block is full, so once the mempool changed the template is
+        // selected from the whole mempool again
+        mempool.AddTransactionsUpdated(1);
+
+        CBlock block;
+        std::string strError;
+        fOk = BlockAssembler(Params(), options).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptTrue);
+        assert(fOk);
+
+        nSpam = 0;
+        nWithdrawal = 0;
+        for (const CTransactionRef& tx : block.vtx) {
+            if (tx->IsCoinBase())
+                continue;
+            if (tx->vout.size() == 1)
+                nSpam++;
+            else
+                nWithdrawal++;
+        }
+    }
+
+    // Ranked by sidechain fees only, the spam fills the block. Counting
+    // mainchain fees, the withdrawals do.
+    if (fMainchainFeeScore)
+        assert(nWithdrawal > nSpam);
+    else
+        assert(nSpam == BENCH_TEMPLATE_TXS / 2 && nWithdrawal == 0);
+
+    mempool.clear();
+}
+
+static void SidechainBlockTemplateFee(benchmark::State& state)
+{
+    SidechainBlockTemplate(state, false);
+}
+
+static void SidechainBlockTemplateMainchainFee(benchmark::State& state)
+{
+    SidechainBlockTemplate(state, true);
+}
+
+// Add a transaction to the mempool, spending an output that is added to the
+// coins cache directly
+static void AddTemplateTx(int n)
+{
+    const CScript scriptTrue = CScript() << OP_TRUE;
+    const COutPoint prevout(ArithToUint256(arith_uint256(n + 1)), 0);
+    pcoinsTip->AddCoin(prevout, Coin(CTxOut(10 * COIN, scriptTrue), 1, false), false);
+
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = prevout;
+    CAmount nFee = 10000 + n % 1000;
+    mtx.vout.push_back(CTxOut(10 * COIN - nFee, scriptTrue));
+
+    CTransactionRef tx = MakeTransactionRef(std::move(mtx));
+    mempool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(tx, nFee, GetTime(), 0, false, false, uint256(), 4, LockPoints()));
+}
+
+// Refresh the template of a BMM block on the same tip, like repeated
+// refreshbmm calls, while nNewTx transactions arrive in the mempool between
+// refreshes. The block has room for all of them, so the last template is
+// patched with the new transactions.
+static void SidechainBlockTemplateRefresh(benchmark::State& state, int nNewTx)
+{
+    SidechainBenchSetup setup;
+    MockMainchain mainchain(BENCH_MAINCHAIN_LATENCY);
+
+    bool fReorg = false;
+    std::vector<uint256> vOrphan;
+    bool fOk = UpdateMainBlockHashCache(fReorg, vOrphan);
+    assert(fOk);
+
+    int n = 0;
+    {
+        LOCK2(cs_main, mempool.cs);
+        for (; n < BENCH_TEMPLATE_TXS; n++)
+            AddTemplateTx(n);
+    }
+
+    const CScript scriptTrue = CScript() << OP_TRUE;
+    CBlock block;
+    std::string strError;
+    fOk = BlockAssembler(Params()).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptTrue);
+    assert(fOk);
+
+    while (state.KeepRunning()) {
+        {
+            LOCK2(cs_main, mempool.cs);
+            for (int i = 0; i < nNewTx; i++, n++)
+                AddTemplateTx(n);
+        }
+
+        fOk = BlockAssembler(Params()).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptTrue);
+        assert(fOk);
+        assert(block.vtx.size() == (size_t)n + 1);
+    }
+
+    mempool.clear();
+}
+
+static void SidechainBlockTemplateRefreshUnchanged(benchmark::State& state)
+{
+    SidechainBlockTemplateRefresh(state, 0);
+}
+
+static void SidechainBlockTemplateRefreshNewTxs(benchmark::State& state)
+{
+    SidechainBlockTemplateRefresh(state, BENCH_TEMPLATE_NEW_TXS);
+}
+
+// Load a saved mempool of signed transactions, with the signature caches
+// emptied before each load as on startup. With script check threads the
+// signatures of each batch are verified in parallel before it is accepted.
+static void MempoolLoad(benchmark::State& state, int nThreads)
+{
+    SidechainBenchSetup setup;
+
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+
+    // Sign a spend of a P2PK output, paying to the same key
+    auto spend = [&key, &scriptPubKey](const COutPoint& prevout, CAmount nValue) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout = prevout;
+        mtx.vout.push_back(CTxOut(nValue - 10000, scriptPubKey));
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, mtx, 0, SIGHASH_ALL, nValue, SIGVERSION_BASE);
+        bool fSigned = key.Sign(hash, vchSig);
+        assert(fSigned);
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        mtx.vin[0].scriptSig << vchSig;
+        return MakeTransactionRef(std::move(mtx));
+    };
+
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < BENCH_MEMPOOL_LOAD_TXS / 2; i++) {
+            const COutPoint prevout(ArithToUint256(arith_uint256(i + 1)), 0);
+            pcoinsTip->AddCoin(prevout, Coin(CTxOut(10 * COIN, scriptPubKey), 1, false), false);
+
+            CTransactionRef tx = spend(prevout, 10 * COIN);
+            CTransactionRef txChild = spend(COutPoint(tx->GetHash(), 0), tx->vout[0].nValue);
+            for (const CTransactionRef& ptx : {tx, txChild}) {
+                CValidationState validationState;
+                bool fAccepted = AcceptToMemoryPool(mempool, validationState, ptx, nullptr, nullptr, false, 0);
+                assert(fAccepted);
+            }
+        }
+    }
+    bool fOk = DumpMempool();
+    assert(fOk);
+
+    boost::thread_group threadGroup;
+    nScriptCheckThreads = nThreads;
+    for (int i = 0; i < nThreads - 1; i++)
+        threadGroup.create_thread(&ThreadScriptCheck);
+
+    while (state.KeepRunning()) {
+        mempool.clear();
+        InitSignatureCache();
+        InitScriptExecutionCache();
+        fOk = LoadMempool();
+        assert(fOk && mempool.size() == (size_t)BENCH_MEMPOOL_LOAD_TXS);
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    nScriptCheckThreads = 0;
+    mempool.clear();
+}
+
+static void MempoolLoadSerial(benchmark::State& state)
+{
+    MempoolLoad(state, 0);
+}
+
+static void MempoolLoadParallel(benchmark::State& state)
+{
+    MempoolLoad(state, 4);
+}
+
+BENCHMARK(SidechainRefreshBMM, 50);
+BENCHMARK(SidechainDepositIngest, 20);
+BENCHMARK(SidechainWithdrawalBundle, 100);
+BENCHMARK(SidechainBlockTemplateFee, 20);
+BENCHMARK(SidechainBlockTemplateMainchainFee, 20);
+BENCHMARK(SidechainBlockTemplateRefreshUnchanged, 20);
+BENCHMARK(SidechainBlockTemplateRefreshNewTxs, 20);
+BENCHMARK(MempoolLoadSerial, 5);
+BENCHMARK(MempoolLoadParallel, 5);
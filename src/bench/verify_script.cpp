@@ -48,9 +48,11 @@ static CMutableTransaction BuildSpendingTransaction(const CScript& scriptSig, co
     return txSpend;
 }
 
-// Microbenchmark for verification of a basic P2WPKH script. Can be easily
-// modified to measure performance of other types of scripts.
-static void VerifyScriptBench(benchmark::State& state)
+// Microbenchmark for verification of a basic P2WPKH or P2PKH script. Can be
+// easily modified to measure performance of other types of scripts. fGeneric
+// skips the standard template fast paths in VerifyScript to compare them with
+// the generic interpreter.
+static void BenchVerifyScript(benchmark::State& state, bool fWitness, bool fGeneric)
 {
     const int flags = SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_P2SH;
     const int witnessversion = 0;
@@ -68,21 +70,26 @@ static void VerifyScriptBench(benchmark::State& state)
     CHash160().Write(pubkey.begin(), pubkey.size()).Finalize(pubkeyHash.begin());
 
     // Script.
-    CScript scriptPubKey = CScript() << witnessversion << ToByteVector(pubkeyHash);
-    CScript scriptSig;
     CScript witScriptPubkey = CScript() << OP_DUP << OP_HASH160 << ToByteVector(pubkeyHash) << OP_EQUALVERIFY << OP_CHECKSIG;
+    CScript scriptPubKey = fWitness ? CScript() << witnessversion << ToByteVector(pubkeyHash) : witScriptPubkey;
+    CScript scriptSig;
     CTransaction txCredit = BuildCreditingTransaction(scriptPubKey);
     CMutableTransaction txSpend = BuildSpendingTransaction(scriptSig, txCredit);
-    CScriptWitness& witness = txSpend.vin[0].scriptWitness;
-    witness.stack.emplace_back();
-    key.Sign(SignatureHash(witScriptPubkey, txSpend, 0, SIGHASH_ALL, txCredit.vout[0].nValue, SIGVERSION_WITNESS_V0), witness.stack.back(), 0);
-    witness.stack.back().push_back(static_cast<unsigned char>(SIGHASH_ALL));
-    witness.stack.push_back(ToByteVector(pubkey));
+    std::vector<unsigned char> vchSig;
+    key.Sign(SignatureHash(witScriptPubkey, txSpend, 0, SIGHASH_ALL, txCredit.vout[0].nValue, fWitness ? SIGVERSION_WITNESS_V0 : SIGVERSION_BASE), vchSig, 0);
+    vchSig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+    if (fWitness) {
+        CScriptWitness& witness = txSpend.vin[0].scriptWitness;
+        witness.stack.push_back(vchSig);
+        witness.stack.push_back(ToByteVector(pubkey));
+    } else {
+        txSpend.vin[0].scriptSig = CScript() << vchSig << ToByteVector(pubkey);
+    }
 
     // Benchmark.
     while (state.KeepRunning()) {
         ScriptError err;
-        bool success = VerifyScript(
+        bool success = (fGeneric ? VerifyScriptGeneric : VerifyScript)(
             txSpend.vin[0].scriptSig,
             txCredit.vout[0].scriptPubKey,
             &txSpend.vin[0].scriptWitness,
@@ -105,4 +112,27 @@ static void VerifyScriptBench(benchmark::State& state)
     }
 }
 
+static void VerifyScriptBench(benchmark::State& state)
+{
+    BenchVerifyScript(state, true, false);
+}
+
+static void VerifyScriptGenericBench(benchmark::State& state)
+{
+    BenchVerifyScript(state, true, true);
+}
+
+static void VerifyScriptP2PKHBench(benchmark::State& state)
+{
+    BenchVerifyScript(state, false, false);
+}
+
+static void VerifyScriptP2PKHGenericBench(benchmark::State& state)
+{
+    BenchVerifyScript(state, false, true);
+}
+
 BENCHMARK(VerifyScriptBench, 6300);
+BENCHMARK(VerifyScriptGenericBench, 6300);
+BENCHMARK(VerifyScriptP2PKHBench, 6300);
+BENCHMARK(VerifyScriptP2PKHGenericBench, 6300);
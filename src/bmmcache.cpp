@@ -5,7 +5,8 @@
 
 BMMCache::BMMCache()
 {
-
+    nDepositCursorBurnIndex = 0;
+    nMainBlockHashDumped = 0;
 }
 
 bool BMMCache::StoreBMMBlock(const CBlock& block)
@@ -54,11 +55,13 @@ std::vector<uint256> BMMCache::GetBroadcastedWithdrawalBundleCache() const
 
 std::vector<uint256> BMMCache::GetMainBlockHashCache() const
 {
+    LOCK(cs_mainBlockCache);
     return vMainBlockHash;
 }
 
 std::vector<uint256> BMMCache::GetRecentMainBlockHashes() const
 {
+    LOCK(cs_mainBlockCache);
     // Return up to three of the most recent mainchain block hashes
     std::vector<uint256> vHash;
     std::vector<uint256>::const_reverse_iterator rit = vMainBlockHash.rbegin();
@@ -74,10 +77,14 @@ std::vector<uint256> BMMCache::GetRecentMainBlockHashes() const
 void BMMCache::ClearBMMBlocks()
 {
     mapBMMBlocks.clear();
+    mapBMMRequest.clear();
 }
 
 void BMMCache::StoreBroadcastedWithdrawalBundle(const uint256& hashWithdrawalBundle)
 {
+    if (snapshot && snapshot->Contains(HASH_SNAPSHOT_WITHDRAWAL_BUNDLE, hashWithdrawalBundle))
+        return;
+
     setWithdrawalBundleBroadcasted.insert(hashWithdrawalBundle);
 }
 
@@ -94,6 +101,9 @@ bool BMMCache::HaveBroadcastedWithdrawalBundle(const uint256& hashWithdrawalBund
     if (setWithdrawalBundleBroadcasted.count(hashWithdrawalBundle))
         return true;
 
+    if (snapshot && snapshot->Contains(HASH_SNAPSHOT_WITHDRAWAL_BUNDLE, hashWithdrawalBundle))
+        return true;
+
     return false;
 }
 
@@ -102,7 +112,10 @@ bool BMMCache::HaveVerifiedBMM(const uint256& hashBlock) const
     if (hashBlock.IsNull())
         return false;
 
-    return (setBMMVerified.count(hashBlock));
+    if (setBMMVerified.count(hashBlock))
+        return true;
+
+    return snapshot && snapshot->Contains(HASH_SNAPSHOT_BMM, hashBlock);
 }
 
 void BMMCache::CacheVerifiedBMM(const uint256& hashBlock)
@@ -110,6 +123,9 @@ void BMMCache::CacheVerifiedBMM(const uint256& hashBlock)
     if (hashBlock.IsNull())
         return;
 
+    if (snapshot && snapshot->Contains(HASH_SNAPSHOT_BMM, hashBlock))
+        return;
+
     setBMMVerified.insert(hashBlock);
 }
 
@@ -118,7 +134,10 @@ bool BMMCache::HaveVerifiedDeposit(const uint256& txid) const
     if (txid.IsNull())
         return false;
 
-    return (setDepositVerified.count(txid));
+    if (setDepositVerified.count(txid))
+        return true;
+
+    return snapshot && snapshot->Contains(HASH_SNAPSHOT_DEPOSIT, txid);
 }
 
 void BMMCache::CacheVerifiedDeposit(const uint256& txid)
@@ -126,6 +145,9 @@ void BMMCache::CacheVerifiedDeposit(const uint256& txid)
     if (txid.IsNull())
         return;
 
+    if (snapshot && snapshot->Contains(HASH_SNAPSHOT_DEPOSIT, txid))
+        return;
+
     setDepositVerified.insert(txid);
 }
 
@@ -147,8 +169,19 @@ std::vector<uint256> BMMCache::GetVerifiedDepositCache() const
     return vHash;
 }
 
+void BMMCache::SetSnapshot(std::unique_ptr<HashSnapshot> snapshotIn)
+{
+    snapshot = std::move(snapshotIn);
+}
+
+const HashSnapshot* BMMCache::GetSnapshot() const
+{
+    return snapshot.get();
+}
+
 void BMMCache::CacheMainBlockHash(const uint256& hash)
 {
+    LOCK(cs_mainBlockCache);
     // Don't re-cache the genesis block
     if (vMainBlockHash.size() == 1 && hash == vMainBlockHash.front())
         return;
@@ -164,8 +197,19 @@ void BMMCache::CacheMainBlockHash(const uint256& hash)
     mapMainBlock[hash] = index;
 }
 
+void BMMCache::CacheMainBlockHash(const std::vector<uint256>& vHash)
+{
+    LOCK(cs_mainBlockCache);
+    vMainBlockHash.reserve(vMainBlockHash.size() + vHash.size());
+    mapMainBlock.reserve(mapMainBlock.size() + vHash.size());
+
+    for (const uint256& u : vHash)
+        CacheMainBlockHash(u);
+}
+
 bool BMMCache::UpdateMainBlockCache(std::deque<uint256>& deqHashNew, bool& fReorg, std::vector<uint256>& vOrphan)
 {
+    LOCK(cs_mainBlockCache);
     if (deqHashNew.empty()) {
         LogPrintf("%s: Error - called with empty list of new block hashes!\n", __func__);
         return false;
@@ -201,6 +245,10 @@ bool BMMCache::UpdateMainBlockCache(std::deque<uint256>& deqHashNew, bool& fReor
     for (const uint256& u : vOrphan)
         mapMainBlock.erase(u);
 
+    // Disconnected blocks have to be removed from mainblockhash.dat
+    if (vMainBlockHash.size() < nMainBlockHashDumped)
+        nMainBlockHashDumped = 0;
+
     // It's possible that the first block in the list of new blocks (which
     // connects to our cached chain by a prevblock) was already cached.
     // The first block that connected by prevblock to one of our cached blocks
@@ -223,6 +271,7 @@ bool BMMCache::UpdateMainBlockCache(std::deque<uint256>& deqHashNew, bool& fReor
 
 uint256 BMMCache::GetLastMainBlockHash() const
 {
+    LOCK(cs_mainBlockCache);
     if (vMainBlockHash.empty())
         return uint256();
 
@@ -231,6 +280,7 @@ uint256 BMMCache::GetLastMainBlockHash() const
 
 uint256 BMMCache::GetMainPrevBlockHash(const uint256& hashBlock) const
 {
+    LOCK(cs_mainBlockCache);
     if (vMainBlockHash.size() < 2)
         return uint256();
 
@@ -252,11 +302,24 @@ uint256 BMMCache::GetMainPrevBlockHash(const uint256& hashBlock) const
 
 int BMMCache::GetCachedBlockCount() const
 {
+    LOCK(cs_mainBlockCache);
     return vMainBlockHash.size();
 }
 
+bool BMMCache::GetMainBlockHash(int nHeight, uint256& hash) const
+{
+    LOCK(cs_mainBlockCache);
+    if (nHeight < 0 || (size_t)nHeight >= vMainBlockHash.size())
+        return false;
+
+    hash = vMainBlockHash[nHeight];
+
+    return true;
+}
+
 int BMMCache::GetMainchainBlockHeight(const uint256& hash) const
 {
+    LOCK(cs_mainBlockCache);
     if (!mapMainBlock.count(hash))
         return -1;
 
@@ -267,6 +330,7 @@ int BMMCache::GetMainchainBlockHeight(const uint256& hash) const
 
 bool BMMCache::HaveMainBlock(const uint256& hash) const
 {
+    LOCK(cs_mainBlockCache);
     return mapMainBlock.count(hash);
 }
 
@@ -275,6 +339,46 @@ bool BMMCache::HaveBMMRequestForPrevBlock(const uint256& hashPrevBlock) const
     return setPrevBlockBMMCreated.count(hashPrevBlock);
 }
 
+void BMMCache::StoreBMMRequest(const uint256& txid, const uint256& hashMerkleRoot, const uint256& hashPrevMain, const CAmount& amount, int64_t nTime)
+{
+    BMMRequest request;
+    request.hashMerkleRoot = hashMerkleRoot;
+    request.hashPrevMain = hashPrevMain;
+    request.amount = amount;
+    request.nTimeCreated = nTime;
+
+    mapBMMRequest[txid] = request;
+    mapBMMBidStats[amount].nRequest++;
+}
+
+int BMMCache::GetBMMRequestCount(const uint256& hashPrevMain) const
+{
+    int nRequest = 0;
+    for (const auto& r : mapBMMRequest) {
+        if (r.second.hashPrevMain == hashPrevMain)
+            nRequest++;
+    }
+    return nRequest;
+}
+
+void BMMCache::RecordBMMIncluded(const uint256& txid, int64_t nTime)
+{
+    std::map<uint256, BMMRequest>::iterator it = mapBMMRequest.find(txid);
+    if (it == mapBMMRequest.end())
+        return;
+
+    BMMBidStats& stats = mapBMMBidStats[it->second.amount];
+    stats.nIncluded++;
+    stats.nTotalLatency += std::max<int64_t>(0, nTime - it->second.nTimeCreated);
+
+    mapBMMRequest.erase(it);
+}
+
+std::map<CAmount, BMMBidStats> BMMCache::GetBMMBidStats() const
+{
+    return mapBMMBidStats;
+}
+
 void BMMCache::AddCheckedMainBlock(const uint256& hashBlock)
 {
     setMainBlockChecked.insert(hashBlock);
@@ -287,8 +391,26 @@ bool BMMCache::MainBlockChecked(const uint256& hashBlock) const
 
 void BMMCache::ResetMainBlockCache()
 {
+    LOCK(cs_mainBlockCache);
     vMainBlockHash.clear();
     mapMainBlock.clear();
+    nMainBlockHashDumped = 0;
+}
+
+std::vector<uint256> BMMCache::GetMainBlockHashesToDump(bool& fRewrite) const
+{
+    LOCK(cs_mainBlockCache);
+    fRewrite = nMainBlockHashDumped == 0;
+    if (fRewrite)
+        return vMainBlockHash;
+
+    return std::vector<uint256>(vMainBlockHash.begin() + nMainBlockHashDumped, vMainBlockHash.end());
+}
+
+void BMMCache::SetMainBlockHashesDumped()
+{
+    LOCK(cs_mainBlockCache);
+    nMainBlockHashDumped = vMainBlockHash.size();
 }
 
 void BMMCache::CacheWithdrawalID(const uint256& wtid)
@@ -305,3 +427,28 @@ bool BMMCache::IsMyWT(const uint256& wtid)
 {
     return setWITHDRAWALIDCache.count(wtid);
 }
+
+void BMMCache::SetDepositQueue(const std::vector<SidechainDeposit>& vDeposit, const uint256& hashCursor, uint32_t nCursorBurnIndex)
+{
+    vDepositQueue = vDeposit;
+    hashDepositCursor = hashCursor;
+    nDepositCursorBurnIndex = nCursorBurnIndex;
+}
+
+std::vector<SidechainDeposit> BMMCache::GetDepositQueue() const
+{
+    return vDepositQueue;
+}
+
+void BMMCache::GetDepositCursor(uint256& hashCursor, uint32_t& nCursorBurnIndex) const
+{
+    hashCursor = hashDepositCursor;
+    nCursorBurnIndex = nDepositCursorBurnIndex;
+}
+
+void BMMCache::ClearDepositQueue()
+{
+    vDepositQueue.clear();
+    hashDepositCursor.SetNull();
+    nDepositCursorBurnIndex = 0;
+}
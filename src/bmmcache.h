@@ -1,11 +1,17 @@
 #ifndef BITCOIN_BMMCACHE_H
 #define BITCOIN_BMMCACHE_H
 
+#include "amount.h"
+#include "hashsnapshot.h"
+#include "sidechain.h"
+#include "sync.h"
 #include "uint256.h"
 
 #include <deque>
 #include <map>
+#include <memory>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 class CBlock;
@@ -16,6 +22,30 @@ struct MainBlockIndex
     uint256 hash;
 };
 
+struct MainBlockHasher
+{
+    size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+};
+
+// A BMM request that we have sent to the mainchain
+struct BMMRequest
+{
+    uint256 hashMerkleRoot;
+    uint256 hashPrevMain; // Mainchain tip when the request was created
+    CAmount amount; // Amount bid to mainchain miners
+    int64_t nTimeCreated;
+};
+
+// BMM request results for one bid amount
+struct BMMBidStats
+{
+    int nRequest;
+    int nIncluded;
+    int64_t nTotalLatency; // Seconds from request to inclusion, all included
+
+    BMMBidStats() : nRequest(0), nIncluded(0), nTotalLatency(0) {}
+};
+
 class BMMCache
 {
 public:
@@ -53,10 +83,19 @@ public:
     // Cache that we verified a deposit with the mainchain
     void CacheVerifiedDeposit(const uint256& txid);
 
+    // Verified BMM hashes which are not in the snapshot
     std::vector<uint256> GetVerifiedBMMCache() const;
 
+    // Verified deposit txids which are not in the snapshot
     std::vector<uint256> GetVerifiedDepositCache() const;
 
+    // Use the hashes of a bmm.dat snapshot. Broadcasted withdrawal bundles,
+    // verified BMM and verified deposits are looked up in the snapshot as well
+    // as the in memory caches, which then only hold new hashes.
+    void SetSnapshot(std::unique_ptr<HashSnapshot> snapshotIn);
+
+    const HashSnapshot* GetSnapshot() const;
+
     void CacheMainBlockHash(const uint256& hash);
 
     void CacheMainBlockHash(const std::vector<uint256>& vHash);
@@ -69,29 +108,70 @@ public:
 
     int GetCachedBlockCount() const;
 
+    /** Get the cached hash of the mainchain block at nHeight */
+    bool GetMainBlockHash(int nHeight, uint256& hash) const;
+
     int GetMainchainBlockHeight(const uint256& hash) const;
 
     bool HaveMainBlock(const uint256& hash) const;
 
     bool HaveBMMRequestForPrevBlock(const uint256& hashPrevBlock) const;
 
+    // Track a BMM request sent to the mainchain for our bid statistics
+    void StoreBMMRequest(const uint256& txid, const uint256& hashMerkleRoot, const uint256& hashPrevMain, const CAmount& amount, int64_t nTime);
+
+    // Number of BMM requests we have made with this mainchain prevblock
+    int GetBMMRequestCount(const uint256& hashPrevMain) const;
+
+    // Record that the BMM request with mainchain txid was included in a
+    // mainchain block with time nTime
+    void RecordBMMIncluded(const uint256& txid, int64_t nTime);
+
+    std::map<CAmount, BMMBidStats> GetBMMBidStats() const;
+
     void AddCheckedMainBlock(const uint256& hashBlock);
 
     bool MainBlockChecked(const uint256& hashMainBlock) const;
 
     void ResetMainBlockCache();
 
+    // Get the main block hashes which have to be written to mainblockhash.dat.
+    // fRewrite is set if the file must be rewritten with all of the hashes
+    // instead of appending new ones because of a reorg or reset.
+    std::vector<uint256> GetMainBlockHashesToDump(bool& fRewrite) const;
+
+    // Mark all of the cached main block hashes as written to disk
+    void SetMainBlockHashesDumped();
+
     void CacheWithdrawalID(const uint256& wtid);
 
     std::set<uint256> GetCachedWithdrawalID();
 
     bool IsMyWT(const uint256& wtid);
 
+    // Replace the queue of deposits which have been verified with the mainchain
+    // but not yet connected, and the mainchain deposit cursor (the last deposit
+    // that we have downloaded from the mainchain).
+    void SetDepositQueue(const std::vector<SidechainDeposit>& vDeposit, const uint256& hashCursor, uint32_t nCursorBurnIndex);
+
+    std::vector<SidechainDeposit> GetDepositQueue() const;
+
+    void GetDepositCursor(uint256& hashCursor, uint32_t& nCursorBurnIndex) const;
+
+    void ClearDepositQueue();
+
 private:
     // BMM blocks that we have created with the intention of connecting to the
     // side blockchain once the BMM h* hash is included on the mainchain
     std::map<uint256 /* hashMerkleRoot */, CBlock> mapBMMBlocks;
 
+    // BMM requests for the blocks in mapBMMBlocks. There may be multiple
+    // requests (with different bids) for each block.
+    std::map<uint256 /* mainchain txid */, BMMRequest> mapBMMRequest;
+
+    // Statistics of our BMM requests by amount bid
+    std::map<CAmount, BMMBidStats> mapBMMBidStats;
+
     // Cache of sidechain block hashes which we have already verified with the
     // mainchain as having the BMM h* hash included.
     std::set<uint256 /* hashBlock */> setBMMVerified;
@@ -102,12 +182,23 @@ private:
     // WithdrawalBundle(s) that we have already broadcasted to the mainchain.
     std::set<uint256> setWithdrawalBundleBroadcasted;
 
+    // Hashes loaded from bmm.dat, searched in place
+    std::unique_ptr<HashSnapshot> snapshot;
+
+    // Guards the mainchain block cache: mapMainBlock, vMainBlockHash and
+    // nMainBlockHashDumped, which RPC threads read while it is updated
+    mutable CCriticalSection cs_mainBlockCache;
+
     // Index of mainchain block hash in vMainBlockHash
-    std::map<uint256 /* hashMainchainBlock */, MainBlockIndex> mapMainBlock;
+    std::unordered_map<uint256 /* hashMainchainBlock */, MainBlockIndex, MainBlockHasher> mapMainBlock;
 
     // List of all known mainchain block hashes in order
     std::vector<uint256> vMainBlockHash;
 
+    // Number of hashes at the start of vMainBlockHash which are already in
+    // mainblockhash.dat, 0 if the file has to be rewritten
+    size_t nMainBlockHashDumped;
+
     // TODO we could also cache a map of mainchain block hashes that we created
     // BMM requests for. That way, to check for BMM commitments we can just
     // check recent blocks that we created a commitment for instead of scanning
@@ -123,6 +214,14 @@ private:
 
     // WithdrawalIDs for WT(s) created by the user
     std::set<uint256> setWITHDRAWALIDCache;
+
+    // Deposits downloaded from the mainchain and verified but not yet
+    // connected, in CTIP spend order
+    std::vector<SidechainDeposit> vDepositQueue;
+
+    // Mainchain txid & burn index of the last deposit we have downloaded
+    uint256 hashDepositCursor;
+    uint32_t nDepositCursorBurnIndex;
 };
 
 #endif // BITCOIN_BMMCACHE_H
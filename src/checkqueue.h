@@ -8,6 +8,9 @@
 #include <sync.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -16,6 +19,23 @@
 template <typename T>
 class CCheckQueueControl;
 
+/**
+ * Run a batch of checks taken from a CCheckQueue, returning false as soon
+ * as one of them fails. Check types can overload this to process the whole
+ * batch at once.
+ */
+template <typename T>
+bool RunChecks(std::vector<T>& vChecks)
+{
+    for (T& check : vChecks)
+        if (!check())
+            return false;
+    return true;
+}
+
+/** Number of per worker queues in a CCheckQueue, workers beyond this share them */
+static const unsigned int CHECKQUEUE_WORKER_QUEUES = 64;
+
 /** 
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -25,12 +45,23 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every worker has its own queue, and the master spreads the verifications
+  * it adds over them. Workers take batches from the back of their own
+  * queue, and when it is empty steal from the front of the others', so the
+  * shared mutex is only taken to sleep and wake up.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    struct WorkerQueue
+    {
+        boost::mutex mutex;
+        std::deque<T> checks;
+    };
+
+    //! Mutex for sleeping and waking up workers and the master
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,87 +70,106 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! Per worker queues. The first one belongs to the master.
+    //! As the order of booleans doesn't matter, they are used as a LIFO
+    //! (stack) by their owner.
+    std::unique_ptr<WorkerQueue[]> vQueue;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The number of worker threads (excluding the master).
+    std::atomic<unsigned int> nWorkers;
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The queue the next added batch starts at. Only used by the master.
+    unsigned int nNextQueue;
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
+
+    //! Number of verifications in the worker queues.
+    std::atomic<unsigned int> nQueued;
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! Number of worker queues in use
+    unsigned int GetQueueCount() const
+    {
+        return std::min(nWorkers.load() + 1, CHECKQUEUE_WORKER_QUEUES);
+    }
+
+    /**
+     * Move up to nMax checks from the back (or front when stealing) of
+     * queue into vChecks. Returns the number of checks moved.
+     */
+    unsigned int Take(WorkerQueue& queue, std::vector<T>& vChecks, bool fSteal)
+    {
+        boost::unique_lock<boost::mutex> lock(queue.mutex);
+        if (queue.checks.empty())
+            return 0;
+        // Do not try to do everything at once, but aim for increasingly
+        // smaller batches so all workers finish approximately simultaneously.
+        const unsigned int nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.checks.size() / 2));
+        vChecks.resize(nNow);
+        for (unsigned int i = 0; i < nNow; i++) {
+            // Swap jobs to the local batch vector instead of copying.
+            if (fSteal) {
+                vChecks[i].swap(queue.checks.front());
+                queue.checks.pop_front();
+            } else {
+                vChecks[i].swap(queue.checks.back());
+                queue.checks.pop_back();
+            }
+        }
+        nQueued -= nNow;
+        return nNow;
+    }
+
+    /** Take a batch from our own queue, or steal one from another worker */
+    unsigned int TakeBatch(unsigned int nQueue, std::vector<T>& vChecks)
+    {
+        unsigned int nNow = Take(vQueue[nQueue], vChecks, false);
+        for (unsigned int i = 1; nNow == 0 && nQueued > 0 && i < CHECKQUEUE_WORKER_QUEUES; i++)
+            nNow = Take(vQueue[(nQueue + i) % CHECKQUEUE_WORKER_QUEUES], vChecks, true);
+        return nNow;
+    }
+
     /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    bool Loop(unsigned int nQueue, bool fMaster = false)
     {
         boost::condition_variable& cond = fMaster ? condMaster : condWorker;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
+            const unsigned int nNow = TakeBatch(nQueue, vChecks);
+            if (nNow == 0) {
                 boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
+                if (fMaster && nTodo == 0) {
+                    bool fRet = fAllOk;
+                    // reset the status for new work later
+                    fAllOk = true;
+                    // return the current status
+                    return fRet;
                 }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
+                // Checks may have been added since we looked
+                if (nQueued == 0)
                     cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                continue;
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
+            // Check whether we need to do work at all, and execute it
+            if (fAllOk && !RunChecks(vChecks))
+                fAllOk = false;
             vChecks.clear();
+            if (nTodo.fetch_sub(nNow) == nNow && !fMaster) {
+                // We processed the last element; inform the master it can exit and return the result
+                boost::unique_lock<boost::mutex> lock(mutex);
+                condMaster.notify_one();
+            }
         } while (true);
     }
 
@@ -128,32 +178,47 @@ public:
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    explicit CCheckQueue(unsigned int nBatchSizeIn) : vQueue(new WorkerQueue[CHECKQUEUE_WORKER_QUEUES]), nWorkers(0), nNextQueue(0), fAllOk(true), nTodo(0), nQueued(0), nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        const unsigned int nWorker = nWorkers++;
+        Loop(1 + nWorker % (CHECKQUEUE_WORKER_QUEUES - 1));
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true);
+        return Loop(0, true);
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty())
+            return;
         nTodo += vChecks.size();
+        nQueued += vChecks.size();
+
+        // Spread the checks over the worker queues in contiguous chunks
+        const unsigned int nQueues = GetQueueCount();
+        const size_t nChunk = (vChecks.size() + nQueues - 1) / nQueues;
+        for (size_t nStart = 0; nStart < vChecks.size(); nStart += nChunk) {
+            WorkerQueue& queue = vQueue[nNextQueue];
+            nNextQueue = (nNextQueue + 1) % nQueues;
+            const size_t nEnd = std::min(nStart + nChunk, vChecks.size());
+            boost::unique_lock<boost::mutex> lock(queue.mutex);
+            for (size_t i = nStart; i < nEnd; i++) {
+                queue.checks.emplace_back();
+                vChecks[i].swap(queue.checks.back());
+            }
+        }
+
+        boost::unique_lock<boost::mutex> lock(mutex);
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
     }
 
@@ -90,16 +90,39 @@ public:
 };
 
 // These implement the weight = (stripped_size * 4) + witness_size formula,
-// using only serialization with and without witness data. As witness_size
-// is equal to total_size - stripped_size, this formula is identical to:
-// weight = (stripped_size * 3) + total_size.
+// using the sizes with and without witness data cached by CTransaction. As
+// witness_size is equal to total_size - stripped_size, this formula is
+// identical to: weight = (stripped_size * 3) + total_size.
 static inline int64_t GetTransactionWeight(const CTransaction& tx)
 {
-    return ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) * (WITNESS_SCALE_FACTOR - 1) + ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+    return tx.GetStrippedSize() * (WITNESS_SCALE_FACTOR - 1) + tx.GetTotalSize();
+}
+
+// The block header and transaction count serialize the same with and
+// without witness data, so only the transactions need to be sized.
+static inline int64_t GetBlockStrippedSize(const CBlock& block)
+{
+    int64_t nSize = ::GetSerializeSize(static_cast<const CBlockHeader&>(block), SER_NETWORK, PROTOCOL_VERSION) + GetSizeOfCompactSize(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        nSize += tx->GetStrippedSize();
+    }
+    return nSize;
+}
+static inline int64_t GetBlockTotalSize(const CBlock& block)
+{
+    int64_t nSize = ::GetSerializeSize(static_cast<const CBlockHeader&>(block), SER_NETWORK, PROTOCOL_VERSION) + GetSizeOfCompactSize(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        nSize += tx->GetTotalSize();
+    }
+    return nSize;
 }
 static inline int64_t GetBlockWeight(const CBlock& block)
 {
-    return ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) * (WITNESS_SCALE_FACTOR - 1) + ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+    int64_t nWeight = (::GetSerializeSize(static_cast<const CBlockHeader&>(block), SER_NETWORK, PROTOCOL_VERSION) + GetSizeOfCompactSize(block.vtx.size())) * WITNESS_SCALE_FACTOR;
+    for (const auto& tx : block.vtx) {
+        nWeight += GetTransactionWeight(*tx);
+    }
+    return nWeight;
 }
 
 #endif // BITCOIN_CONSENSUS_VALIDATION_H
@@ -0,0 +1,189 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// SHA-256 using the Intel SHA extensions. The 2-way double hash interleaves
+// two independent messages so that their instructions can overlap.
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/common.h>
+
+namespace
+{
+
+alignas(16) const uint32_t K[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
+alignas(16) const uint8_t MASK[16] = {0x03, 0x02, 0x01, 0x00, 0x07, 0x06, 0x05, 0x04, 0x0b, 0x0a, 0x09, 0x08, 0x0f, 0x0e, 0x0d, 0x0c};
+
+/** Four rounds, using message words m and round constants K[i..i+3]. */
+void inline __attribute__((always_inline)) QuadRound(__m128i& state0, __m128i& state1, __m128i m, int i)
+{
+    const __m128i msg = _mm_add_epi32(m, _mm_load_si128((const __m128i*)(K + i)));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+}
+
+/** Compute the next four message words from the previous sixteen in m0..m3, and rotate them. */
+void inline __attribute__((always_inline)) NextMessage(__m128i& m0, __m128i& m1, __m128i& m2, __m128i& m3)
+{
+    __m128i t = _mm_sha256msg1_epu32(m0, m1);
+    t = _mm_add_epi32(t, _mm_alignr_epi8(m3, m2, 4));
+    t = _mm_sha256msg2_epu32(t, m3);
+    m0 = m1;
+    m1 = m2;
+    m2 = m3;
+    m3 = t;
+}
+
+/** Convert the state from (a, b, c, d), (e, f, g, h) to the (a, b, e, f), (c, d, g, h) order the instructions use. */
+void inline __attribute__((always_inline)) Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+void inline __attribute__((always_inline)) Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+
+__m128i inline __attribute__((always_inline)) Load(const unsigned char* in)
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), _mm_load_si128((const __m128i*)MASK));
+}
+
+void inline __attribute__((always_inline)) Store(unsigned char* out, __m128i s)
+{
+    _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(s, _mm_load_si128((const __m128i*)MASK)));
+}
+
+/** Process one 64-byte block of (already byte swapped) message words. */
+void inline __attribute__((always_inline)) Compress(__m128i& s0, __m128i& s1, __m128i m0, __m128i m1, __m128i m2, __m128i m3)
+{
+    const __m128i so0 = s0, so1 = s1;
+    QuadRound(s0, s1, m0, 0);
+    QuadRound(s0, s1, m1, 4);
+    QuadRound(s0, s1, m2, 8);
+    QuadRound(s0, s1, m3, 12);
+    for (int i = 16; i < 64; i += 4) {
+        NextMessage(m0, m1, m2, m3);
+        QuadRound(s0, s1, m3, i);
+    }
+    s0 = _mm_add_epi32(s0, so0);
+    s1 = _mm_add_epi32(s1, so1);
+}
+
+/** Same as Compress, for two independent states and messages. */
+void inline __attribute__((always_inline)) Compress2(__m128i& s0a, __m128i& s1a, __m128i m0a, __m128i m1a, __m128i m2a, __m128i m3a,
+                                                     __m128i& s0b, __m128i& s1b, __m128i m0b, __m128i m1b, __m128i m2b, __m128i m3b)
+{
+    const __m128i so0a = s0a, so1a = s1a, so0b = s0b, so1b = s1b;
+    QuadRound(s0a, s1a, m0a, 0);
+    QuadRound(s0b, s1b, m0b, 0);
+    QuadRound(s0a, s1a, m1a, 4);
+    QuadRound(s0b, s1b, m1b, 4);
+    QuadRound(s0a, s1a, m2a, 8);
+    QuadRound(s0b, s1b, m2b, 8);
+    QuadRound(s0a, s1a, m3a, 12);
+    QuadRound(s0b, s1b, m3b, 12);
+    for (int i = 16; i < 64; i += 4) {
+        NextMessage(m0a, m1a, m2a, m3a);
+        NextMessage(m0b, m1b, m2b, m3b);
+        QuadRound(s0a, s1a, m3a, i);
+        QuadRound(s0b, s1b, m3b, i);
+    }
+    s0a = _mm_add_epi32(s0a, so0a);
+    s1a = _mm_add_epi32(s1a, so1a);
+    s0b = _mm_add_epi32(s0b, so0b);
+    s1b = _mm_add_epi32(s1b, so1b);
+}
+
+void inline __attribute__((always_inline)) Initialize(__m128i& s0, __m128i& s1)
+{
+    s0 = _mm_set_epi32(0xa54ff53aul, 0x3c6ef372ul, 0xbb67ae85ul, 0x6a09e667ul);
+    s1 = _mm_set_epi32(0x5be0cd19ul, 0x1f83d9abul, 0x9b05688cul, 0x510e527ful);
+    Shuffle(s0, s1);
+}
+
+} // namespace
+
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i s0 = _mm_loadu_si128((const __m128i*)s);
+    __m128i s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    Shuffle(s0, s1);
+
+    while (blocks--) {
+        Compress(s0, s1, Load(chunk), Load(chunk + 16), Load(chunk + 32), Load(chunk + 48));
+        chunk += 64;
+    }
+
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)s, s0);
+    _mm_storeu_si128((__m128i*)(s + 4), s1);
+}
+}
+
+namespace sha256d64_shani
+{
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    // Message words of the padding block of a 64 byte message, and of the
+    // padding half of a 32 byte message.
+    const __m128i pad0 = _mm_set_epi32(0, 0, 0, 0x80000000ul);
+    const __m128i pad1 = _mm_setzero_si128();
+    const __m128i pad2 = _mm_setzero_si128();
+    const __m128i pad3 = _mm_set_epi32(0x200, 0, 0, 0);
+    const __m128i pad3b = _mm_set_epi32(0x100, 0, 0, 0);
+
+    __m128i s0a, s1a, s0b, s1b;
+
+    // Transform 1: the 64 byte inputs
+    Initialize(s0a, s1a);
+    Initialize(s0b, s1b);
+    Compress2(s0a, s1a, Load(in), Load(in + 16), Load(in + 32), Load(in + 48),
+              s0b, s1b, Load(in + 64), Load(in + 80), Load(in + 96), Load(in + 112));
+
+    // Transform 2: the padding block
+    Compress2(s0a, s1a, pad0, pad1, pad2, pad3,
+              s0b, s1b, pad0, pad1, pad2, pad3);
+
+    // Transform 3: the 32 byte first hashes, padded
+    Unshuffle(s0a, s1a);
+    Unshuffle(s0b, s1b);
+    __m128i t0a, t1a, t0b, t1b;
+    Initialize(t0a, t1a);
+    Initialize(t0b, t1b);
+    Compress2(t0a, t1a, s0a, s1a, pad0, pad3b,
+              t0b, t1b, s0b, s1b, pad0, pad3b);
+
+    Unshuffle(t0a, t1a);
+    Unshuffle(t0b, t1b);
+    Store(out, t0a);
+    Store(out + 16, t1a);
+    Store(out + 32, t0b);
+    Store(out + 48, t1b);
+}
+}
+
+#endif
@@ -0,0 +1,288 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <hashsnapshot.h>
+
+#include <crypto/common.h>
+#include <hash.h>
+#include <util.h>
+
+#include <algorithm>
+#include <string.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static_assert(sizeof(uint256) == 32, "hash snapshot requires packed uint256");
+
+static const unsigned char HASH_SNAPSHOT_MAGIC[4] = {'h', 's', 'n', 'p'};
+
+static const size_t HEADER_SIZE = 8;
+static const size_t BLOCK_HEADER_SIZE = 12;
+static const size_t CHECKSUM_SIZE = 32;
+
+static bool CheckBlockChecksum(const unsigned char* pBlock, size_t nHashSize)
+{
+    uint256 checksum;
+    CHash256().Write(pBlock, BLOCK_HEADER_SIZE + nHashSize).Finalize(checksum.begin());
+    return memcmp(checksum.begin(), pBlock + BLOCK_HEADER_SIZE + nHashSize, CHECKSUM_SIZE) == 0;
+}
+
+HashSnapshot::HashSnapshot()
+{
+    pData = nullptr;
+    nSize = 0;
+    fMapped = false;
+    fDamaged = false;
+    nTypesVerified = 0;
+}
+
+HashSnapshot::~HashSnapshot()
+{
+    Close();
+}
+
+bool HashSnapshot::Open(const fs::path& path)
+{
+    Close();
+
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file)
+        return false;
+
+#ifndef WIN32
+    struct stat st;
+    if (fstat(fileno(file), &st) == 0 && st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        if (p != MAP_FAILED) {
+            pData = (const unsigned char*)p;
+            nSize = st.st_size;
+            fMapped = true;
+        }
+    }
+#endif
+
+    if (!fMapped) {
+        unsigned char buf[4096];
+        size_t nRead;
+        while ((nRead = fread(buf, 1, sizeof(buf), file)) > 0)
+            vFileData.insert(vFileData.end(), buf, buf + nRead);
+        pData = vFileData.data();
+        nSize = vFileData.size();
+    }
+    fclose(file);
+
+    if (nSize < HEADER_SIZE || memcmp(pData, HASH_SNAPSHOT_MAGIC, sizeof(HASH_SNAPSHOT_MAGIC)) != 0
+            || ReadLE32(pData + 4) > HASH_SNAPSHOT_VERSION) {
+        Close();
+        return false;
+    }
+
+    size_t nPos = HEADER_SIZE;
+    while (nPos < nSize) {
+        if (nSize - nPos < BLOCK_HEADER_SIZE) {
+            fDamaged = true;
+            break;
+        }
+
+        Block block;
+        block.nType = ReadLE32(pData + nPos);
+        block.nFlags = ReadLE32(pData + nPos + 4);
+        const size_t nCount = ReadLE32(pData + nPos + 8);
+        const size_t nHashSize = nCount * sizeof(uint256);
+
+        if (nSize - nPos - BLOCK_HEADER_SIZE < nHashSize + CHECKSUM_SIZE) {
+            fDamaged = true;
+            break;
+        }
+
+        block.begin = (const uint256*)(pData + nPos + BLOCK_HEADER_SIZE);
+        block.end = block.begin + nCount;
+        block.fVerified = false;
+        block.fValid = false;
+        vBlock.push_back(block);
+
+        nPos += BLOCK_HEADER_SIZE + nHashSize + CHECKSUM_SIZE;
+    }
+
+    // A crash while appending can only have damaged the blocks at the end of
+    // the file, so check those now and drop the ones that fail. The other
+    // blocks are checked when they are first used.
+    while (!vBlock.empty()) {
+        Block& block = vBlock.back();
+        const unsigned char* pBlock = (const unsigned char*)block.begin - BLOCK_HEADER_SIZE;
+        block.fVerified = true;
+        block.fValid = CheckBlockChecksum(pBlock, (block.end - block.begin) * sizeof(uint256));
+        if (block.fValid)
+            break;
+        vBlock.pop_back();
+        fDamaged = true;
+    }
+
+    if (fDamaged)
+        LogPrintf("%s: Ignoring damaged data at the end of %s\n", __func__, path.string());
+
+    return true;
+}
+
+void HashSnapshot::Close()
+{
+#ifndef WIN32
+    if (fMapped)
+        munmap((void*)pData, nSize);
+#endif
+    vBlock.clear();
+    nTypesVerified = 0;
+    vFileData.clear();
+    vFileData.shrink_to_fit();
+    pData = nullptr;
+    nSize = 0;
+    fMapped = false;
+    fDamaged = false;
+}
+
+void HashSnapshot::VerifyBlocks(uint32_t nType) const
+{
+    const uint32_t nBit = nType < 32 ? (1u << nType) : 0;
+    if (nTypesVerified & nBit)
+        return;
+
+    std::lock_guard<std::mutex> lock(csVerify);
+    for (const Block& block : vBlock) {
+        if (block.nType != nType || block.fVerified)
+            continue;
+
+        const unsigned char* pBlock = (const unsigned char*)block.begin - BLOCK_HEADER_SIZE;
+        block.fValid = CheckBlockChecksum(pBlock, (block.end - block.begin) * sizeof(uint256));
+        block.fVerified = true;
+        if (!block.fValid) {
+            LogPrintf("%s: Ignoring damaged block of type %u in hash snapshot\n", __func__, nType);
+            fDamaged = true;
+        }
+    }
+    nTypesVerified |= nBit;
+}
+
+bool HashSnapshot::Contains(uint32_t nType, const uint256& hash) const
+{
+    VerifyBlocks(nType);
+    for (const Block& block : vBlock) {
+        if (block.nType != nType || !block.fValid)
+            continue;
+
+        if (block.nFlags & HASH_SNAPSHOT_SORTED) {
+            if (std::binary_search(block.begin, block.end, hash))
+                return true;
+        }
+        else if (std::find(block.begin, block.end, hash) != block.end) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<uint256> HashSnapshot::Get(uint32_t nType) const
+{
+    std::vector<uint256> vHash;
+    vHash.reserve(Count(nType));
+    for (const Block& block : vBlock) {
+        if (block.nType == nType && block.fValid)
+            vHash.insert(vHash.end(), block.begin, block.end);
+    }
+    return vHash;
+}
+
+size_t HashSnapshot::Count(uint32_t nType) const
+{
+    VerifyBlocks(nType);
+    size_t nCount = 0;
+    for (const Block& block : vBlock) {
+        if (block.nType == nType && block.fValid)
+            nCount += block.end - block.begin;
+    }
+    return nCount;
+}
+
+bool HashSnapshot::CanAppend() const
+{
+    return pData && !fDamaged && vBlock.size() < HASH_SNAPSHOT_MAX_BLOCKS;
+}
+
+static void SerializeBlock(std::vector<unsigned char>& vch, HashSnapshotBlock& block)
+{
+    if (block.nFlags & HASH_SNAPSHOT_SORTED)
+        std::sort(block.vHash.begin(), block.vHash.end());
+
+    const size_t nStart = vch.size();
+    const size_t nHashSize = block.vHash.size() * sizeof(uint256);
+
+    vch.resize(nStart + BLOCK_HEADER_SIZE + nHashSize + CHECKSUM_SIZE);
+
+    unsigned char* p = vch.data() + nStart;
+    WriteLE32(p, block.nType);
+    WriteLE32(p + 4, block.nFlags);
+    WriteLE32(p + 8, block.vHash.size());
+    if (nHashSize)
+        memcpy(p + BLOCK_HEADER_SIZE, block.vHash.data(), nHashSize);
+
+    CHash256().Write(p, BLOCK_HEADER_SIZE + nHashSize).Finalize(p + BLOCK_HEADER_SIZE + nHashSize);
+}
+
+static bool WriteBlocks(FILE* file, std::vector<HashSnapshotBlock>& vBlock)
+{
+    std::vector<unsigned char> vch;
+    for (HashSnapshotBlock& block : vBlock) {
+        if (!block.vHash.empty())
+            SerializeBlock(vch, block);
+    }
+
+    if (!vch.empty() && fwrite(vch.data(), 1, vch.size(), file) != vch.size())
+        return false;
+
+    FileCommit(file);
+    return true;
+}
+
+bool WriteHashSnapshot(const fs::path& path, std::vector<HashSnapshotBlock> vBlock)
+{
+    const fs::path pathNew = path.string() + ".new";
+
+    FILE* file = fsbridge::fopen(pathNew, "wb");
+    if (!file)
+        return false;
+
+    unsigned char header[HEADER_SIZE];
+    memcpy(header, HASH_SNAPSHOT_MAGIC, sizeof(HASH_SNAPSHOT_MAGIC));
+    WriteLE32(header + 4, HASH_SNAPSHOT_VERSION);
+
+    bool fWritten = fwrite(header, 1, sizeof(header), file) == sizeof(header) && WriteBlocks(file, vBlock);
+    fclose(file);
+
+    if (!fWritten) {
+        LogPrintf("%s: Failed to write %s\n", __func__, pathNew.string());
+        return false;
+    }
+
+    return RenameOver(pathNew, path);
+}
+
+bool AppendHashSnapshot(const fs::path& path, std::vector<HashSnapshotBlock> vBlock)
+{
+    if (!fs::exists(path))
+        return WriteHashSnapshot(path, std::move(vBlock));
+
+    FILE* file = fsbridge::fopen(path, "ab");
+    if (!file)
+        return false;
+
+    bool fWritten = WriteBlocks(file, vBlock);
+    fclose(file);
+
+    if (!fWritten)
+        LogPrintf("%s: Failed to append to %s\n", __func__, path.string());
+
+    return fWritten;
+}
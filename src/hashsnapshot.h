@@ -0,0 +1,144 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_HASHSNAPSHOT_H
+#define BITCOIN_HASHSNAPSHOT_H
+
+#include "fs.h"
+#include "uint256.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Flat file of uint256 hashes used for the BMM cache (bmm.dat) and the
+ * mainchain block hash cache (mainblockhash.dat).
+ *
+ * File layout (all integers little endian):
+ *
+ *   magic (4 bytes) | version (uint32)
+ *   block*
+ *
+ * Each block:
+ *
+ *   type (uint32) | flags (uint32) | count (uint32) | count * 32 byte hash |
+ *   checksum (double SHA256 of the block header and hashes)
+ *
+ * The hashes of a block with HASH_SNAPSHOT_SORTED set are in ascending order
+ * so that they can be binary searched where they are in the mapped file.
+ * New hashes are written by appending blocks. A block that is truncated or
+ * fails its checksum (for example because we crashed while appending) ends
+ * the file, and the blocks before it are still used.
+ *
+ * Only the checksums of the blocks at the end of the file are checked when
+ * it is opened. The other blocks are checked the first time hashes of their
+ * type are looked up, and a block that fails then is skipped.
+ */
+
+/** Block types */
+static const uint32_t HASH_SNAPSHOT_WITHDRAWAL_BUNDLE = 1; // Broadcasted withdrawal bundles
+static const uint32_t HASH_SNAPSHOT_BMM = 2; // Sidechain blocks with verified BMM
+static const uint32_t HASH_SNAPSHOT_DEPOSIT = 3; // Verified deposit txids
+static const uint32_t HASH_SNAPSHOT_MAIN_BLOCK = 4; // Mainchain block hashes in chain order
+
+/** Block flags */
+static const uint32_t HASH_SNAPSHOT_SORTED = 1;
+
+static const uint32_t HASH_SNAPSHOT_VERSION = 1;
+
+/** Rewrite the file instead of appending once it has this many blocks */
+static const size_t HASH_SNAPSHOT_MAX_BLOCKS = 32;
+
+struct HashSnapshotBlock
+{
+    uint32_t nType;
+    uint32_t nFlags;
+    std::vector<uint256> vHash;
+
+    HashSnapshotBlock(uint32_t nTypeIn, uint32_t nFlagsIn, std::vector<uint256> vHashIn)
+        : nType(nTypeIn), nFlags(nFlagsIn), vHash(std::move(vHashIn)) {}
+};
+
+/** Read only view of a hash snapshot file, memory mapped where supported */
+class HashSnapshot
+{
+public:
+    HashSnapshot();
+    ~HashSnapshot();
+
+    HashSnapshot(const HashSnapshot&) = delete;
+    HashSnapshot& operator=(const HashSnapshot&) = delete;
+
+    /**
+     * Open the snapshot at path. Returns false if the file is missing or is
+     * not a snapshot.
+     */
+    bool Open(const fs::path& path);
+
+    void Close();
+
+    /** Binary search the sorted blocks of nType for hash */
+    bool Contains(uint32_t nType, const uint256& hash) const;
+
+    /** Copy all hashes of nType, in file order */
+    std::vector<uint256> Get(uint32_t nType) const;
+
+    /** Number of hashes of nType */
+    size_t Count(uint32_t nType) const;
+
+    /** Number of blocks in the file, not counting a damaged end */
+    size_t GetBlockCount() const { return vBlock.size(); }
+
+    /**
+     * Whether new blocks can be appended to the file. False if a damaged
+     * block has been found or the file has so many blocks that it should be
+     * rewritten.
+     */
+    bool CanAppend() const;
+
+private:
+    struct Block
+    {
+        uint32_t nType;
+        uint32_t nFlags;
+        const uint256* begin;
+        const uint256* end;
+
+        // Checksum state, set once the block has been checked
+        mutable bool fVerified;
+        mutable bool fValid;
+    };
+
+    /** Check the blocks of nType which haven't been checked yet */
+    void VerifyBlocks(uint32_t nType) const;
+
+    std::vector<Block> vBlock;
+
+    // Guards checking blocks after Open
+    mutable std::mutex csVerify;
+
+    // Bit (1 << nType) is set once all blocks of nType have been checked
+    mutable std::atomic<uint32_t> nTypesVerified;
+
+    const unsigned char* pData;
+    size_t nSize;
+
+    // True if pData is a mapping of the file, otherwise it points into
+    // vFileData which the file was read into
+    bool fMapped;
+    std::vector<unsigned char> vFileData;
+
+    // True if a damaged block was found
+    mutable std::atomic<bool> fDamaged;
+};
+
+/** Write a new snapshot with vBlock replacing the file at path */
+bool WriteHashSnapshot(const fs::path& path, std::vector<HashSnapshotBlock> vBlock);
+
+/** Append vBlock to the snapshot at path, creating it if it doesn't exist */
+bool AppendHashSnapshot(const fs::path& path, std::vector<HashSnapshotBlock> vBlock);
+
+#endif // BITCOIN_HASHSNAPSHOT_H
@@ -35,6 +35,7 @@
 #include <script/standard.h>
 #include <script/sigcache.h>
 #include <scheduler.h>
+#include <sidechainclient.h>
 #include <timedata.h>
 #include <txdb.h>
 #include <txmempool.h>
@@ -89,6 +90,43 @@ static CZMQNotificationInterface* pzmqNotificationInterface = nullptr;
 #endif
 
 static const char* FEE_ESTIMATES_FILENAME="fee_estimates.dat";
+/** Interval between writes of the fee estimates while running, in seconds */
+static const int64_t FEE_ESTIMATES_CHECKPOINT_INTERVAL = 10 * 60;
+/** Estimator best seen height at the last write of the fee estimates */
+static unsigned int nFeeEstimatesCheckpointHeight = 0;
+
+/** Write the fee estimates to a new file and move it over the old one */
+static bool WriteFeeEstimates()
+{
+    fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
+    fs::path est_path_new = est_path;
+    est_path_new += ".new";
+
+    CAutoFile est_fileout(fsbridge::fopen(est_path_new, "wb"), SER_DISK, CLIENT_VERSION);
+    if (est_fileout.IsNull()) {
+        LogPrintf("%s: Failed to write fee estimates to %s\n", __func__, est_path_new.string());
+        return false;
+    }
+    if (!::feeEstimator.Write(est_fileout))
+        return false;
+    FileCommit(est_fileout.Get());
+    est_fileout.fclose();
+    return RenameOver(est_path_new, est_path);
+}
+
+/**
+ * Write the fee estimates if blocks were processed since the last write, so
+ * that a crash loses at most FEE_ESTIMATES_CHECKPOINT_INTERVAL of them. The
+ * transactions still unconfirmed are only counted as failures on shutdown.
+ */
+static void CheckpointFeeEstimates()
+{
+    unsigned int nHeight = ::feeEstimator.GetBestSeenHeight();
+    if (nHeight == nFeeEstimatesCheckpointHeight)
+        return;
+    if (WriteFeeEstimates())
+        nFeeEstimatesCheckpointHeight = nHeight;
+}
 
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -118,6 +156,20 @@ static const char* FEE_ESTIMATES_FILENAME="fee_estimates.dat";
 std::atomic<bool> fRequestShutdown(false);
 std::atomic<bool> fDumpMempoolLater(false);
 
+/** Interval between incremental writes of the mempool while running, in seconds */
+static const int64_t MEMPOOL_CHECKPOINT_INTERVAL = 60;
+
+/**
+ * Append new mempool transactions to the journal, so that a crash loses at
+ * most MEMPOOL_CHECKPOINT_INTERVAL of them. Nothing is written until the
+ * saved mempool has been loaded.
+ */
+static void CheckpointMempool()
+{
+    if (fDumpMempoolLater && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        DumpMempoolIncremental();
+}
+
 void StartShutdown()
 {
     fRequestShutdown = true;
@@ -221,15 +273,13 @@ void Shutdown()
     // Write the mainchain block hash cache to disk
     DumpMainBlockCache();
 
+    // Write the deposit queue and mainchain deposit cursor to disk
+    DumpDepositQueue();
+
     if (fFeeEstimatesInitialized)
     {
         ::feeEstimator.FlushUnconfirmed();
-        fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
-        CAutoFile est_fileout(fsbridge::fopen(est_path, "wb"), SER_DISK, CLIENT_VERSION);
-        if (!est_fileout.IsNull())
-            ::feeEstimator.Write(est_fileout);
-        else
-            LogPrintf("%s: Failed to write fee estimates to %s\n", __func__, est_path.string());
+        WriteFeeEstimates();
         fFeeEstimatesInitialized = false;
     }
 
@@ -340,11 +390,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", _("Print this help message and exit"));
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-assumebmmvalid=<hex>", _("If this block is in the chain assume that the BMM, prev block commits and deposits of it and its ancestors are valid, and verify them with the mainchain in the background after the initial sync (0 to verify all, default: 0)"));
     strUsage +=HelpMessageOpt("-assumevalid=<hex>", strprintf(_("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s)"), defaultChainParams->GetConsensus().defaultAssumeValid.GetHex()));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
+    strUsage += HelpMessageOpt("-coinprefetchthreads=<n>", strprintf(_("Set the number of threads reading the coins spent by a block from the database before connecting it (0 to %d, 0 = disabled, default: %d)"), MAX_COIN_PREFETCH_THREADS, DEFAULT_COIN_PREFETCH_THREADS));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND)
     {
@@ -361,6 +413,16 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
+    strUsage += HelpMessageOpt("-mainchaincachettl=<n>", strprintf(_("Seconds to reuse mainchain replies that can change without a new mainchain block, like average fees and withdrawal bundle status (0 to not cache them, default: %u)"), DEFAULT_MAINCHAIN_CACHE_TTL));
+    strUsage += HelpMessageOpt("-mainchainconnectionttl=<n>", strprintf(_("Seconds to trust a successful mainchain connection check before checking again (0 to check every time, default: %u)"), DEFAULT_MAINCHAIN_CONNECTION_TTL));
+    strUsage += HelpMessageOpt("-mainchainrpccookiefile=<loc>", _("Authenticate to the mainchain node with its auth cookie file, instead of a username and password"));
+    strUsage += HelpMessageOpt("-mainchainrpchost=<addr>", strprintf(_("Send mainchain RPC requests to <addr> (default: %s)"), DEFAULT_MAINCHAIN_RPC_HOST));
+    strUsage += HelpMessageOpt("-mainchainrpcpassword=<pw>", _("Password for mainchain RPC requests"));
+    strUsage += HelpMessageOpt("-mainchainrpcport=<port>", strprintf(_("Send mainchain RPC requests to <port> (default: %u or regtest: %u)"), DEFAULT_MAINCHAIN_RPC_PORT, DEFAULT_MAINCHAIN_RPC_PORT_REGTEST));
+#ifndef WIN32
+    strUsage += HelpMessageOpt("-mainchainrpcsocket=<path>", _("Send mainchain RPC requests to the Unix domain socket at <path> instead of -mainchainrpchost"));
+#endif
+    strUsage += HelpMessageOpt("-mainchainrpcuser=<user>", _("Username for mainchain RPC requests (default: -rpcuser)"));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
@@ -495,12 +557,17 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-whitelistrelay", strprintf(_("Accept relayed transactions received from whitelisted peers even when not relaying transactions (default: %d)"), DEFAULT_WHITELISTRELAY));
 
     strUsage += HelpMessageGroup(_("Block creation options:"));
+    strUsage += HelpMessageOpt("-blockmainchainfeescore", strprintf(_("Rank transactions for block creation by their fees plus the mainchain fees of the withdrawals they make (default: %u)"), DEFAULT_BLOCK_MAINCHAIN_FEE_SCORE));
     if (showDebug)
         strUsage += HelpMessageOpt("-blockmaxsize=<n>", "Set maximum BIP141 block weight to this * 4. Deprecated, use blockmaxweight");
     strUsage += HelpMessageOpt("-blockmaxweight=<n>", strprintf(_("Set maximum BIP141 block weight (default: %d)"), DEFAULT_BLOCK_MAX_WEIGHT));
     strUsage += HelpMessageOpt("-blockmintxfee=<amt>", strprintf(_("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)"), CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)));
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
+    strUsage += HelpMessageOpt("-bmmbidincrement=<amt>", strprintf(_("Bid increase (in %s) for each additional BMM request for the same mainchain tip (default: %s)"), CURRENCY_UNIT, FormatMoney(DEFAULT_BMM_BID_INCREMENT)));
+    strUsage += HelpMessageOpt("-bmmrequests=<n>", strprintf(_("Number of BMM requests to create for each mainchain tip (default: %u)"), DEFAULT_BMM_REQUESTS));
+    strUsage += HelpMessageOpt("-depositsync", strprintf(_("Download and verify new deposits from the mainchain in the background for block creation (default: %u)"), DEFAULT_DEPOSIT_SYNC));
+    strUsage += HelpMessageOpt("-depositsyncinterval=<n>", strprintf(_("Seconds between background deposit downloads (default: %u)"), DEFAULT_DEPOSIT_SYNC_INTERVAL));
 
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), DEFAULT_REST_ENABLE));
@@ -701,6 +768,26 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
     }
 }
 
+void ThreadDepositSync()
+{
+    const int64_t nInterval = std::max<int64_t>(1, gArgs.GetArg("-depositsyncinterval", DEFAULT_DEPOSIT_SYNC_INTERVAL));
+    while (true) {
+        UpdateDepositQueue();
+        MilliSleep(nInterval * 1000);
+    }
+}
+
+void ThreadVerifyAssumedBMM()
+{
+    // Wait for the initial sync to finish, then verify the blocks we assumed
+    // had valid BMM with the mainchain
+    while (IsInitialBlockDownload())
+        MilliSleep(1000);
+
+    while (!VerifyAssumedBMMBlocks())
+        MilliSleep(10000);
+}
+
 /** Sanity checks
  *  Ensure that Bitcoin is running in a usable environment with all
  *  necessary library support.
@@ -1000,6 +1087,15 @@ bool AppInitParameterInteraction()
     else
         LogPrintf("Validating signatures for all blocks.\n");
 
+    hashAssumeBMMValid = uint256S(gArgs.GetArg("-assumebmmvalid", "0"));
+    if (!hashAssumeBMMValid.IsNull())
+        LogPrintf("Assuming ancestors of block %s have valid BMM until verified with the mainchain.\n", hashAssumeBMMValid.GetHex());
+
+#ifdef WIN32
+    if (gArgs.IsArgSet("-mainchainrpcsocket"))
+        return InitError(_("-mainchainrpcsocket is not supported on this platform."));
+#endif
+
     // mempool limits
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     int64_t nMempoolSizeMin = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000 * 40;
@@ -1024,6 +1120,8 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    nCoinPrefetchThreads = std::max(0, std::min((int)gArgs.GetArg("-coinprefetchthreads", DEFAULT_COIN_PREFETCH_THREADS), MAX_COIN_PREFETCH_THREADS));
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1068,6 +1166,14 @@ bool AppInitParameterInteraction()
             return InitError(AmountErrMsg("blockmintxfee", gArgs.GetArg("-blockmintxfee", "")));
     }
 
+    // Sanity check argument for the BMM request bid increment
+    if (gArgs.IsArgSet("-bmmbidincrement"))
+    {
+        CAmount n = 0;
+        if (!ParseMoney(gArgs.GetArg("-bmmbidincrement", ""), n))
+            return InitError(AmountErrMsg("bmmbidincrement", gArgs.GetArg("-bmmbidincrement", "")));
+    }
+
     // Feerate used to define dust.  Shouldn't be changed lightly as old
     // implementations may inadvertently create non-standard transactions
     if (gArgs.IsArgSet("-dustrelayfee"))
@@ -1231,13 +1337,22 @@ bool AppInitMain()
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitRefundCache();
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadTxCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadRefundCheck);
     }
 
+    LogPrintf("Using %u threads for coin prefetching\n", nCoinPrefetchThreads);
+    for (int i = 0; i < nCoinPrefetchThreads; i++)
+        threadGroup.create_thread(&ThreadCoinPrefetch);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1597,10 +1712,19 @@ bool AppInitMain()
     if (!est_filein.IsNull())
         ::feeEstimator.Read(est_filein);
     fFeeEstimatesInitialized = true;
+    nFeeEstimatesCheckpointHeight = ::feeEstimator.GetBestSeenHeight();
+    scheduler.scheduleEvery(CheckpointFeeEstimates, FEE_ESTIMATES_CHECKPOINT_INTERVAL * 1000);
+    scheduler.scheduleEvery(CheckpointMempool, MEMPOOL_CHECKPOINT_INTERVAL * 1000);
 
     // Load the mainchain block hash cache from disk
     LoadMainBlockCache();
 
+    // Load the deposit queue and mainchain deposit cursor from disk
+    LoadDepositQueue();
+
+    // Seed the mainchain fee estimator with past withdrawal bundle outcomes
+    LoadMainchainFeeHistory();
+
     // ********************************************************* Step 8: load wallet
 #ifdef ENABLE_WALLET
     if (!OpenWallets())
@@ -1689,6 +1813,14 @@ bool AppInitMain()
         }
     }
 
+    // Keep a queue of new deposits for the miner in the background
+    if (gArgs.GetBoolArg("-depositsync", DEFAULT_DEPOSIT_SYNC))
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "depositsync", &ThreadDepositSync));
+
+    // Verify blocks connected under -assumebmmvalid once we have caught up
+    if (!hashAssumeBMMValid.IsNull())
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "verifybmm", &ThreadVerifyAssumedBMM));
+
     // ********************************************************* Step 11: start node
 
     int chain_active_height;
@@ -0,0 +1,150 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <mainchainfees.h>
+
+#include <sidechain.h>
+#include <util.h>
+#include <validation.h>
+
+#include <algorithm>
+
+static CAmount Median(std::vector<CAmount>& vAmount)
+{
+    assert(!vAmount.empty());
+    std::vector<CAmount>::iterator it = vAmount.begin() + vAmount.size() / 2;
+    std::nth_element(vAmount.begin(), it, vAmount.end());
+    return *it;
+}
+
+CMainchainFeeEstimator::CMainchainFeeEstimator()
+{
+    fHaveEstimate = false;
+}
+
+void CMainchainFeeEstimator::AddBundleOutcome(const SidechainWithdrawalBundle& bundle)
+{
+    if (bundle.status != WITHDRAWAL_BUNDLE_SPENT && bundle.status != WITHDRAWAL_BUNDLE_FAILED)
+        return;
+
+    // The second output of a bundle encodes its mainchain fees
+    CAmount nFees = 0;
+    if (!bundle.tx || bundle.tx->vout.size() < 2 || !DecodeWithdrawalFees(bundle.tx->vout[1].scriptPubKey, nFees)) {
+        LogPrintf("%s: Failed to decode mainchain fees of withdrawal bundle: %s\n", __func__,
+                bundle.tx ? bundle.tx->GetHash().ToString() : "");
+        return;
+    }
+
+    MainchainFeeBundle outcome;
+    outcome.hash = bundle.tx->GetHash();
+    outcome.nFees = nFees;
+    outcome.nWithdrawal = bundle.vWithdrawalID.size();
+    outcome.fSpent = bundle.status == WITHDRAWAL_BUNDLE_SPENT;
+
+    LOCK(cs);
+    for (std::deque<MainchainFeeBundle>::iterator it = dequeBundle.begin(); it != dequeBundle.end(); ++it) {
+        if (it->hash == outcome.hash) {
+            dequeBundle.erase(it);
+            break;
+        }
+    }
+    dequeBundle.push_back(outcome);
+    if (dequeBundle.size() > MAINCHAIN_FEE_BUNDLE_HISTORY)
+        dequeBundle.pop_front();
+
+    UpdateEstimate();
+}
+
+void CMainchainFeeEstimator::RemoveBundleOutcome(const uint256& hashBundle)
+{
+    LOCK(cs);
+    for (std::deque<MainchainFeeBundle>::iterator it = dequeBundle.begin(); it != dequeBundle.end(); ++it) {
+        if (it->hash == hashBundle) {
+            dequeBundle.erase(it);
+            UpdateEstimate();
+            return;
+        }
+    }
+}
+
+void CMainchainFeeEstimator::AddMainchainFeeSample(const uint256& hashMainchainTip, CAmount nAverageFee)
+{
+    if (nAverageFee <= 0)
+        return;
+
+    LOCK(cs);
+    if (!dequeSample.empty() && dequeSample.back().first == hashMainchainTip) {
+        dequeSample.back().second = nAverageFee;
+    } else {
+        dequeSample.emplace_back(hashMainchainTip, nAverageFee);
+        if (dequeSample.size() > MAINCHAIN_FEE_SAMPLE_HISTORY)
+            dequeSample.pop_front();
+    }
+
+    UpdateEstimate();
+}
+
+bool CMainchainFeeEstimator::EstimateFee(MainchainFeeEstimate& estimateOut) const
+{
+    LOCK(cs);
+    estimateOut = estimate;
+    return fHaveEstimate;
+}
+
+std::vector<MainchainFeeBundle> CMainchainFeeEstimator::GetBundles() const
+{
+    LOCK(cs);
+    return std::vector<MainchainFeeBundle>(dequeBundle.begin(), dequeBundle.end());
+}
+
+void CMainchainFeeEstimator::Clear()
+{
+    LOCK(cs);
+    dequeBundle.clear();
+    dequeSample.clear();
+    UpdateEstimate();
+}
+
+void CMainchainFeeEstimator::UpdateEstimate()
+{
+    AssertLockHeld(cs);
+
+    estimate = MainchainFeeEstimate();
+    estimate.nSamples = dequeSample.size();
+
+    // Fees per withdrawal of the bundles paid out, and the highest of the
+    // bundles that failed since the last one was paid out
+    std::vector<CAmount> vSpent;
+    CAmount nFailedMax = 0;
+    for (const MainchainFeeBundle& bundle : dequeBundle) {
+        if (bundle.fSpent) {
+            vSpent.push_back(bundle.GetFeePerWithdrawal());
+            nFailedMax = 0;
+        } else {
+            estimate.nFailed++;
+            nFailedMax = std::max(nFailedMax, bundle.GetFeePerWithdrawal());
+        }
+    }
+    estimate.nSpent = vSpent.size();
+
+    if (!vSpent.empty()) {
+        estimate.strSource = "bundles";
+        estimate.nFee = Median(vSpent);
+        if (nFailedMax >= estimate.nFee)
+            estimate.nFee = nFailedMax + 1;
+    }
+    else
+    if (!dequeSample.empty()) {
+        std::vector<CAmount> vSample;
+        for (const std::pair<uint256, CAmount>& sample : dequeSample)
+            vSample.push_back(sample.second);
+        estimate.strSource = "mainchain";
+        estimate.nFee = std::max(Median(vSample), nFailedMax + 1);
+    }
+
+    // Withdrawals must pay some mainchain fee
+    fHaveEstimate = !estimate.strSource.empty();
+    if (fHaveEstimate && estimate.nFee <= 0)
+        estimate.nFee = 1;
+}
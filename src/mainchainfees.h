@@ -0,0 +1,98 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_MAINCHAINFEES_H
+#define BITCOIN_MAINCHAINFEES_H
+
+#include <amount.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+struct SidechainWithdrawalBundle;
+
+/** Number of paid out or failed withdrawal bundles the estimator remembers */
+static const size_t MAINCHAIN_FEE_BUNDLE_HISTORY = 32;
+
+/** Number of mainchain average fee samples the estimator remembers */
+static const size_t MAINCHAIN_FEE_SAMPLE_HISTORY = 144;
+
+/** What a withdrawal bundle paid in mainchain fees and what became of it */
+struct MainchainFeeBundle
+{
+    uint256 hash;
+    CAmount nFees; // Total mainchain fees of the bundle's withdrawals
+    size_t nWithdrawal;
+    bool fSpent; // Paid out, or failed
+
+    CAmount GetFeePerWithdrawal() const { return nWithdrawal ? nFees / nWithdrawal : 0; }
+};
+
+/** An estimate and what it was based on */
+struct MainchainFeeEstimate
+{
+    CAmount nFee;
+    std::string strSource; // "bundles" or "mainchain"
+    size_t nSpent;
+    size_t nFailed;
+    size_t nSamples;
+
+    MainchainFeeEstimate() : nFee(0), nSpent(0), nFailed(0), nSamples(0) {}
+};
+
+/**
+ * Local estimate of the mainchain fee a new withdrawal should pay.
+ *
+ * It is fed with the outcomes of this sidechain's withdrawal bundles as the
+ * blocks committing to them are connected, and with the mainchain average
+ * fees SidechainClient receives. The estimate is the median mainchain fee
+ * per withdrawal of recently paid out bundles, raised above any bundle that
+ * failed after the last one paid out. Without bundle history the median
+ * mainchain average transaction fee is used instead.
+ *
+ * The estimate is updated when the history changes, so reading it takes
+ * constant time and no mainchain request.
+ */
+class CMainchainFeeEstimator
+{
+public:
+    CMainchainFeeEstimator();
+
+    /** Record a bundle that was paid out or failed, replacing an earlier outcome */
+    void AddBundleOutcome(const SidechainWithdrawalBundle& bundle);
+
+    /** Forget the outcome of a bundle, when the block recording it is disconnected */
+    void RemoveBundleOutcome(const uint256& hashBundle);
+
+    /**
+     * Record the average mainchain transaction fee at a mainchain tip. A new
+     * sample for the same tip replaces the previous one.
+     */
+    void AddMainchainFeeSample(const uint256& hashMainchainTip, CAmount nAverageFee);
+
+    /** Get the current estimate, false if there is no data to base it on */
+    bool EstimateFee(MainchainFeeEstimate& estimate) const;
+
+    /** Bundle outcomes remembered, oldest first */
+    std::vector<MainchainFeeBundle> GetBundles() const;
+
+    void Clear();
+
+private:
+    mutable CCriticalSection cs;
+
+    std::deque<MainchainFeeBundle> dequeBundle;
+    std::deque<std::pair<uint256, CAmount>> dequeSample;
+
+    /** Estimate for the current history */
+    MainchainFeeEstimate estimate;
+    bool fHaveEstimate;
+
+    void UpdateEstimate();
+};
+
+#endif // BITCOIN_MAINCHAINFEES_H
@@ -58,6 +58,29 @@ uint64_t nLastBlockWeight = 0;
 
 static const uint64_t nRefundOutputSize = 34;
 
+/**
+ * The transactions selected for the last block template, so that repeated
+ * BMM attempts on the same tip don't select them from the whole mempool
+ * again. Guarded by cs_main.
+ */
+struct BlockTemplateCache
+{
+    // What the selection depended on
+    uint256 hashPrevBlock;
+    unsigned int nTransactionsUpdated;
+    unsigned int nBlockMaxWeight;
+    CFeeRate blockMinFeeRate;
+    bool fMainchainFeeScore;
+    bool fIncludeRefunds;
+
+    // Selected transactions in block order
+    std::vector<uint256> vHash;
+    bool fBlockFull;
+
+    BlockTemplateCache() : nTransactionsUpdated(0), nBlockMaxWeight(0), fMainchainFeeScore(false), fIncludeRefunds(false), fBlockFull(false) {}
+};
+static BlockTemplateCache templateCache;
+
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
 {
     int64_t nOldTime = pblock->nTime;
@@ -72,11 +95,13 @@ int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParam
 BlockAssembler::Options::Options() {
     blockMinFeeRate = CFeeRate(DEFAULT_BLOCK_MIN_TX_FEE);
     nBlockMaxWeight = DEFAULT_BLOCK_MAX_WEIGHT;
+    fMainchainFeeScore = DEFAULT_BLOCK_MAINCHAIN_FEE_SCORE;
 }
 
 BlockAssembler::BlockAssembler(const CChainParams& params, const Options& options) : chainparams(params)
 {
     blockMinFeeRate = options.blockMinFeeRate;
+    fMainchainFeeScore = options.fMainchainFeeScore;
     // Limit weight to between 4K and MAX_BLOCK_WEIGHT-4K for sanity:
     nBlockMaxWeight = std::max<size_t>(4000, std::min<size_t>(MAX_BLOCK_WEIGHT - 4000, options.nBlockMaxWeight));
 }
@@ -96,6 +121,7 @@ static BlockAssembler::Options DefaultOptions(const CChainParams& params)
     } else {
         options.blockMinFeeRate = CFeeRate(DEFAULT_BLOCK_MIN_TX_FEE);
     }
+    options.fMainchainFeeScore = gArgs.GetBoolArg("-blockmainchainfeescore", DEFAULT_BLOCK_MAINCHAIN_FEE_SCORE);
     return options;
 }
 
@@ -113,6 +139,8 @@ void BlockAssembler::resetBlock()
     // These counters do not include coinbase tx
     nBlockTx = 0;
     nFees = 0;
+
+    fBlockFull = false;
 }
 
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, bool fMineWitnessTx, bool fCheckBMM, const uint256& hashPrevBlock, CAmount* nFeesOut)
@@ -191,10 +219,55 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
         fCreatedWithdrawalBundle = true;
     }
 
+    const bool fIncludeRefunds = !fCreatedWithdrawalBundle;
+
+    // Start from the transactions of the last template on the same tip, and
+    // only select from the mempool if it changed since
+    const bool fUseCache = hashPrevBlock.IsNull();
+    const unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    int nCachedTx = 0;
+    bool fUnchanged = false;
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
     std::vector<CTxMemPool::txiter> vRefund;
-    addPackageTxs(nPackagesSelected, nDescendantsUpdated, vRefund, !fCreatedWithdrawalBundle /* fIncludeRefunds */);
+    auto addPackages = [&]() {
+        if (fMainchainFeeScore) {
+            // The mempool has no index by mainchain fees, which is off by
+            // default, so rank its entries for this block only
+            std::vector<CTxMemPool::txiter> vMainchainScore;
+            vMainchainScore.reserve(mempool.mapTx.size());
+            for (CTxMemPool::txiter it = mempool.mapTx.begin(); it != mempool.mapTx.end(); ++it)
+                vMainchainScore.push_back(it);
+            std::sort(vMainchainScore.begin(), vMainchainScore.end(), [](const CTxMemPool::txiter& a, const CTxMemPool::txiter& b) {
+                return CompareTxMemPoolEntryByAncestorMainchainFee()(*a, *b);
+            });
+            addPackageTxs<ancestor_mainchain_score>(vMainchainScore.cbegin(), vMainchainScore.cend(), nPackagesSelected, nDescendantsUpdated, vRefund, fIncludeRefunds);
+        } else {
+            const auto& index = mempool.mapTx.get<ancestor_score>();
+            addPackageTxs<ancestor_score>(index.begin(), index.end(), nPackagesSelected, nDescendantsUpdated, vRefund, fIncludeRefunds);
+        }
+    };
+    if (fUseCache)
+        nCachedTx = addCachedTxs(pindexPrev, fIncludeRefunds, nTransactionsUpdated, vRefund, fUnchanged);
+    if (!fUnchanged) {
+        addPackages();
+
+        // Once the block is full, packages that were left out may pay more
+        // than the cached transactions, so select the block again from
+        // scratch
+        if (nCachedTx > 0 && fBlockFull) {
+            resetBlock();
+            fIncludeWitness = true;
+            pblock->vtx.resize(1);
+            pblocktemplate->vTxFees.resize(1);
+            pblocktemplate->vTxSigOpsCost.resize(1);
+            vRefund.clear();
+            nCachedTx = 0;
+            nPackagesSelected = 0;
+            nDescendantsUpdated = 0;
+            addPackages();
+        }
+    }
 
     int64_t nTime1 = GetTimeMicros();
 
@@ -300,24 +373,37 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     uint32_t nBurnIndex = 0;
     bool fHaveDeposits = psidechaintree->GetLastDeposit(lastDeposit);
     if (fHaveDeposits) {
-        hashLastDeposit = lastDeposit.dtx.GetHash();
+        hashLastDeposit = lastDeposit.dtx->GetHash();
         nBurnIndex = lastDeposit.nBurnIndex;
     }
-    vDeposit = client.UpdateDeposits(hashLastDeposit, nBurnIndex);
+
+    // Use the deposits that have already been downloaded and verified in the
+    // background if the queue continues from our last deposit. Otherwise
+    // request them from the mainchain now.
+    bool fQueued = false;
+    if (gArgs.GetBoolArg("-depositsync", DEFAULT_DEPOSIT_SYNC))
+        fQueued = GetQueuedDeposits(vDeposit);
+    if (!fQueued)
+        vDeposit = client.UpdateDeposits(hashLastDeposit, nBurnIndex);
 
     // Find new deposits
     std::vector<SidechainDeposit> vDepositNew;
-    for (const SidechainDeposit& d: vDeposit) {
-        // We look up the deposit using the hash of the deposit without the
-        // payout amount set because we do not know the payout amount yet.
-        if (!psidechaintree->HaveDepositNonAmount(d.GetID())) {
-            vDepositNew.push_back(d);
+    if (fQueued) {
+        // Queued deposits have already been checked against the db
+        vDepositNew = vDeposit;
+    } else {
+        for (const SidechainDeposit& d: vDeposit) {
+            // We look up the deposit using the hash of the deposit without the
+            // payout amount set because we do not know the payout amount yet.
+            if (!psidechaintree->HaveDepositNonAmount(d.GetID())) {
+                vDepositNew.push_back(d);
+            }
         }
     }
 
     // Check deposit burn index
     for (const SidechainDeposit& d : vDepositNew) {
-        if (d.nBurnIndex >= d.dtx.vout.size()) {
+        if (d.nBurnIndex >= d.dtx->vout.size()) {
             LogPrintf("%s: Error: new deposit has invalid burn index:\n%s\n", __func__, d.ToString());
             return nullptr;
         }
@@ -360,12 +446,12 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     if (fHaveDeposits && vDepositSorted.size()) {
         bool fFound = false;
         const SidechainDeposit& first = vDepositSorted.front();
-        for (const CTxIn& in : first.dtx.vin) {
-            if (in.prevout.hash == lastDeposit.dtx.GetHash()
-                    && lastDeposit.dtx.vout.size() > in.prevout.n
+        for (const CTxIn& in : first.dtx->vin) {
+            if (in.prevout.hash == lastDeposit.dtx->GetHash()
+                    && lastDeposit.dtx->vout.size() > in.prevout.n
                     && lastDeposit.nBurnIndex == in.prevout.n) {
                 // Calculate payout amount
-                CAmount ctipAmount = lastDeposit.dtx.vout[lastDeposit.nBurnIndex].nValue;
+                CAmount ctipAmount = lastDeposit.dtx->vout[lastDeposit.nBurnIndex].nValue;
                 if (first.amtUserPayout > ctipAmount)
                     vDepositSorted.front().amtUserPayout -= ctipAmount;
                 else
@@ -376,7 +462,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
             }
         }
         if (!fFound) {
-            LogPrintf("%s: Error: No CTIP found for first deposit in sorted list: %s (mainchain txid)\n", __func__, first.dtx.GetHash().ToString());
+            LogPrintf("%s: Error: No CTIP found for first deposit in sorted list: %s (mainchain txid)\n", __func__, first.dtx->GetHash().ToString());
             return nullptr;
         }
     } else {
@@ -401,12 +487,12 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
             // the user payout amount. Note that we've already sorted by CTIP so
             // they all should exist but we are going to double check anyways.
             bool fFound = false;
-            for (const CTxIn& in : it->dtx.vin) {
-                if (in.prevout.hash == itPrev->dtx.GetHash()
-                        && itPrev->dtx.vout.size() > in.prevout.n
+            for (const CTxIn& in : it->dtx->vin) {
+                if (in.prevout.hash == itPrev->dtx->GetHash()
+                        && itPrev->dtx->vout.size() > in.prevout.n
                         && itPrev->nBurnIndex == in.prevout.n) {
                     // Calculate payout amount
-                    CAmount ctipAmount = itPrev->dtx.vout[itPrev->nBurnIndex].nValue;
+                    CAmount ctipAmount = itPrev->dtx->vout[itPrev->nBurnIndex].nValue;
 
                     if (it->amtUserPayout > ctipAmount)
                         it->amtUserPayout -= ctipAmount;
@@ -418,7 +504,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
                 }
             }
             if (!fFound) {
-                LogPrintf("%s: Error: Failed to calculate payout amount - no CTIP found for deposit: %s (mainchain txid)\n", __func__, it->dtx.GetHash().ToString());
+                LogPrintf("%s: Error: Failed to calculate payout amount - no CTIP found for deposit: %s (mainchain txid)\n", __func__, it->dtx->GetHash().ToString());
                 return nullptr;
             }
         }
@@ -507,15 +593,35 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
 
     // We have to skip BMM checks when first creating a block as we haven't
-    // received BMM proof from the mainchain yet.
+    // received BMM proof from the mainchain yet. Templates on the active
+    // chain only need the transactions added since the last one checked.
     CValidationState state;
-    if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false,
-                fCheckBMM, hashPrevBlock.IsNull() ? false : true)) {
+    bool fValid;
+    if (fUseCache && !fCheckBMM)
+        fValid = TestBlockTemplateValidity(state, chainparams, *pblock, pindexPrev);
+    else
+        fValid = TestBlockValidity(state, chainparams, *pblock, pindexPrev, false,
+                fCheckBMM, hashPrevBlock.IsNull() ? false : true);
+    if (!fValid) {
+        templateCache = BlockTemplateCache();
         throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
     }
     int64_t nTime2 = GetTimeMicros();
 
-    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+    if (fUseCache) {
+        templateCache.hashPrevBlock = pindexPrev->GetBlockHash();
+        templateCache.nTransactionsUpdated = nTransactionsUpdated;
+        templateCache.nBlockMaxWeight = nBlockMaxWeight;
+        templateCache.blockMinFeeRate = blockMinFeeRate;
+        templateCache.fMainchainFeeScore = fMainchainFeeScore;
+        templateCache.fIncludeRefunds = fIncludeRefunds;
+        templateCache.vHash.clear();
+        for (size_t i = 1; i < pblock->vtx.size(); i++)
+            templateCache.vHash.push_back(pblock->vtx[i]->GetHash());
+        templateCache.fBlockFull = fBlockFull;
+    }
+
+    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d cached txs, %d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nCachedTx, nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
     return std::move(pblocktemplate);
 }
@@ -636,6 +742,19 @@ void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, CTxMemP
     std::sort(sortedEntries.begin(), sortedEntries.end(), CompareTxIterByAncestorCount());
 }
 
+// The mempool entry at a position of a mempool index, or of a ranking of
+// mempool entries built for one block
+template<typename MempoolIter>
+static CTxMemPool::txiter MempoolEntryAt(MempoolIter mi)
+{
+    return mempool.mapTx.project<0>(mi);
+}
+
+static CTxMemPool::txiter MempoolEntryAt(std::vector<CTxMemPool::txiter>::const_iterator mi)
+{
+    return *mi;
+}
+
 // This transaction selection algorithm orders the mempool based
 // on feerate of a transaction including all unconfirmed ancestors.
 // Since we don't remove transactions from the mempool as we select them
@@ -646,7 +765,12 @@ void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, CTxMemP
 // Each time through the loop, we compare the best transaction in
 // mapModifiedTxs with the next transaction in the mempool to decide what
 // transaction package to work on next.
-void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated, std::vector<CTxMemPool::txiter>& vRefund, bool fIncludeRefunds)
+//
+// With -blockmainchainfeescore, packages are ranked by
+// CompareTxMemPoolEntryByAncestorMainchainFee instead, which also counts the
+// mainchain fees of the withdrawals a transaction makes.
+template<typename ScoreTag, typename MempoolIter>
+void BlockAssembler::addPackageTxs(MempoolIter mi, MempoolIter miEnd, int &nPackagesSelected, int &nDescendantsUpdated, std::vector<CTxMemPool::txiter>& vRefund, bool fIncludeRefunds)
 {
     // mapModifiedTx will store sorted packages after they are modified
     // because some of their txs are already in the block
@@ -658,7 +782,6 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     // and modifying them for their already included ancestors
     UpdatePackagesForAdded(inBlock, mapModifiedTx);
 
-    CTxMemPool::indexed_transaction_set::index<ancestor_score>::type::iterator mi = mempool.mapTx.get<ancestor_score>().begin();
     CTxMemPool::txiter iter;
 
     // Limit the number of attempts to add transactions to the block when it is
@@ -668,17 +791,18 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     int64_t nConsecutiveFailed = 0;
 
     std::set<uint256> setRefund;
-    while (mi != mempool.mapTx.get<ancestor_score>().end() || !mapModifiedTx.empty())
+    while (mi != miEnd || !mapModifiedTx.empty())
     {
         // Skip refunds if we don't want to include them
-        if (!fIncludeRefunds && mi->IsWithdrawalRefund()) {
+        const bool fRefund = mi != miEnd && MempoolEntryAt(mi)->IsWithdrawalRefund();
+        if (!fIncludeRefunds && fRefund) {
             ++mi;
             continue;
         }
 
         // Very refund in the mempool again before adding it to a block
-        if (mi->IsWithdrawalRefund()) {
-            CTransactionRef tx = mi->GetSharedTx();
+        if (fRefund) {
+            CTransactionRef tx = MempoolEntryAt(mi)->GetSharedTx();
             if (tx == nullptr) {
                 ++mi;
                 continue;
@@ -711,8 +835,8 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         }
 
         // First try to find a new transaction in mapTx to evaluate.
-        if (mi != mempool.mapTx.get<ancestor_score>().end() &&
-                SkipMapTxEntry(mempool.mapTx.project<0>(mi), mapModifiedTx, failedTx)) {
+        if (mi != miEnd &&
+                SkipMapTxEntry(MempoolEntryAt(mi), mapModifiedTx, failedTx)) {
             ++mi;
             continue;
         }
@@ -721,16 +845,16 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         // the next entry from mapTx, or the best from mapModifiedTx?
         bool fUsingModified = false;
 
-        modtxscoreiter modit = mapModifiedTx.get<ancestor_score>().begin();
-        if (mi == mempool.mapTx.get<ancestor_score>().end()) {
+        typename indexed_modified_transaction_set::index<ScoreTag>::type::iterator modit = mapModifiedTx.get<ScoreTag>().begin();
+        if (mi == miEnd) {
             // We're out of entries in mapTx; use the entry from mapModifiedTx
             iter = modit->iter;
             fUsingModified = true;
         } else {
             // Try to compare the mapTx entry to the mapModifiedTx entry
-            iter = mempool.mapTx.project<0>(mi);
-            if (modit != mapModifiedTx.get<ancestor_score>().end() &&
-                    CompareTxMemPoolEntryByAncestorFee()(*modit, CTxMemPoolModifiedEntry(iter))) {
+            iter = MempoolEntryAt(mi);
+            if (modit != mapModifiedTx.get<ScoreTag>().end() &&
+                    mapModifiedTx.get<ScoreTag>().key_comp()(*modit, CTxMemPoolModifiedEntry(iter))) {
                 // The best entry in mapModifiedTx has higher score
                 // than the one from mapTx.
                 // Switch which transaction (package) to consider
@@ -761,17 +885,24 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
             packageSize += nRefundOutputSize;
         }
 
+        // Ranked by mainchain fees too, a package is worth including if its
+        // sidechain and mainchain fees together pay the minimum fee rate
+        if (fMainchainFeeScore) {
+            packageFees += iter->GetMainchainFee();
+        }
+
         if (packageFees < blockMinFeeRate.GetFee(packageSize)) {
             // Everything else we might consider has a lower fee rate
             return;
         }
 
         if (!TestPackage(packageSize, packageSigOpsCost)) {
+            fBlockFull = true;
             if (fUsingModified) {
                 // Since we always look at the best entry in mapModifiedTx,
                 // we must erase failed entries so that we can consider the
                 // next best entry on the next loop iteration
-                mapModifiedTx.get<ancestor_score>().erase(modit);
+                mapModifiedTx.get<ScoreTag>().erase(modit);
                 failedTx.insert(iter);
             }
 
@@ -796,7 +927,7 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         // Test if all tx's are Final
         if (!TestPackageTransactions(ancestors)) {
             if (fUsingModified) {
-                mapModifiedTx.get<ancestor_score>().erase(modit);
+                mapModifiedTx.get<ScoreTag>().erase(modit);
                 failedTx.insert(iter);
             }
             continue;
@@ -828,6 +959,75 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     }
 }
 
+int BlockAssembler::addCachedTxs(const CBlockIndex* pindexPrev, bool fIncludeRefunds, unsigned int nTransactionsUpdated, std::vector<CTxMemPool::txiter>& vRefundTx, bool& fUnchanged)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(mempool.cs);
+
+    fUnchanged = false;
+
+    if (templateCache.hashPrevBlock != pindexPrev->GetBlockHash() ||
+            templateCache.nBlockMaxWeight != nBlockMaxWeight ||
+            templateCache.blockMinFeeRate != blockMinFeeRate ||
+            templateCache.fMainchainFeeScore != fMainchainFeeScore ||
+            templateCache.fIncludeRefunds != fIncludeRefunds)
+        return 0;
+
+    // If a package was left out of the last template, new transactions may
+    // outbid the cached ones, which only a full selection gets right
+    const bool fSameMempool = templateCache.nTransactionsUpdated == nTransactionsUpdated;
+    if (!fSameMempool && templateCache.fBlockFull)
+        return 0;
+
+    int nAdded = 0;
+    for (const uint256& hash : templateCache.vHash) {
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end())
+            continue;
+
+        // Skip the descendants of transactions that left the mempool
+        bool fHaveParents = true;
+        for (CTxMemPool::txiter parent : mempool.GetMemPoolParents(it)) {
+            if (!inBlock.count(parent)) {
+                fHaveParents = false;
+                break;
+            }
+        }
+        if (!fHaveParents)
+            continue;
+
+        // Once the mempool changed, the fee of a cached transaction may have
+        // been lowered by prioritisetransaction, so check it the way
+        // addPackageTxs would. Its ancestors are all in the block already.
+        if (!fSameMempool) {
+            uint64_t nSize = it->GetTxSize();
+            CAmount nFee = it->GetModifiedFee();
+            if (it->IsWithdrawalRefund())
+                nSize += nRefundOutputSize;
+            if (fMainchainFeeScore)
+                nFee += it->GetMainchainFee();
+            if (nFee < blockMinFeeRate.GetFee(nSize))
+                continue;
+
+            CTxMemPool::setEntries package;
+            package.insert(it);
+            if (!TestPackageTransactions(package))
+                continue;
+        }
+
+        if (it->IsWithdrawalRefund())
+            vRefundTx.push_back(it);
+
+        AddToBlock(it);
+        ++nAdded;
+    }
+
+    fUnchanged = fSameMempool && nAdded == (int)templateCache.vHash.size();
+    fBlockFull = templateCache.fBlockFull;
+
+    return nAdded;
+}
+
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
@@ -870,10 +1070,10 @@ bool BlockAssembler::GenerateBMMBlock(CBlock& block, std::string& strError, CAmo
             strError = "Failed to get script for mining!\n";
             return false;
         }
-        pblocktemplate = BlockAssembler(Params()).CreateNewBlock(coinbaseScript->reserveScript, true, false, hashPrevBlock, nFeesOut);
+        pblocktemplate = CreateNewBlock(coinbaseScript->reserveScript, true, false, hashPrevBlock, nFeesOut);
         #endif
     } else {
-        pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptPubKey, true, false, hashPrevBlock, nFeesOut);
+        pblocktemplate = CreateNewBlock(scriptPubKey, true, false, hashPrevBlock, nFeesOut);
     }
 
     if (!pblocktemplate.get()) {
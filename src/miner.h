@@ -21,6 +21,8 @@ class CScript;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Default for -blockmainchainfeescore, rank packages by sidechain and mainchain fees */
+static const bool DEFAULT_BLOCK_MAINCHAIN_FEE_SCORE = false;
 
 struct CBlockTemplate
 {
@@ -42,6 +44,7 @@ struct CTxMemPoolModifiedEntry {
     }
 
     int64_t GetModifiedFee() const { return iter->GetModifiedFee(); }
+    CAmount GetMainchainFee() const { return iter->GetMainchainFee(); }
     uint64_t GetSizeWithAncestors() const { return nSizeWithAncestors; }
     CAmount GetModFeesWithAncestors() const { return nModFeesWithAncestors; }
     size_t GetTxSize() const { return iter->GetTxSize(); }
@@ -98,6 +101,12 @@ typedef boost::multi_index_container<
             boost::multi_index::tag<ancestor_score>,
             boost::multi_index::identity<CTxMemPoolModifiedEntry>,
             CompareTxMemPoolEntryByAncestorFee
+        >,
+        // sorted by modified ancestor fee rate and mainchain fees
+        boost::multi_index::ordered_non_unique<
+            boost::multi_index::tag<ancestor_mainchain_score>,
+            boost::multi_index::identity<CTxMemPoolModifiedEntry>,
+            CompareTxMemPoolEntryByAncestorMainchainFee
         >
     >
 > indexed_modified_transaction_set;
@@ -133,12 +142,17 @@ private:
     unsigned int nBlockMaxWeight;
     CFeeRate blockMinFeeRate;
 
+    // Whether mainchain fees of withdrawals count towards package scores
+    bool fMainchainFeeScore;
+
     // Information on the current status of the block
     uint64_t nBlockWeight;
     uint64_t nBlockTx;
     uint64_t nBlockSigOpsCost;
     CAmount nFees;
     CTxMemPool::setEntries inBlock;
+    // Whether a package was left out because it didn't fit in the block
+    bool fBlockFull;
 
     // Chain context for the block
     int nHeight;
@@ -150,6 +164,7 @@ public:
         Options();
         size_t nBlockMaxWeight;
         CFeeRate blockMinFeeRate;
+        bool fMainchainFeeScore;
     };
 
     explicit BlockAssembler(const CChainParams& params);
@@ -184,8 +199,17 @@ private:
     // Methods for how to add transactions to a block.
     /** Add transactions based on feerate including unconfirmed ancestors
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
-      * statistics from the package selection (for logging statistics). */
-    void addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated, std::vector<CTxMemPool::txiter>& vRefundTx, bool fIncludeRefunds);
+      * statistics from the package selection (for logging statistics).
+      * Mempool entries are considered in the order of [mi, miEnd), and
+      * modified packages are ranked by the index tagged with ScoreTag,
+      * which must rank them the same way. */
+    template<typename ScoreTag, typename MempoolIter>
+    void addPackageTxs(MempoolIter mi, MempoolIter miEnd, int &nPackagesSelected, int &nDescendantsUpdated, std::vector<CTxMemPool::txiter>& vRefundTx, bool fIncludeRefunds);
+    /** Add the transactions of the last template built on pindexPrev that
+      * are still in the mempool, unless new transactions could displace
+      * them. Sets fUnchanged if the mempool didn't change since. Returns
+      * the number of transactions added. */
+    int addCachedTxs(const CBlockIndex* pindexPrev, bool fIncludeRefunds, unsigned int nTransactionsUpdated, std::vector<CTxMemPool::txiter>& vRefundTx, bool& fUnchanged);
 
     // helper functions for addPackageTxs()
     /** Remove confirmed (inBlock) entries from given set */
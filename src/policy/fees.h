@@ -228,6 +228,9 @@ public:
     /** Calculation of highest target that estimates are tracked for */
     unsigned int HighestTargetTracked(FeeEstimateHorizon horizon) const;
 
+    /** Height of the last block processed */
+    unsigned int GetBestSeenHeight() const;
+
 private:
     unsigned int nBestSeenHeight;
     unsigned int firstRecordedHeight;
@@ -253,7 +256,6 @@ private:
     unsigned int untrackedTxs;
 
     std::vector<double> buckets;              // The upper-bound of the range for the bucket (inclusive)
-    std::map<double, unsigned int> bucketMap; // Map of bucket upper-bound to index into all vectors by bucket
 
     mutable CCriticalSection cs_feeEstimator;
 
@@ -67,6 +67,11 @@ uint256 CTransaction::ComputeHash() const
     return SerializeHash(*this, SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS);
 }
 
+unsigned int CTransaction::ComputeSize(int nVersionFlags) const
+{
+    return ::GetSerializeSize(*this, SER_NETWORK, PROTOCOL_VERSION | nVersionFlags);
+}
+
 uint256 CTransaction::GetWitnessHash() const
 {
     if (!HasWitness()) {
@@ -76,9 +81,9 @@ uint256 CTransaction::GetWitnessHash() const
 }
 
 /* For backward compatibility, the hash is initialized to 0. TODO: remove the need for this default constructor entirely. */
-CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash() {}
-CTransaction::CTransaction(const CMutableTransaction &tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(ComputeHash()) {}
-CTransaction::CTransaction(CMutableTransaction &&tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(ComputeHash()) {}
+CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash(), nStrippedSize(ComputeSize(SERIALIZE_TRANSACTION_NO_WITNESS)), nTotalSize(ComputeSize(0)) {}
+CTransaction::CTransaction(const CMutableTransaction &tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(ComputeHash()), nStrippedSize(ComputeSize(SERIALIZE_TRANSACTION_NO_WITNESS)), nTotalSize(ComputeSize(0)) {}
+CTransaction::CTransaction(CMutableTransaction &&tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(ComputeHash()), nStrippedSize(ComputeSize(SERIALIZE_TRANSACTION_NO_WITNESS)), nTotalSize(ComputeSize(0)) {}
 
 CAmount CTransaction::GetValueOut() const
 {
@@ -91,11 +96,6 @@ CAmount CTransaction::GetValueOut() const
     return nValueOut;
 }
 
-unsigned int CTransaction::GetTotalSize() const
-{
-    return ::GetSerializeSize(*this, SER_NETWORK, PROTOCOL_VERSION);
-}
-
 std::string CTransaction::ToString() const
 {
     std::string str;
@@ -293,8 +293,11 @@ public:
 private:
     /** Memory only. */
     const uint256 hash;
+    const unsigned int nStrippedSize;
+    const unsigned int nTotalSize;
 
     uint256 ComputeHash() const;
+    unsigned int ComputeSize(int nVersionFlags) const;
 
 public:
     /** Construct a CTransaction that qualifies as IsNull() */
@@ -335,7 +338,18 @@ public:
      * "Total Size" defined in BIP141 and BIP144.
      * @return Total transaction size in bytes
      */
-    unsigned int GetTotalSize() const;
+    unsigned int GetTotalSize() const {
+        return nTotalSize;
+    }
+
+    /**
+     * Get the transaction size in bytes without witness data.
+     * "Base Size" defined in BIP141.
+     * @return Stripped transaction size in bytes
+     */
+    unsigned int GetStrippedSize() const {
+        return nStrippedSize;
+    }
 
     bool IsCoinBase() const
     {
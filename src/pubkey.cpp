@@ -183,6 +183,42 @@ bool CPubKey::Verify(const uint256 &hash, const std::vector<unsigned char>& vchS
     return secp256k1_ecdsa_verify(secp256k1_context_verify, &sig, hash.begin(), &pubkey);
 }
 
+bool CSignatureBatch::Add(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig) {
+    static_assert(sizeof(Entry::pubkey) == sizeof(secp256k1_pubkey), "unexpected secp256k1_pubkey size");
+    static_assert(sizeof(Entry::sig) == sizeof(secp256k1_ecdsa_signature), "unexpected secp256k1_ecdsa_signature size");
+    if (!pubkey.IsValid())
+        return false;
+    secp256k1_pubkey pk;
+    secp256k1_ecdsa_signature sig;
+    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pk, pubkey.begin(), pubkey.size())) {
+        return false;
+    }
+    if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
+        return false;
+    }
+    secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, &sig, &sig);
+    vEntry.emplace_back();
+    Entry& entry = vEntry.back();
+    memcpy(entry.pubkey, pk.data, sizeof(entry.pubkey));
+    memcpy(entry.sig, sig.data, sizeof(entry.sig));
+    entry.hash = hash;
+    return true;
+}
+
+bool CSignatureBatch::Verify(size_t nBegin, size_t nEnd) const {
+    assert(nBegin <= nEnd && nEnd <= vEntry.size());
+    secp256k1_pubkey pk;
+    secp256k1_ecdsa_signature sig;
+    for (size_t i = nBegin; i < nEnd; i++) {
+        const Entry& entry = vEntry[i];
+        memcpy(pk.data, entry.pubkey, sizeof(pk.data));
+        memcpy(sig.data, entry.sig, sizeof(sig.data));
+        if (!secp256k1_ecdsa_verify(secp256k1_context_verify, &sig, entry.hash.begin(), &pk))
+            return false;
+    }
+    return true;
+}
+
 bool CPubKey::RecoverCompact(const uint256 &hash, const std::vector<unsigned char>& vchSig) {
     if (vchSig.size() != COMPACT_SIGNATURE_SIZE)
         return false;
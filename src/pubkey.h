@@ -11,6 +11,7 @@
 #include <serialize.h>
 #include <uint256.h>
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 
@@ -243,6 +244,44 @@ struct CExtPubKey {
     }
 };
 
+/**
+ * Signatures collected to be verified together. Keys and signatures are
+ * parsed when they are added, so verifying only does the curve operations
+ * and no allocations. There is no batch verification in the bundled
+ * libsecp256k1 yet, so Verify checks the signatures one after another.
+ */
+class CSignatureBatch
+{
+private:
+    struct Entry
+    {
+        unsigned char pubkey[64]; // secp256k1_pubkey
+        unsigned char sig[64]; // normalized secp256k1_ecdsa_signature
+        uint256 hash;
+    };
+    std::vector<Entry> vEntry;
+
+public:
+    /**
+     * Add a signature of hash by pubkey. Returns false if the key or the
+     * signature can't be parsed, in which case it is not added as it can
+     * never be valid.
+     */
+    bool Add(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig);
+
+    /** Whether all signatures in [nBegin, nEnd) are valid */
+    bool Verify(size_t nBegin, size_t nEnd) const;
+
+    /** Whether all signatures in the batch are valid */
+    bool Verify() const { return Verify(0, vEntry.size()); }
+
+    /** Remove the signatures added after the first nSize */
+    void Truncate(size_t nSize) { vEntry.resize(std::min(nSize, vEntry.size())); }
+
+    size_t size() const { return vEntry.size(); }
+    void clear() { vEntry.clear(); }
+};
+
 /** Users of this module must hold an ECCVerifyHandle. The constructor and
  *  destructor of these are not allowed to run in parallel, though. */
 class ECCVerifyHandle
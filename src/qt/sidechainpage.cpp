@@ -1135,7 +1135,7 @@ void SidechainPage::SetCurrentWithdrawalBundle(const std::string& strHash, bool
     ui->labelBlockHeight->setText(QString::number(withdrawalBundle.nHeight));
 
     // Set transaction size
-    int64_t sz = GetTransactionWeight(withdrawalBundle.tx);
+    int64_t sz = GetTransactionWeight(*withdrawalBundle.tx);
 
     QString size;
     size += QString::number(sz);
@@ -1210,9 +1210,9 @@ void SidechainPage::UpdateSidechainWealth()
 
     SidechainDeposit deposit;
     if (psidechaintree->GetLastDeposit(deposit)) {
-        if (deposit.nBurnIndex >= deposit.dtx.vout.size())
+        if (deposit.nBurnIndex >= deposit.dtx->vout.size())
             return;
-        amountCTIP = deposit.dtx.vout[deposit.nBurnIndex].nValue;
+        amountCTIP = deposit.dtx->vout[deposit.nBurnIndex].nValue;
     }
 
     int unit = walletModel->getOptionsModel()->getDisplayUnit();
@@ -138,8 +138,8 @@ void SidechainWithdrawalBundleHistoryTableModel::UpdateModel()
         WithdrawalBundleHistoryTableObject object;
 
         // Insert new WithdrawalBundle into table
-        object.hash = QString::fromStdString(wt.tx.GetHash().ToString());
-        object.amount = CTransaction(wt.tx).GetValueOut();
+        object.hash = QString::fromStdString(wt.tx->GetHash().ToString());
+        object.amount = wt.tx->GetValueOut();
         object.status = QString::fromStdString(wt.GetStatusStr());
         object.height = wt.nHeight;
         model.append(QVariant::fromValue(object));
@@ -183,11 +183,15 @@ void SidechainWithdrawalTableModel::UpdateModel()
     // Loop through WTs and calculate TX size, copy WTs that should be displayed
     // (based on fOnlyMyWithdrawals) into vector.
     std::vector<WTTableObject> vWTDisplay;
+    size_t nSize = ::GetSerializeSize(wjtx, SER_NETWORK, PROTOCOL_VERSION);
     for (const SidechainWithdrawal& wt : vWT) {
         // Add wt output to fake WithdrawalBundle and calculate size estimate as well as
         // estimate which WTs will be included in the next WithdrawalBundle
         CTxDestination dest = DecodeDestination(wt.strDestination, true /* fMainchain */);
-        wjtx.vout.push_back(CTxOut(wt.amount, GetScriptForDestination(dest)));
+        CTxOut out(wt.amount, GetScriptForDestination(dest));
+        nSize += ::GetSerializeSize(out, SER_NETWORK, PROTOCOL_VERSION)
+            + GetSizeOfCompactSize(wjtx.vout.size() + 1) - GetSizeOfCompactSize(wjtx.vout.size());
+        wjtx.vout.push_back(out);
 
         // Check if the Withdrawalis mine
         bool fMine = bmmCache.IsMyWT(wt.GetID());
@@ -199,7 +203,7 @@ void SidechainWithdrawalTableModel::UpdateModel()
         object.amount = wt.amount;
         object.amountMainchainFee = wt.mainchainFee;
         object.destination = QString::fromStdString(wt.strDestination);
-        object.nCumulativeWeight = GetTransactionWeight(wjtx);
+        object.nCumulativeWeight = nSize * WITNESS_SCALE_FACTOR;
         object.fMine = fMine;
 
         vWTDisplay.push_back(object);
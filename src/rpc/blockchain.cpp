@@ -84,8 +84,8 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     if (chainActive.Contains(blockindex))
         confirmations = chainActive.Height() - blockindex->nHeight + 1;
     result.pushKV("confirmations", confirmations);
-    result.pushKV("strippedsize", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
-    result.pushKV("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    result.pushKV("strippedsize", (int)GetBlockStrippedSize(block));
+    result.pushKV("size", (int)GetBlockTotalSize(block));
     result.pushKV("weight", (int)::GetBlockWeight(block));
     result.pushKV("height", blockindex->nHeight);
     result.pushKV("version", block.nVersion);
@@ -1375,6 +1375,58 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return mempoolInfoToJSON();
 }
 
+UniValue getmempoolwithdrawals(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getmempoolwithdrawals ( count )\n"
+            "\nReturns the sidechain withdrawals in the memory pool, highest mainchain fee first.\n"
+            "\nArguments:\n"
+            "1. count       (numeric, optional, default=0) Maximum number of withdrawals to return, 0 for all\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\": \"hash\",              (string) The transaction making the withdrawal\n"
+            "    \"id\": \"hash\",                (string) The withdrawal ID\n"
+            "    \"destination\": \"address\",    (string) The mainchain destination\n"
+            "    \"refunddestination\": \"address\", (string) The sidechain refund destination\n"
+            "    \"amount\": x.xxx,              (numeric) The amount withdrawn in " + CURRENCY_UNIT + "\n"
+            "    \"mainchainfee\": x.xxx,        (numeric) The mainchain fee in " + CURRENCY_UNIT + "\n"
+            "    \"refundtxid\": \"hash\"         (string, optional) The transaction requesting a refund of the withdrawal, if any\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmempoolwithdrawals", "10")
+            + HelpExampleRpc("getmempoolwithdrawals", "10")
+        );
+
+    int nCount = 0;
+    if (!request.params[0].isNull())
+        nCount = request.params[0].get_int();
+    if (nCount < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+
+    UniValue ret(UniValue::VARR);
+    for (const CTxMemPoolSidechainEntry& withdrawal : mempool.GetWithdrawalsByMainchainFee(nCount)) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", withdrawal.txid.ToString());
+        obj.pushKV("id", withdrawal.id.ToString());
+        obj.pushKV("destination", withdrawal.strDestination);
+        obj.pushKV("refunddestination", withdrawal.strRefundDestination);
+        obj.pushKV("amount", ValueFromAmount(withdrawal.amount));
+        obj.pushKV("mainchainfee", ValueFromAmount(withdrawal.mainchainFee));
+
+        CTxMemPoolSidechainEntry refund;
+        if (mempool.GetWithdrawalRefund(withdrawal.id, refund))
+            obj.pushKV("refundtxid", refund.txid.ToString());
+
+        ret.push_back(obj);
+    }
+
+    return ret;
+}
+
 UniValue preciousblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1604,6 +1656,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"} },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        {"txid"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {} },
+    { "blockchain",         "getmempoolwithdrawals",  &getmempoolwithdrawals,  {"count"} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
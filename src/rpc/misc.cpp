@@ -10,6 +10,7 @@
 #include <core_io.h>
 #include <crypto/ripemd160.h>
 #include <init.h>
+#include <mainchainfees.h>
 #include <validation.h>
 #include <httpserver.h>
 #include <net.h>
@@ -17,6 +18,7 @@
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
+#include <script/sigcache.h>
 #include <sidechain.h>
 #include <sidechainclient.h>
 #include <timedata.h>
@@ -287,6 +289,18 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCSignatureCacheInfo()
+{
+    SignatureCacheStats stats = GetSignatureCacheStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("size", uint64_t(stats.nSize));
+    obj.pushKV("hits", stats.nHits);
+    obj.pushKV("misses", stats.nMisses);
+    obj.pushKV("inserts", stats.nInserts);
+    obj.pushKV("insert_contention", stats.nInsertContention);
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -328,6 +342,13 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"sigcache\": {             (json object) Information about the signature cache\n"
+            "    \"size\": xxxxx,          (numeric) Number of entries the cache can hold\n"
+            "    \"hits\": xxxxx,          (numeric) Number of lookups that found the signature\n"
+            "    \"misses\": xxxxx,        (numeric) Number of lookups that didn't find the signature\n"
+            "    \"inserts\": xxxxx,       (numeric) Number of signatures written to the cache\n"
+            "    \"insert_contention\": xx, (numeric) Number of times a thread had to wait for another one to write signatures\n"
             "  }\n"
             "}\n"
             "\nResult (mode \"mallocinfo\"):\n"
@@ -341,6 +362,7 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        obj.pushKV("sigcache", RPCSignatureCacheInfo());
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -545,6 +567,44 @@ UniValue refreshbmm(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue getbmmstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size())
+        throw std::runtime_error(
+            "getbmmstats\n"
+            "\nArguments: None\n"
+            "\nGet statistics of our BMM requests by amount bid.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"amount\"          (numeric) Amount bid to mainchain miners\n"
+            "    \"requests\"        (numeric) Number of BMM requests created\n"
+            "    \"included\"        (numeric) Number of BMM requests included in a mainchain block\n"
+            "    \"winrate\"         (numeric) Fraction of BMM requests included\n"
+            "    \"avglatency\"      (numeric) Average seconds from request to inclusion\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+        );
+
+    std::map<CAmount, BMMBidStats> mapStats = bmmCache.GetBMMBidStats();
+
+    UniValue result(UniValue::VARR);
+    for (const auto& s : mapStats) {
+        const BMMBidStats& stats = s.second;
+
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("amount", ValueFromAmount(s.first));
+        obj.pushKV("requests", stats.nRequest);
+        obj.pushKV("included", stats.nIncluded);
+        obj.pushKV("winrate", stats.nRequest ? (double)stats.nIncluded / stats.nRequest : 0.0);
+        obj.pushKV("avglatency", stats.nIncluded ? stats.nTotalLatency / stats.nIncluded : 0);
+        result.push_back(obj);
+    }
+
+    return result;
+}
+
 UniValue getaveragemainchainfees(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 2)
@@ -572,6 +632,43 @@ UniValue getaveragemainchainfees(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue estimatemainchainfee(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size())
+        throw std::runtime_error(
+            "estimatemainchainfee\n"
+            "\nArguments: none\n"
+            "\nEstimate the mainchain fee a new withdrawal should pay, from\n"
+            "the outcomes of recent withdrawal bundles or, without those,\n"
+            "the average mainchain fees received from the mainchain.\n"
+            "Does not contact the mainchain.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"fee\" : x.xxx,          (numeric) estimated mainchain fee per withdrawal\n"
+            "  \"source\" : \"str\",      (string) \"bundles\" or \"mainchain\"\n"
+            "  \"spentbundles\" : n,     (numeric) paid out bundles considered\n"
+            "  \"failedbundles\" : n,    (numeric) failed bundles considered\n"
+            "  \"samples\" : n           (numeric) mainchain average fee samples considered\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("estimatemainchainfee", "")
+            + HelpExampleRpc("estimatemainchainfee", "")
+        );
+
+    MainchainFeeEstimate estimate;
+    if (!mainchainFeeEstimator.EstimateFee(estimate))
+        throw JSONRPCError(RPC_MISC_ERROR, "Insufficient data to estimate mainchain fee!");
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("fee", ValueFromAmount(estimate.nFee));
+    result.pushKV("source", estimate.strSource);
+    result.pushKV("spentbundles", (uint64_t)estimate.nSpent);
+    result.pushKV("failedbundles", (uint64_t)estimate.nFailed);
+    result.pushKV("samples", (uint64_t)estimate.nSamples);
+
+    return result;
+}
+
 UniValue getmainchainblockcount(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size())
@@ -594,6 +691,57 @@ UniValue getmainchainblockcount(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue getmainchaincacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size())
+        throw std::runtime_error(
+            "getmainchaincacheinfo\n"
+            "\nArguments: None\n"
+            "\nGet statistics of the cache of mainchain replies.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"entries\"         (numeric) Number of replies cached\n"
+            "  \"maxentries\"      (numeric) Maximum number of replies cached\n"
+            "  \"hits\"            (numeric) Requests answered from the cache\n"
+            "  \"misses\"          (numeric) Cacheable requests sent to the mainchain\n"
+            "  \"hitratio\"        (numeric) Fraction of cacheable requests answered from the cache\n"
+            "  \"methods\" : {     (json object) Statistics by mainchain RPC method\n"
+            "    \"method\" : {\n"
+            "      \"hits\"        (numeric)\n"
+            "      \"misses\"      (numeric)\n"
+            "      \"hitratio\"    (numeric)\n"
+            "    }\n"
+            "    ,...\n"
+            "  }\n"
+            "}\n"
+        );
+
+    uint64_t nHits = 0;
+    uint64_t nMisses = 0;
+    UniValue methods(UniValue::VOBJ);
+    for (const auto& s : GetMainchainCacheStats()) {
+        const MainchainCacheStats& stats = s.second;
+        nHits += stats.nHits;
+        nMisses += stats.nMisses;
+
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("hits", stats.nHits);
+        obj.pushKV("misses", stats.nMisses);
+        obj.pushKV("hitratio", stats.nHits + stats.nMisses ? (double)stats.nHits / (stats.nHits + stats.nMisses) : 0.0);
+        methods.pushKV(s.first, obj);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("entries", (uint64_t)GetMainchainCacheSize());
+    result.pushKV("maxentries", (uint64_t)MAINCHAIN_CACHE_MAX_ENTRIES);
+    result.pushKV("hits", nHits);
+    result.pushKV("misses", nMisses);
+    result.pushKV("hitratio", nHits + nMisses ? (double)nHits / (nHits + nMisses) : 0.0);
+    result.pushKV("methods", methods);
+
+    return result;
+}
+
 UniValue getmainchainblockhash(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -718,7 +866,7 @@ UniValue rebroadcastwithdrawalbundle(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_MISC_ERROR, "Failed to load latest WithdrawalBundle from database");
 
     SidechainClient client;
-    std::string strHex = EncodeHexTx(withdrawalBundle.tx);
+    std::string strHex = EncodeHexTx(*withdrawalBundle.tx);
     if (!client.BroadcastWithdrawalBundle(strHex))
         throw JSONRPCError(RPC_MISC_ERROR, "Failed to broadcast latest WithdrawalBundle");
 
@@ -743,7 +891,7 @@ UniValue getwithdrawalbundle(const JSONRPCRequest& request)
     if (!psidechaintree->GetWithdrawalBundle(hashLatest, withdrawalBundle))
         throw JSONRPCError(RPC_MISC_ERROR, "Failed to load latest WithdrawalBundle from database");
 
-    return EncodeHexTx(withdrawalBundle.tx);
+    return EncodeHexTx(*withdrawalBundle.tx);
 }
 
 UniValue getwithdrawal(const JSONRPCRequest& request)
@@ -824,8 +972,11 @@ static const CRPCCommand commands[] =
     /* Sidechain RPC functions */
     { "sidechain",          "refreshbmm",                   &refreshbmm,                    {"amount", "createnew", "prevblock"}},
     { "sidechain",          "getaveragemainchainfees",      &getaveragemainchainfees,       {"blockcount", "startheight"}},
+    { "sidechain",          "estimatemainchainfee",         &estimatemainchainfee,          {}},
+    { "sidechain",          "getbmmstats",                  &getbmmstats,                   {}},
     { "sidechain",          "getmainchainblockcount",       &getmainchainblockcount,        {}},
     { "sidechain",          "getmainchainblockhash",        &getmainchainblockhash,         {"height"}},
+    { "sidechain",          "getmainchaincacheinfo",        &getmainchaincacheinfo,         {}},
     { "sidechain",          "getwithdrawalbundle",          &getwithdrawalbundle,           {}},
     { "sidechain",          "verifymainblockcache",         &verifymainblockcache,          {}},
     { "sidechain",          "updatemainblockcache",         &updatemainblockcache,          {}},
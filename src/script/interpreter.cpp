@@ -1406,7 +1406,143 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
     return true;
 }
 
+/**
+ * OP_DUP OP_HASH160 <hash> OP_EQUALVERIFY OP_CHECKSIG with vchSig and
+ * vchPubKey on the stack, as EvalScript would run it, without building a
+ * stack. scriptCode is the script the signature commits to. The result of
+ * the OP_CHECKSIG is returned in fSuccess.
+ */
+static bool EvalPayToPubKeyHash(const valtype& vchSig, const valtype& vchPubKey, const unsigned char* hash, const CScript& scriptCode, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, bool& fSuccess, ScriptError* serror)
+{
+    unsigned char hashPubKey[CHash160::OUTPUT_SIZE];
+    CHash160().Write(vchPubKey.data(), vchPubKey.size()).Finalize(hashPubKey);
+    if (memcmp(hashPubKey, hash, sizeof(hashPubKey)) != 0)
+        return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+
+    if (!CheckSignatureEncoding(vchSig, flags, serror) || !CheckPubKeyEncoding(vchPubKey, flags, sigversion, serror)) {
+        //serror is set
+        return false;
+    }
+    fSuccess = checker.CheckSig(vchSig, vchPubKey, scriptCode, sigversion);
+
+    if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size())
+        return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
+    return true;
+}
+
+/**
+ * Fast path for a P2PKH scriptPubKey spent by a scriptSig of two direct
+ * pushes. Returns false if the scripts are not in this form and have to go
+ * through the generic interpreter, otherwise the result of VerifyScript is
+ * returned in fResult.
+ */
+static bool VerifyPayToPubKeyHash(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, bool& fResult, ScriptError* serror)
+{
+    if (scriptPubKey.size() != 25 || scriptPubKey[0] != OP_DUP || scriptPubKey[1] != OP_HASH160 || scriptPubKey[2] != 20 ||
+            scriptPubKey[23] != OP_EQUALVERIFY || scriptPubKey[24] != OP_CHECKSIG)
+        return false;
+
+    // Only direct pushes of 2 to 75 bytes, which are always minimal pushes
+    if (scriptSig.size() < 1 || scriptSig[0] < 2 || scriptSig[0] > 75)
+        return false;
+    const size_t nSigSize = scriptSig[0];
+    if (scriptSig.size() < nSigSize + 2 || scriptSig[nSigSize + 1] < 2 || scriptSig[nSigSize + 1] > 75)
+        return false;
+    const size_t nPubKeySize = scriptSig[nSigSize + 1];
+    if (scriptSig.size() != nSigSize + nPubKeySize + 2)
+        return false;
+
+    const valtype vchSig(scriptSig.begin() + 1, scriptSig.begin() + 1 + nSigSize);
+    const valtype vchPubKey(scriptSig.begin() + 2 + nSigSize, scriptSig.end());
+
+    // Drop the signature in pre-segwit scripts
+    CScript scriptCode(scriptPubKey);
+    scriptCode.FindAndDelete(CScript(vchSig));
+
+    bool fSuccess = false;
+    if (!EvalPayToPubKeyHash(vchSig, vchPubKey, &scriptPubKey[3], scriptCode, flags, checker, SIGVERSION_BASE, fSuccess, serror)) {
+        fResult = false;
+        return true;
+    }
+    if (!fSuccess) {
+        fResult = set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+        return true;
+    }
+
+    // Not P2SH or a witness program, and the stack is clean
+    if ((flags & SCRIPT_VERIFY_WITNESS) && !witness.IsNull()) {
+        fResult = set_error(serror, SCRIPT_ERR_WITNESS_UNEXPECTED);
+        return true;
+    }
+
+    fResult = set_success(serror);
+    return true;
+}
+
+/**
+ * Fast path for a P2WPKH scriptPubKey. Returns false if the scripts are not
+ * in this form and have to go through the generic interpreter, otherwise
+ * the result of VerifyScript is returned in fResult.
+ */
+static bool VerifyPayToWitnessPubKeyHash(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, bool& fResult, ScriptError* serror)
+{
+    if (!(flags & SCRIPT_VERIFY_WITNESS) || !scriptSig.empty())
+        return false;
+    if (scriptPubKey.size() != 22 || scriptPubKey[0] != OP_0 || scriptPubKey[1] != 20)
+        return false;
+
+    // The program is left on top of the stack by the scriptPubKey
+    const valtype program(scriptPubKey.begin() + 2, scriptPubKey.end());
+    if (!CastToBool(program)) {
+        fResult = set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+        return true;
+    }
+
+    if (witness.stack.size() != 2) {
+        fResult = set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_MISMATCH);
+        return true;
+    }
+    const valtype& vchSig = witness.stack[0];
+    const valtype& vchPubKey = witness.stack[1];
+    if (vchSig.size() > MAX_SCRIPT_ELEMENT_SIZE || vchPubKey.size() > MAX_SCRIPT_ELEMENT_SIZE) {
+        fResult = set_error(serror, SCRIPT_ERR_PUSH_SIZE);
+        return true;
+    }
+
+    CScript scriptCode;
+    scriptCode << OP_DUP << OP_HASH160 << program << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    bool fSuccess = false;
+    if (!EvalPayToPubKeyHash(vchSig, vchPubKey, program.data(), scriptCode, flags, checker, SIGVERSION_WITNESS_V0, fSuccess, serror)) {
+        fResult = false;
+        return true;
+    }
+    if (!fSuccess) {
+        fResult = set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+        return true;
+    }
+
+    fResult = set_success(serror);
+    return true;
+}
+
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    static const CScriptWitness emptyWitness;
+    if (witness == nullptr) {
+        witness = &emptyWitness;
+    }
+
+    // Almost all inputs spend one of these, skip the generic interpreter
+    bool fResult;
+    if (VerifyPayToPubKeyHash(scriptSig, scriptPubKey, *witness, flags, checker, fResult, serror) ||
+            VerifyPayToWitnessPubKeyHash(scriptSig, scriptPubKey, *witness, flags, checker, fResult, serror))
+        return fResult;
+
+    return VerifyScriptGeneric(scriptSig, scriptPubKey, witness, flags, checker, serror);
+}
+
+bool VerifyScriptGeneric(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
 {
     static const CScriptWitness emptyWitness;
     if (witness == nullptr) {
@@ -11,26 +11,101 @@
 #include <uint256.h>
 #include <util.h>
 
-#include <cuckoocache.h>
-#include <boost/thread.hpp>
+#include <crypto/common.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
 
 namespace {
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * Lookups don't take a lock. An entry can be in one of eight slots picked by
+ * its hash, and every slot has a sequence number that is odd while the slot
+ * is being written, so a lookup that races with a write misses instead of
+ * seeing a torn entry. Inserts are buffered per thread and written in bulk,
+ * one thread at a time. Lookups don't search the buffer, the owner flushes
+ * it at the end of each batch of checks.
  */
 class CSignatureCache
 {
+public:
+    struct Slot
+    {
+        //! Zero while the slot is empty, odd while it is being written
+        std::atomic<uint32_t> seq;
+        //! Set when the entry has been used by a block and may be replaced
+        std::atomic<bool> collectable;
+        std::atomic<uint32_t> entry[8];
+    };
+
 private:
      //! Entries are SHA256(nonce || signature hash || public key || signature):
     uint256 nonce;
-    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
+    std::unique_ptr<Slot[]> table;
+    uint32_t nSlots;
+
+    //! Serializes writers
+    std::mutex cs_insert;
+    //! Which candidate slot to replace next when none is free
+    uint32_t nEvict;
+
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+    std::atomic<uint64_t> nInserts;
+    std::atomic<uint64_t> nInsertContention;
+
+    Slot& GetSlot(const uint256& entry, int i) const
+    {
+        // Entries are random, so their words are used as the hashes
+        return table[((uint64_t)ReadLE32(entry.begin() + 4 * i) * nSlots) >> 32];
+    }
+
+    static bool Matches(const Slot& slot, const uint256& entry)
+    {
+        const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq == 0 || (seq & 1))
+            return false;
+        bool fMatch = true;
+        for (int i = 0; i < 8; i++)
+            fMatch &= slot.entry[i].load(std::memory_order_relaxed) == ReadLE32(entry.begin() + 4 * i);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return fMatch && slot.seq.load(std::memory_order_relaxed) == seq;
+    }
+
+    void Insert(const uint256& entry)
+    {
+        Slot* pslot = nullptr;
+        for (int i = 0; i < 8; i++) {
+            Slot& slot = GetSlot(entry, i);
+            if (Matches(slot, entry))
+                return;
+            if (!pslot && (slot.seq.load(std::memory_order_relaxed) == 0 || slot.collectable.load(std::memory_order_relaxed)))
+                pslot = &slot;
+        }
+        if (!pslot)
+            pslot = &GetSlot(entry, nEvict++ % 8);
+
+        const uint32_t seq = pslot->seq.load(std::memory_order_relaxed);
+        pslot->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < 8; i++)
+            pslot->entry[i].store(ReadLE32(entry.begin() + 4 * i), std::memory_order_relaxed);
+        pslot->collectable.store(false, std::memory_order_relaxed);
+        pslot->seq.store(seq + 2, std::memory_order_release);
+    }
+
+#ifdef HAVE_THREAD_LOCAL
+    //! Entries stored by this thread that haven't been written yet
+    static thread_local std::vector<uint256> vInsertBuffer;
+#endif
 
 public:
-    CSignatureCache()
+    CSignatureCache() : nSlots(0), nEvict(0), nHits(0), nMisses(0), nInserts(0), nInsertContention(0)
     {
         GetRandBytes(nonce.begin(), 32);
     }
@@ -44,21 +119,83 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        for (int i = 0; i < 8; i++) {
+            Slot& slot = GetSlot(entry, i);
+            if (Matches(slot, entry)) {
+                if (erase)
+                    slot.collectable.store(true, std::memory_order_relaxed);
+                nHits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        nMisses.fetch_add(1, std::memory_order_relaxed);
+        return false;
     }
 
     void Set(uint256& entry)
     {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
+#ifdef HAVE_THREAD_LOCAL
+        vInsertBuffer.push_back(entry);
+        if (vInsertBuffer.size() >= SIGNATURE_CACHE_INSERT_BUFFER)
+            Flush();
+#else
+        std::unique_lock<std::mutex> lock(cs_insert, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            nInsertContention.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+        Insert(entry);
+        nInserts.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    void Flush()
+    {
+#ifdef HAVE_THREAD_LOCAL
+        if (vInsertBuffer.empty())
+            return;
+        std::unique_lock<std::mutex> lock(cs_insert, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            nInsertContention.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+        for (const uint256& entry : vInsertBuffer)
+            Insert(entry);
+        nInserts.fetch_add(vInsertBuffer.size(), std::memory_order_relaxed);
+        vInsertBuffer.clear();
+#endif
+    }
+
+    SignatureCacheStats GetStats() const
+    {
+        SignatureCacheStats stats;
+        stats.nSize = nSlots;
+        stats.nHits = nHits.load(std::memory_order_relaxed);
+        stats.nMisses = nMisses.load(std::memory_order_relaxed);
+        stats.nInserts = nInserts.load(std::memory_order_relaxed);
+        stats.nInsertContention = nInsertContention.load(std::memory_order_relaxed);
+        return stats;
     }
+
     uint32_t setup_bytes(size_t n)
     {
-        return setValid.setup_bytes(n);
+        std::unique_lock<std::mutex> lock(cs_insert);
+        nSlots = std::max<size_t>(2, std::min<size_t>(n / sizeof(Slot), std::numeric_limits<uint32_t>::max()));
+        table.reset(new Slot[nSlots]);
+        for (uint32_t i = 0; i < nSlots; i++) {
+            table[i].seq.store(0, std::memory_order_relaxed);
+            table[i].collectable.store(false, std::memory_order_relaxed);
+            for (int j = 0; j < 8; j++)
+                table[i].entry[j].store(0, std::memory_order_relaxed);
+        }
+        return nSlots;
     }
 };
 
+#ifdef HAVE_THREAD_LOCAL
+thread_local std::vector<uint256> CSignatureCache::vInsertBuffer;
+#endif
+
 /* In previous versions of this code, signatureCache was a local static variable
  * in CachingTransactionSignatureChecker::VerifySignature.  We initialize
  * signatureCache outside of VerifySignature to avoid the atomic operation per
@@ -77,7 +214,17 @@ void InitSignatureCache()
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
     size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
     LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu elements\n",
-            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
+            (nElems*sizeof(CSignatureCache::Slot)) >>20, (nMaxCacheSize*2)>>20, nElems);
+}
+
+void FlushSignatureCache()
+{
+    signatureCache.Flush();
+}
+
+SignatureCacheStats GetSignatureCacheStats()
+{
+    return signatureCache.GetStats();
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
@@ -92,3 +239,12 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsig
         signatureCache.Set(entry);
     return true;
 }
+
+bool BatchingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+{
+    uint256 entry;
+    signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
+    if (signatureCache.Get(entry, true))
+        return true;
+    return batch.Add(pubkey, sighash, vchSig);
+}
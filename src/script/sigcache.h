@@ -16,8 +16,11 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+// Number of entries a thread stores before they are written to the cache
+static const size_t SIGNATURE_CACHE_INSERT_BUFFER = 64;
 
 class CPubKey;
+class CSignatureBatch;
 
 /**
  * We're hashing a nonce into the entries themselves, so we don't need extra
@@ -51,6 +54,44 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
 
+/**
+ * Signature checker that adds the signatures which are not in the cache to
+ * a batch instead of verifying them, and treats them as valid. The batch
+ * has to be verified afterwards, and the script evaluated again with a
+ * CachingTransactionSignatureChecker if it fails (it may rely on a
+ * signature being invalid) or if the batch doesn't verify. Nothing is
+ * stored in the cache.
+ */
+class BatchingTransactionSignatureChecker : public CachingTransactionSignatureChecker
+{
+private:
+    CSignatureBatch& batch;
+
+public:
+    BatchingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, PrecomputedTransactionData& txdataIn, CSignatureBatch& batchIn) : CachingTransactionSignatureChecker(txToIn, nInIn, amountIn, false, txdataIn), batch(batchIn) {}
+
+    bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
+};
+
 void InitSignatureCache();
 
+/**
+ * Write the signatures stored by this thread to the signature cache, so
+ * that they can be found. This happens by itself every
+ * SIGNATURE_CACHE_INSERT_BUFFER signatures, and has to be done before a
+ * thread that stored signatures waits or exits.
+ */
+void FlushSignatureCache();
+
+struct SignatureCacheStats
+{
+    uint32_t nSize;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nInserts;
+    uint64_t nInsertContention; // Inserts that had to wait for another thread
+};
+
+SignatureCacheStats GetSignatureCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -73,7 +73,7 @@ std::string SidechainWithdrawalBundle::ToString() const
     std::stringstream str;
     str << "sidechainop=" << sidechainop << std::endl;
     str << "nSidechain=" << std::to_string(nSidechain) << std::endl;
-    str << "tx=" << CTransaction(tx).ToString() << std::endl;
+    str << "tx=" << tx->ToString() << std::endl;
     str << "status=" << GetStatusStr() << std::endl;
     return str.str();
 }
@@ -101,12 +101,12 @@ std::string SidechainDeposit::ToString() const
     str << "nSidechain=" << std::to_string(nSidechain) << std::endl;
     str << "strDest=" << strDest << std::endl;
     str << "payout=" << FormatMoney(amtUserPayout) << std::endl;
-    str << "mainchaintxid=" << dtx.GetHash().ToString() << std::endl;
+    str << "mainchaintxid=" << dtx->GetHash().ToString() << std::endl;
     str << "nBurnIndex=" << std::to_string(nBurnIndex) << std::endl;
     str << "nTx=" << std::to_string(nTx) << std::endl;
     str << "hashMainchainBlock=" << hashMainchainBlock.ToString() << std::endl;
     str << "inputs:\n";
-    for (const CTxIn& in : dtx.vin) {
+    for (const CTxIn& in : dtx->vin) {
         str << in.prevout.ToString() << std::endl;
     }
     return str.str();
@@ -86,6 +86,12 @@ static const std::string feeKey = "5f8f196a4f0c212fee1b4eda31e3ef383c52d9fc";
 //! The default payment amount to mainchain miner for critical data commitment
 static const CAmount DEFAULT_CRITICAL_DATA_AMOUNT = 0.0001 * COIN;
 
+//! The default number of BMM requests to create for each mainchain tip
+static const int DEFAULT_BMM_REQUESTS = 1;
+
+//! The default bid increase for each additional BMM request for a mainchain tip
+static const CAmount DEFAULT_BMM_BID_INCREMENT = 0.00005 * COIN;
+
 //! The fee for sidechain deposits on this sidechain
 static const CAmount SIDECHAIN_DEPOSIT_FEE = 0.00001 * COIN;
 
@@ -151,7 +157,7 @@ struct SidechainWithdrawal: public SidechainObj {
  */
 struct SidechainWithdrawalBundle: public SidechainObj {
     uint8_t nSidechain;
-    CMutableTransaction tx;
+    CTransactionRef tx;
     std::vector<uint256> vWithdrawalID; // The id in ldb of bundle's withdrawals
     int nHeight;
     // If the bundle fails we keep track of the sidechain height that it was
@@ -160,7 +166,7 @@ struct SidechainWithdrawalBundle: public SidechainObj {
     int nFailHeight;
     char status;
 
-    SidechainWithdrawalBundle(void) : SidechainObj() { sidechainop = DB_SIDECHAIN_WITHDRAWAL_BUNDLE_OP; status = WITHDRAWAL_BUNDLE_CREATED; nHeight = 0;}
+    SidechainWithdrawalBundle(void) : SidechainObj() { sidechainop = DB_SIDECHAIN_WITHDRAWAL_BUNDLE_OP; tx = MakeTransactionRef(); status = WITHDRAWAL_BUNDLE_CREATED; nHeight = 0;}
     virtual ~SidechainWithdrawalBundle(void) { }
 
     ADD_SERIALIZE_METHODS
@@ -196,12 +202,12 @@ struct SidechainDeposit : public SidechainObj {
     uint8_t nSidechain;
     std::string strDest;
     CAmount amtUserPayout;
-    CMutableTransaction dtx; // Mainchain deposit transaction
+    CTransactionRef dtx; // Mainchain deposit transaction
     uint32_t nBurnIndex; // Deposit burn output index
     uint32_t nTx; // Deposit transaction number in mainchain block
     uint256 hashMainchainBlock;
 
-    SidechainDeposit(void) : SidechainObj() { sidechainop = DB_SIDECHAIN_DEPOSIT_OP; }
+    SidechainDeposit(void) : SidechainObj() { sidechainop = DB_SIDECHAIN_DEPOSIT_OP; dtx = MakeTransactionRef(); }
     virtual ~SidechainDeposit(void) { }
 
     SidechainDeposit(const SidechainDeposit* d) {
@@ -237,7 +243,7 @@ struct SidechainDeposit : public SidechainObj {
                 nSidechain == d.nSidechain &&
                 strDest == d.strDest &&
                 amtUserPayout == d.amtUserPayout &&
-                dtx == d.dtx &&
+                *dtx == *d.dtx &&
                 nBurnIndex == d.nBurnIndex &&
                 nTx == d.nTx &&
                 hashMainchainBlock == d.hashMainchainBlock) {
@@ -7,6 +7,7 @@
 #include <bmmcache.h>
 #include <chainparams.h>
 #include <core_io.h>
+#include <mainchainfees.h>
 #include <miner.h>
 #include <sidechain.h>
 #include <streams.h>
@@ -15,11 +16,17 @@
 #include <utilmoneystr.h>
 #include <utilstrencodings.h>
 #include <util.h>
+#include <validation.h>
 
+#include <fstream>
 #include <iostream>
+#include <list>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <stdlib.h>
 #include <string>
+#include <unordered_map>
 
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
@@ -27,7 +34,168 @@
 
 using boost::asio::ip::tcp;
 
-SidechainClient::SidechainClient()
+static std::mutex mainchainRequestHandlerMutex;
+static MainchainRequestHandler mainchainRequestHandler;
+
+void SetMainchainRequestHandler(MainchainRequestHandler handler)
+{
+    std::lock_guard<std::mutex> lock(mainchainRequestHandlerMutex);
+    mainchainRequestHandler = std::move(handler);
+
+    // The replies came from a different mainchain
+    ClearMainchainCache();
+}
+
+/**
+ * Mainchain replies, most recently used first. SidechainClient objects are
+ * short lived, so the cache is shared.
+ *
+ * A reply is either valid for a mainchain tip until it expires, or is about
+ * a mainchain block and valid until that block is disconnected.
+ */
+class MainchainReplyCache
+{
+public:
+    bool Lookup(const std::string& strMethod, const std::string& strRequest, const uint256& hashTip, boost::property_tree::ptree& reply)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+
+        auto it = mapEntry.find(strRequest);
+        if (it != mapEntry.end()) {
+            const Entry& entry = *it->second;
+            if (!entry.hashBlock.IsNull() || (entry.hashTip == hashTip && GetTime() < entry.nExpire)) {
+                listEntry.splice(listEntry.begin(), listEntry, it->second);
+                reply = entry.reply;
+                mapStats[strMethod].nHits++;
+                return true;
+            }
+            // Stale, the tip changed or the reply expired
+            listEntry.erase(it->second);
+            mapEntry.erase(it);
+        }
+        mapStats[strMethod].nMisses++;
+        return false;
+    }
+
+    void Insert(const std::string& strMethod, const std::string& strRequest, const uint256& hashTip, const uint256& hashBlock, int64_t nExpire, const boost::property_tree::ptree& reply)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+
+        auto it = mapEntry.find(strRequest);
+        if (it != mapEntry.end()) {
+            listEntry.erase(it->second);
+            mapEntry.erase(it);
+        }
+
+        listEntry.push_front(Entry{strMethod, strRequest, hashTip, hashBlock, nExpire, reply});
+        mapEntry.emplace(strRequest, listEntry.begin());
+
+        while (listEntry.size() > MAINCHAIN_CACHE_MAX_ENTRIES) {
+            mapEntry.erase(listEntry.back().strRequest);
+            listEntry.pop_back();
+        }
+    }
+
+    /** Count a strMethod lookup answered somewhere else, e.g. bmmCache */
+    void RecordLookup(const std::string& strMethod, bool fHit)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (fHit)
+            mapStats[strMethod].nHits++;
+        else
+            mapStats[strMethod].nMisses++;
+    }
+
+    /** Remove the replies to strMethod requests */
+    void EraseMethod(const std::string& strMethod)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+
+        for (auto it = listEntry.begin(); it != listEntry.end();) {
+            if (it->strMethod == strMethod) {
+                mapEntry.erase(it->strRequest);
+                it = listEntry.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    /** Remove the replies about the blocks in vHashBlock */
+    void EraseBlocks(const std::vector<uint256>& vHashBlock)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+
+        std::set<uint256> setHashBlock(vHashBlock.begin(), vHashBlock.end());
+        for (auto it = listEntry.begin(); it != listEntry.end();) {
+            if (!it->hashBlock.IsNull() && setHashBlock.count(it->hashBlock)) {
+                mapEntry.erase(it->strRequest);
+                it = listEntry.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        listEntry.clear();
+        mapEntry.clear();
+    }
+
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        return listEntry.size();
+    }
+
+    std::map<std::string, MainchainCacheStats> GetStats() const
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        return mapStats;
+    }
+
+private:
+    struct Entry
+    {
+        std::string strMethod;
+        std::string strRequest;
+        uint256 hashTip; // Null for replies about a block
+        uint256 hashBlock; // Null for replies valid for a tip
+        int64_t nExpire;
+        boost::property_tree::ptree reply;
+    };
+
+    mutable std::mutex cs;
+    std::list<Entry> listEntry;
+    std::unordered_map<std::string, std::list<Entry>::iterator> mapEntry;
+    std::map<std::string, MainchainCacheStats> mapStats;
+};
+
+static MainchainReplyCache mainchainReplyCache;
+
+std::map<std::string, MainchainCacheStats> GetMainchainCacheStats()
+{
+    return mainchainReplyCache.GetStats();
+}
+
+size_t GetMainchainCacheSize()
+{
+    return mainchainReplyCache.Size();
+}
+
+void ClearMainchainCache()
+{
+    mainchainReplyCache.Clear();
+}
+
+void EraseMainchainBlockReplies(const std::vector<uint256>& vHashBlock)
+{
+    mainchainReplyCache.EraseBlocks(vHashBlock);
+}
+
+SidechainClient::SidechainClient(bool fUseCacheIn) : fUseCache(fUseCacheIn)
 {
 
 }
@@ -47,7 +215,13 @@ bool SidechainClient::BroadcastWithdrawalBundle(const std::string& hex)
     // TODO Read result
     // the mainchain will return the txid if WithdrawalBundle has been received
     boost::property_tree::ptree ptree;
-    return SendRequestToMainchain(json, ptree);
+    if (!SendRequestToMainchain(json, ptree))
+        return false;
+
+    // The mainchain lists the new bundle right away
+    mainchainReplyCache.EraseMethod("listwithdrawalstatus");
+
+    return true;
 }
 
 // TODO return bool & state / fail string
@@ -114,8 +288,10 @@ std::vector<SidechainDeposit> SidechainClient::UpdateDeposits(const uint256& has
                     continue;
                 if (!IsHex(data))
                     continue;
-                if (!DecodeHexTx(deposit.dtx, data))
+                CMutableTransaction mtx;
+                if (!DecodeHexTx(mtx, data))
                     continue;
+                deposit.dtx = MakeTransactionRef(std::move(mtx));
             }
             else
             if (v.first == "nburnindex") {
@@ -146,7 +322,7 @@ std::vector<SidechainDeposit> SidechainClient::UpdateDeposits(const uint256& has
             }
         }
 
-        if (deposit.nBurnIndex >= deposit.dtx.vout.size()) {
+        if (deposit.nBurnIndex >= deposit.dtx->vout.size()) {
             LogPrintf("%s: Error invalid deposit output index!\n", __func__);
             continue;
         }
@@ -154,7 +330,7 @@ std::vector<SidechainDeposit> SidechainClient::UpdateDeposits(const uint256& has
         // Get the user payout amount from the deposit output. At this point the
         // amount is the total CTIP, and the real payout will be calculated
         // later.
-        deposit.amtUserPayout = deposit.dtx.vout[deposit.nBurnIndex].nValue;
+        deposit.amtUserPayout = deposit.dtx->vout[deposit.nBurnIndex].nValue;
 
         // Add this deposit to the list
         incoming.push_back(deposit);
@@ -185,7 +361,7 @@ bool SidechainClient::VerifyDeposit(const uint256& hashMainBlock, const uint256&
 
     // Ask mainchain node to verify deposit
     boost::property_tree::ptree ptree;
-    if (!SendRequestToMainchain(json, ptree)) {
+    if (!SendCachedBlockRequestToMainchain("verifydeposit", json, hashMainBlock, ptree)) {
         // Can be enabled for debug -- too noisy
         // LogPrintf("ERROR Sidechain client failed to verify deposit!\n");
         return false;
@@ -212,7 +388,7 @@ bool SidechainClient::VerifyBMM(const uint256& hashMainBlock, const uint256& has
 
     // Try to request BMM proof from mainchain
     boost::property_tree::ptree ptree;
-    if (!SendRequestToMainchain(json, ptree)) {
+    if (!SendCachedBlockRequestToMainchain("verifybmm", json, hashMainBlock, ptree)) {
         // Can be enabled for debug -- too noisy
         // LogPrintf("ERROR Sidechain client failed to request BMM proof\n");
         return false;
@@ -385,17 +561,14 @@ bool SidechainClient::RefreshBMM(const CAmount& amount, std::string& strError, u
         return false;
     }
 
+    const uint256& hashMainTip = vHashMainBlock.back();
+
     // Get our cached BMM blocks
     std::vector<CBlock> vBMMCache = bmmCache.GetBMMBlockCache();
 
     // If we don't have any existing BMM requests cached, create our first
     if (vBMMCache.empty() && fCreateNew) {
-        CBlock block;
-        if (CreateBMMBlock(block, strError, nFees, hashPrevBlock)) {
-            nTxn = block.vtx.size();
-            hashCreatedMerkleRoot = block.hashMerkleRoot;
-            txid = SendBMMRequest(block.hashMerkleRoot, vHashMainBlock.back(), 0, amount);
-            bmmCache.StorePrevBlockBMMCreated(vHashMainBlock.back());
+        if (CreateBMMRequest(amount, hashMainTip, strError, hashCreatedMerkleRoot, txid, nTxn, nFees, hashPrevBlock)) {
             return true;
         } else {
             strError = "Failed to create new BMM block!";
@@ -409,13 +582,14 @@ bool SidechainClient::RefreshBMM(const CAmount& amount, std::string& strError, u
         if (bmmCache.MainBlockChecked(u))
             continue;
 
-        // Check main:block for any of our current BMM requests
+        // Check main:block for any of our current BMM requests. Only one BMM
+        // commit per sidechain can be included in a mainchain block.
         for (const CBlock& b : vBMMCache) {
             // Send 'verifybmm' rpc request to mainchain
             const uint256& hashMerkleRoot = b.hashMerkleRoot;
-            uint256 txid;
+            uint256 txidBMM;
             uint32_t nTime = 0;
-            if (VerifyBMM(u, hashMerkleRoot, txid, nTime)) {
+            if (VerifyBMM(u, hashMerkleRoot, txidBMM, nTime)) {
                 CBlock block = b;
 
                 // Copy the block time and hash from the mainchain block into
@@ -427,10 +601,12 @@ bool SidechainClient::RefreshBMM(const CAmount& amount, std::string& strError, u
                 if (SubmitBMMBlock(block)) {
                     hashConnected = block.GetHash();
                     hashConnectedMerkleRoot = hashMerkleRoot;
+                    bmmCache.RecordBMMIncluded(txidBMM, nTime);
                 } else {
                     strError = "Failed to submit block with valid BMM!";
                     return false;
                 }
+                break;
             }
         }
 
@@ -439,45 +615,101 @@ bool SidechainClient::RefreshBMM(const CAmount& amount, std::string& strError, u
     }
 
     // Was there a new mainchain block since the last request we made?
-    if (!bmmCache.HaveBMMRequestForPrevBlock(vHashMainBlock.back())) {
+    if (!bmmCache.HaveBMMRequestForPrevBlock(hashMainTip)) {
         // Clear out the bmm cache, the old requests are invalid now as they
         // were created for the old mainchain tip.
         bmmCache.ClearBMMBlocks();
 
         // Create a new BMM request
-        if (fCreateNew) {
-            CBlock block;
-            if (CreateBMMBlock(block, strError, nFees, hashPrevBlock)) {
-                // Send BMM request to mainchain
-                nTxn = block.vtx.size();
-                hashCreatedMerkleRoot = block.hashMerkleRoot;
-                txid = SendBMMRequest(block.hashMerkleRoot, vHashMainBlock.back(), 0, amount);
-                bmmCache.StorePrevBlockBMMCreated(vHashMainBlock.back());
-            } else {
-                strError = "Failed to create a new BMM request!";
+        if (fCreateNew && !CreateBMMRequest(amount, hashMainTip, strError, hashCreatedMerkleRoot, txid, nTxn, nFees, hashPrevBlock)) {
+            strError = "Failed to create a new BMM request!";
+            return false;
+        }
+    } else if (fCreateNew) {
+        // Keep up to -bmmrequests candidate BMM blocks for the mainchain tip,
+        // each additional request bids more than the last.
+        int nMaxRequest = gArgs.GetArg("-bmmrequests", DEFAULT_BMM_REQUESTS);
+        int nRequest = bmmCache.GetBMMRequestCount(hashMainTip);
+        if (nRequest > 0 && nRequest < nMaxRequest) {
+            CAmount nBidIncrement = DEFAULT_BMM_BID_INCREMENT;
+            if (gArgs.IsArgSet("-bmmbidincrement") &&
+                    !ParseMoney(gArgs.GetArg("-bmmbidincrement", ""), nBidIncrement)) {
+                strError = strprintf("Invalid amount for -bmmbidincrement=<amount>: '%s'", gArgs.GetArg("-bmmbidincrement", ""));
                 return false;
             }
-        }
-    } else {
-        if (fCreateNew)
+
+            CAmount nBid = amount + nRequest * nBidIncrement;
+            if (!CreateBMMRequest(nBid, hashMainTip, strError, hashCreatedMerkleRoot, txid, nTxn, nFees, hashPrevBlock)) {
+                strError = "Failed to create an additional BMM request!";
+                return false;
+            }
+        } else {
             strError = "Can't create new BMM request - already created for mainchain tip!";
+        }
     }
 
     return true;
 }
 
+bool SidechainClient::CreateBMMRequest(const CAmount& amount, const uint256& hashMainTip, std::string& strError, uint256& hashCreatedMerkleRoot, uint256& txid, int& nTxn, CAmount& nFees, const uint256& hashPrevBlock)
+{
+    CBlock block;
+    bool fCached = false;
+    if (!GenerateBMMBlock(block, strError, nFees, hashPrevBlock, fCached))
+        return false;
+
+    // The block may already be cached if the mempool hasn't changed since
+    // our last request, in which case this is a new bid for the same block.
+    if (fCached)
+        LogPrintf("%s: Bidding again for cached BMM block: %s\n", __func__, block.hashMerkleRoot.ToString());
+
+    nTxn = block.vtx.size();
+    hashCreatedMerkleRoot = block.hashMerkleRoot;
+
+    // Send BMM request to mainchain
+    txid = SendBMMRequest(block.hashMerkleRoot, hashMainTip, 0, amount);
+    bmmCache.StorePrevBlockBMMCreated(hashMainTip);
+
+    if (!txid.IsNull())
+        bmmCache.StoreBMMRequest(txid, block.hashMerkleRoot, hashMainTip, amount, GetTime());
+
+    return true;
+}
+
 bool SidechainClient::CreateBMMBlock(CBlock& block, std::string& strError, CAmount& nFees, const uint256& hashPrevBlock)
+{
+    bool fCached = false;
+    if (!GenerateBMMBlock(block, strError, nFees, hashPrevBlock, fCached))
+        return false;
+
+    if (fCached) {
+        // Failed to store BMM candidate block
+        strError = "Failed to store BMM block!\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool SidechainClient::GenerateBMMBlock(CBlock& block, std::string& strError, CAmount& nFees, const uint256& hashPrevBlock, bool& fCached)
 {
     if (!BlockAssembler(Params()).GenerateBMMBlock(block, strError, &nFees,
                 std::vector<CMutableTransaction>(), hashPrevBlock)) {
         return false;
     }
 
-    if (!bmmCache.StoreBMMBlock(block)) {
-        // Failed to store BMM candidate block
+    if (bmmCache.StoreBMMBlock(block)) {
+        fCached = false;
+        return true;
+    }
+
+    // StoreBMMBlock only fails for a block we already have cached
+    CBlock blockCached;
+    if (!bmmCache.GetBMMBlock(block.hashMerkleRoot, blockCached)) {
         strError = "Failed to store BMM block!\n";
         return false;
     }
+    fCached = true;
 
     return true;
 }
@@ -503,7 +735,7 @@ bool SidechainClient::GetAverageFees(int nBlocks, int nStartHeight, CAmount& nAv
 
     // Try to request average fees from mainchain
     boost::property_tree::ptree ptree;
-    if (!SendRequestToMainchain(json, ptree)) {
+    if (!SendCachedRequestToMainchain("getaveragefee", json, ptree)) {
         LogPrintf("ERROR Sidechain client failed to request average fees\n");
         return false;
     }
@@ -521,6 +753,12 @@ bool SidechainClient::GetAverageFees(int nBlocks, int nStartHeight, CAmount& nAv
 
             if (ParseMoney(data, nAverageFee)) {
                 LogPrintf("Sidechain client received average mainchain fee: %d.\n", nAverageFee);
+
+                // Fees up to the current mainchain tip are a sample for the
+                // local mainchain fee estimate
+                if (nStartHeight == 0)
+                    mainchainFeeEstimator.AddMainchainFeeSample(bmmCache.GetLastMainBlockHash(), nAverageFee);
+
                 return true;
             }
         }
@@ -564,7 +802,7 @@ bool SidechainClient::GetWorkScore(const uint256& hash, int& nWorkScore)
     json.append("] }");
 
     boost::property_tree::ptree ptree;
-    if (!SendRequestToMainchain(json, ptree)) {
+    if (!SendCachedRequestToMainchain("getworkscore", json, ptree)) {
         LogPrintf("ERROR Sidechain client failed to request workscore\n");
         return false;
     }
@@ -590,7 +828,7 @@ bool SidechainClient::ListWithdrawalBundleStatus(std::vector<uint256>& vHashWith
     json.append("] }");
 
     boost::property_tree::ptree ptree;
-    if (!SendRequestToMainchain(json, ptree)) {
+    if (!SendCachedRequestToMainchain("listwithdrawalstatus", json, ptree)) {
         LogPrintf("ERROR Sidechain client failed to request WithdrawalBundle status\n");
         return false;
     }
@@ -617,6 +855,14 @@ bool SidechainClient::ListWithdrawalBundleStatus(std::vector<uint256>& vHashWith
 
 bool SidechainClient::GetBlockHash(int nHeight, uint256& hashBlock)
 {
+    // The main block hash cache has the hashes of the blocks up to the tip
+    if (fUseCache) {
+        bool fHit = bmmCache.GetMainBlockHash(nHeight, hashBlock);
+        mainchainReplyCache.RecordLookup("getblockhash", fHit);
+        if (fHit)
+            return true;
+    }
+
     // JSON for 'getblockhash' mainchain HTTP-RPC
     std::string json;
     json.append("{\"jsonrpc\": \"1.0\", \"id\":\"SidechainClient\", ");
@@ -690,25 +936,202 @@ bool SidechainClient::HaveFailedWithdrawalBundle(const uint256& hash)
     return fFailed;
 }
 
+/** Cached contents of the mainchain auth cookie file */
+static std::mutex mainchainCookieMutex;
+static std::string strMainchainCookie;
+
+/**
+ * Get the user:password for the mainchain RPC server. The cookie file of the
+ * mainchain node is preferred, then -mainchainrpcuser and finally our own
+ * -rpcuser, which used to be the only option.
+ */
+static bool GetMainchainAuth(std::string& strAuth)
+{
+    const std::string strPath = gArgs.GetArg("-mainchainrpccookiefile", "");
+    if (!strPath.empty()) {
+        std::lock_guard<std::mutex> lock(mainchainCookieMutex);
+        if (strMainchainCookie.empty()) {
+            std::ifstream file(strPath.c_str());
+            if (!file.is_open() || !std::getline(file, strMainchainCookie) || strMainchainCookie.empty()) {
+                LogPrintf("ERROR Sidechain client failed to read mainchain auth cookie %s\n", strPath);
+                strMainchainCookie.clear();
+                return false;
+            }
+        }
+        strAuth = strMainchainCookie;
+        return true;
+    }
+
+    if (!gArgs.GetArg("-mainchainrpcuser", "").empty())
+        strAuth = gArgs.GetArg("-mainchainrpcuser", "") + ":" + gArgs.GetArg("-mainchainrpcpassword", "");
+    else
+        strAuth = gArgs.GetArg("-rpcuser", "") + ":" + gArgs.GetArg("-rpcpassword", "");
+
+    return strAuth != ":";
+}
+
+/**
+ * Send a JSON-RPC request over a connected socket and parse the JSON reply.
+ * Returns false if the server didn't answer with 200 OK.
+ */
+template <typename Socket>
+static bool SendHTTPRequest(Socket& socket, const std::string& strHost, const std::string& auth, const std::string& json, boost::property_tree::ptree &ptree)
+{
+    // HTTP request (package the json for sending)
+    boost::asio::streambuf output;
+    std::ostream os(&output);
+    os << "POST / HTTP/1.1\n";
+    os << "Host: " << strHost << "\n";
+    os << "Content-Type: application/json\n";
+    os << "Authorization: Basic " << EncodeBase64(auth) << std::endl;
+    os << "Connection: close\n";
+    os << "Content-Length: " << json.size() << "\n\n";
+    os << json;
+
+    // Send the request
+    boost::asio::write(socket, output);
+
+    // Read the reponse
+    std::string data;
+    for (;;)
+    {
+        boost::array<char, 4096> buf;
+
+        // Read until end of file (socket closed)
+        boost::system::error_code e;
+        size_t sz = socket.read_some(boost::asio::buffer(buf), e);
+
+        data.insert(data.size(), buf.data(), sz);
+
+        if (e == boost::asio::error::eof)
+            break; // socket closed
+        else if (e)
+            throw boost::system::system_error(e);
+    }
+
+    std::stringstream ss;
+    ss << data;
+
+    // Get response code
+    ss.ignore(std::numeric_limits<std::streamsize>::max(), ' ');
+    int code;
+    ss >> code;
+
+    // The mainchain node writes a new cookie when it restarts
+    if (code == 401) {
+        std::lock_guard<std::mutex> lock(mainchainCookieMutex);
+        strMainchainCookie.clear();
+    }
+
+    // Check response code
+    if (code != 200)
+        return false;
+
+    // Parse json response, which follows the header
+    size_t nBody = data.find("\r\n\r\n");
+    if (nBody == std::string::npos)
+        return false;
+
+    std::stringstream jss(data.substr(nBody + 4));
+    boost::property_tree::json_parser::read_json(jss, ptree);
+
+    return true;
+}
+
+bool SidechainClient::SendCachedRequestToMainchain(const std::string& strMethod, const std::string& json, boost::property_tree::ptree &ptree)
+{
+    const uint256 hashTip = bmmCache.GetLastMainBlockHash();
+    const int64_t nTTL = gArgs.GetArg("-mainchaincachettl", DEFAULT_MAINCHAIN_CACHE_TTL);
+    if (!fUseCache || hashTip.IsNull() || nTTL <= 0)
+        return SendRequestToMainchain(json, ptree);
+
+    if (mainchainReplyCache.Lookup(strMethod, json, hashTip, ptree))
+        return true;
+
+    if (!SendRequestToMainchain(json, ptree))
+        return false;
+
+    mainchainReplyCache.Insert(strMethod, json, hashTip, uint256(), GetTime() + nTTL, ptree);
+
+    return true;
+}
+
+bool SidechainClient::SendCachedBlockRequestToMainchain(const std::string& strMethod, const std::string& json, const uint256& hashMainBlock, boost::property_tree::ptree &ptree)
+{
+    if (!fUseCache || hashMainBlock.IsNull())
+        return SendRequestToMainchain(json, ptree);
+
+    if (mainchainReplyCache.Lookup(strMethod, json, uint256(), ptree))
+        return true;
+
+    if (!SendRequestToMainchain(json, ptree))
+        return false;
+
+    mainchainReplyCache.Insert(strMethod, json, uint256(), hashMainBlock, 0, ptree);
+
+    return true;
+}
+
 bool SidechainClient::SendRequestToMainchain(const std::string& json, boost::property_tree::ptree &ptree)
 {
+    MainchainRequestHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(mainchainRequestHandlerMutex);
+        handler = mainchainRequestHandler;
+    }
+
+    // Let the in process handler answer instead of the mainchain node
+    if (handler) {
+        std::string strReply;
+        if (!handler(json, strReply))
+            return false;
+
+        try {
+            std::stringstream jss(strReply);
+            boost::property_tree::json_parser::read_json(jss, ptree);
+        } catch (std::exception &exception) {
+            LogPrintf("ERROR Sidechain client (sendRequestToMainchain): %s\n", exception.what());
+            return false;
+        }
+        return true;
+    }
+
     // Format user:pass for authentication
-    std::string auth = gArgs.GetArg("-rpcuser", "") + ":" + gArgs.GetArg("-rpcpassword", "");
-    if (auth == ":")
+    std::string auth;
+    if (!GetMainchainAuth(auth))
         return false;
 
-    // Mainnet RPC = 8332
-    // Testnet RPC = 18332
-    // Regtest RPC = 18443
-    //
-    bool fRegtest = gArgs.GetBoolArg("-regtest", false);
-    int port = fRegtest ? 18443 : 8332;
-
     try {
         // Setup BOOST ASIO for a synchronus call to the mainchain
         boost::asio::io_service io_service;
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        // A mainchain node on the same host can be reached through a Unix
+        // domain socket, which skips the TCP loopback stack
+        const std::string strSocket = gArgs.GetArg("-mainchainrpcsocket", "");
+        if (!strSocket.empty()) {
+            boost::asio::local::stream_protocol::socket socket(io_service);
+            socket.connect(boost::asio::local::stream_protocol::endpoint(strSocket));
+
+            return SendHTTPRequest(socket, "localhost", auth, json, ptree);
+        }
+#else
+        if (!gArgs.GetArg("-mainchainrpcsocket", "").empty()) {
+            LogPrintf("ERROR Sidechain client: -mainchainrpcsocket is not supported on this platform\n");
+            return false;
+        }
+#endif
+
+        // Mainnet RPC = 8332
+        // Testnet RPC = 18332
+        // Regtest RPC = 18443
+        //
+        bool fRegtest = gArgs.GetBoolArg("-regtest", false);
+        const std::string strHost = gArgs.GetArg("-mainchainrpchost", DEFAULT_MAINCHAIN_RPC_HOST);
+        const int64_t nPort = gArgs.GetArg("-mainchainrpcport", fRegtest ? DEFAULT_MAINCHAIN_RPC_PORT_REGTEST : DEFAULT_MAINCHAIN_RPC_PORT);
+
         tcp::resolver resolver(io_service);
-        tcp::resolver::query query("127.0.0.1", std::to_string(port));
+        tcp::resolver::query query(strHost, std::to_string(nPort));
         tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
         tcp::resolver::iterator end;
 
@@ -724,63 +1147,9 @@ bool SidechainClient::SendRequestToMainchain(const std::string& json, boost::pro
 
         if (error) throw boost::system::system_error(error);
 
-        // HTTP request (package the json for sending)
-        boost::asio::streambuf output;
-        std::ostream os(&output);
-        os << "POST / HTTP/1.1\n";
-        os << "Host: 127.0.0.1\n";
-        os << "Content-Type: application/json\n";
-        os << "Authorization: Basic " << EncodeBase64(auth) << std::endl;
-        os << "Connection: close\n";
-        os << "Content-Length: " << json.size() << "\n\n";
-        os << json;
-
-        // Send the request
-        boost::asio::write(socket, output);
-
-        // Read the reponse
-        std::string data;
-        for (;;)
-        {
-            boost::array<char, 4096> buf;
-
-            // Read until end of file (socket closed)
-            boost::system::error_code e;
-            size_t sz = socket.read_some(boost::asio::buffer(buf), e);
-
-            data.insert(data.size(), buf.data(), sz);
-
-            if (e == boost::asio::error::eof)
-                break; // socket closed
-            else if (e)
-                throw boost::system::system_error(e);
-        }
-
-        std::stringstream ss;
-        ss << data;
-
-        // Get response code
-        ss.ignore(std::numeric_limits<std::streamsize>::max(), ' ');
-        int code;
-        ss >> code;
-
-        // Check response code
-        if (code != 200)
-            return false;
-
-        // Skip the rest of the header
-        for (size_t i = 0; i < 5; i++)
-            ss.ignore(std::numeric_limits<std::streamsize>::max(), '\r');
-
-        // Parse json response;
-        std::string JSON;
-        ss >> JSON;
-        std::stringstream jss;
-        jss << JSON;
-        boost::property_tree::json_parser::read_json(jss, ptree);
+        return SendHTTPRequest(socket, strHost, auth, json, ptree);
     } catch (std::exception &exception) {
         LogPrintf("ERROR Sidechain client (sendRequestToMainchain): %s\n", exception.what());
         return false;
     }
-    return true;
 }
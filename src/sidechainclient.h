@@ -9,6 +9,8 @@
 #include <uint256.h>
 #include <validation.h>
 
+#include <functional>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -16,11 +18,61 @@
 
 class SidechainDeposit;
 
+/** Default host of the mainchain RPC server */
+static const char* const DEFAULT_MAINCHAIN_RPC_HOST = "127.0.0.1";
+
+/** Default mainchain RPC ports */
+static const int DEFAULT_MAINCHAIN_RPC_PORT = 8332;
+static const int DEFAULT_MAINCHAIN_RPC_PORT_REGTEST = 18443;
+
+/** Default seconds to reuse mainchain replies that can change without a new mainchain tip */
+static const int64_t DEFAULT_MAINCHAIN_CACHE_TTL = 10;
+
+/** Maximum number of mainchain replies to cache */
+static const size_t MAINCHAIN_CACHE_MAX_ENTRIES = 10000;
+
+/**
+ * Answers a mainchain JSON-RPC request in process. Sets the JSON reply and
+ * returns false if the request failed, like a non-200 HTTP response would.
+ */
+typedef std::function<bool(const std::string& strRequest, std::string& strReply)> MainchainRequestHandler;
+
+/**
+ * Send all mainchain requests to handler instead of the mainchain node, or
+ * to the node again if handler is empty. Used by tests and benchmarks.
+ */
+void SetMainchainRequestHandler(MainchainRequestHandler handler);
+
+struct MainchainCacheStats
+{
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    MainchainCacheStats() : nHits(0), nMisses(0) {}
+};
+
+/** Hits and misses of the mainchain reply cache by method */
+std::map<std::string, MainchainCacheStats> GetMainchainCacheStats();
+
+/** Number of mainchain replies cached */
+size_t GetMainchainCacheSize();
+
+/** Remove all cached mainchain replies */
+void ClearMainchainCache();
+
+/** Remove the cached replies about mainchain blocks which were disconnected */
+void EraseMainchainBlockReplies(const std::vector<uint256>& vHashBlock);
+
 // TODO refactor: Move BMM validation cache code here, or remove class status.
 class SidechainClient
 {
 public:
-    SidechainClient();
+    /**
+     * Replies that don't change for a mainchain tip are cached, unless
+     * fUseCache is false. Code following the mainchain tip itself, like the
+     * main block hash cache updates, must not use the cache.
+     */
+    explicit SidechainClient(bool fUseCacheIn = true);
 
     /*
      * Send Withdrawal Bundle tx to local node
@@ -78,10 +130,38 @@ public:
     bool HaveFailedWithdrawalBundle(const uint256& hash);
 
 private:
+    /*
+     * Create a BMM block and send a BMM request for it which pays amount
+     * to the mainchain miner.
+     */
+    bool CreateBMMRequest(const CAmount& amount, const uint256& hashMainTip, std::string& strError, uint256& hashCreatedMerkleRoot, uint256& txid, int& nTxn, CAmount& nFees, const uint256& hashPrevBlock);
+
+    /*
+     * Generate a BMM block and add it to the BMM cache. fCached is set if the
+     * block was already cached.
+     */
+    bool GenerateBMMBlock(CBlock& block, std::string& strError, CAmount& nFees, const uint256& hashPrevBlock, bool& fCached);
+
     /*
      * Send json request to local node
      */
     bool SendRequestToMainchain(const std::string& json, boost::property_tree::ptree &ptree);
+
+    /*
+     * Send json request to local node, or use the reply cached for the
+     * current mainchain tip. The reply can change without a new tip, so it
+     * is only reused for -mainchaincachettl seconds.
+     */
+    bool SendCachedRequestToMainchain(const std::string& strMethod, const std::string& json, boost::property_tree::ptree &ptree);
+
+    /*
+     * Send json request about mainchain block hashMainBlock to local node, or
+     * use the cached reply. The reply doesn't change, so it is kept until
+     * the block is disconnected.
+     */
+    bool SendCachedBlockRequestToMainchain(const std::string& strMethod, const std::string& json, const uint256& hashMainBlock, boost::property_tree::ptree &ptree);
+
+    bool fUseCache;
 };
 
 #endif // SIDECHAINCLIENT_H
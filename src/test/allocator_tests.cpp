@@ -4,9 +4,12 @@
 
 #include <util.h>
 
+#include <support/allocators/pool.h>
 #include <support/allocators/secure.h>
 #include <test/test_bitcoin.h>
 
+#include <unordered_map>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(allocator_tests, BasicTestingSetup)
@@ -231,4 +234,74 @@ BOOST_AUTO_TEST_CASE(lockedpool_tests_live)
     BOOST_CHECK(pool.stats().used == initial.used);
 }
 
+BOOST_AUTO_TEST_CASE(poolresource_tests)
+{
+    PoolResource<16, 8> resource(64);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 64U);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+
+    // Blocks are carved out of the chunk one after another
+    void *a0 = resource.Allocate(8, 8);
+    void *a1 = resource.Allocate(8, 8);
+    BOOST_CHECK_EQUAL((char*)a1 - (char*)a0, 8);
+
+    // Freed blocks are reused for allocations of the same size, last in first out
+    resource.Deallocate(a0, 8, 8);
+    resource.Deallocate(a1, 8, 8);
+    BOOST_CHECK(resource.Allocate(8, 8) == a1);
+    BOOST_CHECK(resource.Allocate(8, 8) == a0);
+
+    // Sizes are rounded up to the alignment, so 12 and 16 bytes share a free list
+    void *a2 = resource.Allocate(12, 8);
+    resource.Deallocate(a2, 12, 8);
+    BOOST_CHECK(resource.Allocate(16, 8) == a2);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // 32 of the 64 bytes are used, the next three blocks need a new chunk
+    resource.Allocate(16, 8);
+    resource.Allocate(16, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    resource.Allocate(16, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+
+    // Blocks that are too big or too strictly aligned come from operator new
+    void *a3 = resource.Allocate(1000, 8);
+    *((uint32_t*)a3) = 0x1234;
+    resource.Deallocate(a3, 1000, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(poolallocator_map_tests)
+{
+    typedef PoolAllocator<std::pair<const uint64_t, uint64_t>, sizeof(std::pair<const uint64_t, uint64_t>) + sizeof(void*) * 4, alignof(void*)> Allocator;
+    typedef std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>, Allocator> Map;
+
+    Allocator::ResourceType resource(1024);
+    {
+        Map map(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), &resource);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            map[i] = i * 2;
+        }
+        BOOST_CHECK_EQUAL(map.size(), 1000U);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            BOOST_CHECK_EQUAL(map.at(i), i * 2);
+        }
+        BOOST_CHECK(map.get_allocator().resource() == &resource);
+        BOOST_CHECK(resource.NumAllocatedChunks() > 1);
+
+        // Erased nodes are reused, so refilling the map needs no more chunks
+        const size_t nChunks = resource.NumAllocatedChunks();
+        map.clear();
+        for (uint64_t i = 0; i < 1000; ++i) {
+            map[i + 1000] = i;
+        }
+        BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), nChunks);
+    }
+
+    Allocator a(&resource);
+    Allocator::ResourceType other;
+    BOOST_CHECK(a == Allocator(&resource));
+    BOOST_CHECK(a != Allocator(&other));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
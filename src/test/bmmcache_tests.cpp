@@ -4,6 +4,8 @@
 
 #include <bmmcache.h>
 #include <deque>
+#include <fstream>
+#include <hashsnapshot.h>
 #include <random.h>
 #include <uint256.h>
 #include <validation.h>
@@ -872,4 +874,175 @@ BOOST_AUTO_TEST_CASE(bmmcache_replace_tip)
     BOOST_CHECK(vOrphan == vOrphanCheck);
 }
 
+BOOST_AUTO_TEST_CASE(bmmcache_deposit_queue)
+{
+    // Instance of BMMCache for test
+    BMMCache cache;
+
+    // New cache should have an empty queue and null cursor
+    uint256 hashCursor;
+    uint32_t nCursorBurnIndex = 0;
+    cache.GetDepositCursor(hashCursor, nCursorBurnIndex);
+    BOOST_CHECK(cache.GetDepositQueue().empty());
+    BOOST_CHECK(hashCursor.IsNull());
+
+    // Queue two deposits and move the cursor to the second
+    std::vector<SidechainDeposit> vDeposit(2);
+    vDeposit[0].strDest = "a";
+    vDeposit[1].strDest = "b";
+    uint256 hashLast = GetRandHash();
+    cache.SetDepositQueue(vDeposit, hashLast, 1);
+
+    cache.GetDepositCursor(hashCursor, nCursorBurnIndex);
+    std::vector<SidechainDeposit> vQueued = cache.GetDepositQueue();
+    BOOST_CHECK(vQueued.size() == 2);
+    BOOST_CHECK(vQueued.front().strDest == "a" && vQueued.back().strDest == "b");
+    BOOST_CHECK(hashCursor == hashLast);
+    BOOST_CHECK(nCursorBurnIndex == 1);
+
+    // Clearing the queue also resets the cursor
+    cache.ClearDepositQueue();
+    cache.GetDepositCursor(hashCursor, nCursorBurnIndex);
+    BOOST_CHECK(cache.GetDepositQueue().empty());
+    BOOST_CHECK(hashCursor.IsNull());
+    BOOST_CHECK(nCursorBurnIndex == 0);
+}
+
+BOOST_AUTO_TEST_CASE(bmmcache_bmm_requests)
+{
+    // Instance of BMMCache for test
+    BMMCache cache;
+
+    // Create three BMM requests with two different bids for one mainchain tip
+    uint256 hashPrevMain = GetRandHash();
+    uint256 hashMerkleRoot = GetRandHash();
+    uint256 txid1 = GetRandHash();
+    uint256 txid2 = GetRandHash();
+    uint256 txid3 = GetRandHash();
+    cache.StoreBMMRequest(txid1, hashMerkleRoot, hashPrevMain, CAmount(100), 1000);
+    cache.StoreBMMRequest(txid2, hashMerkleRoot, hashPrevMain, CAmount(200), 1010);
+    cache.StoreBMMRequest(txid3, GetRandHash(), hashPrevMain, CAmount(200), 1020);
+
+    BOOST_CHECK(cache.GetBMMRequestCount(hashPrevMain) == 3);
+    BOOST_CHECK(cache.GetBMMRequestCount(GetRandHash()) == 0);
+
+    // The second request is included 50 seconds after it was created
+    cache.RecordBMMIncluded(txid2, 1060);
+    // Unknown requests are ignored
+    cache.RecordBMMIncluded(GetRandHash(), 1060);
+
+    std::map<CAmount, BMMBidStats> mapStats = cache.GetBMMBidStats();
+    BOOST_CHECK(mapStats.size() == 2);
+    BOOST_CHECK(mapStats[100].nRequest == 1);
+    BOOST_CHECK(mapStats[100].nIncluded == 0);
+    BOOST_CHECK(mapStats[200].nRequest == 2);
+    BOOST_CHECK(mapStats[200].nIncluded == 1);
+    BOOST_CHECK(mapStats[200].nTotalLatency == 50);
+
+    // Clearing the BMM blocks for a new mainchain tip keeps the statistics
+    cache.ClearBMMBlocks();
+    BOOST_CHECK(cache.GetBMMRequestCount(hashPrevMain) == 0);
+    BOOST_CHECK(cache.GetBMMBidStats().size() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(bmmcache_snapshot)
+{
+    fs::path path = fs::temp_directory_path() / fs::unique_path("bmmcache_snapshot_%%%%%%%%.dat");
+
+    std::vector<uint256> vBMM;
+    std::vector<uint256> vMain;
+    for (int i = 0; i < 100; i++) {
+        vBMM.push_back(GetRandHash());
+        vMain.push_back(GetRandHash());
+    }
+
+    std::vector<HashSnapshotBlock> vBlock;
+    vBlock.emplace_back(HASH_SNAPSHOT_BMM, HASH_SNAPSHOT_SORTED, vBMM);
+    vBlock.emplace_back(HASH_SNAPSHOT_MAIN_BLOCK, 0, vMain);
+    BOOST_CHECK(WriteHashSnapshot(path, vBlock));
+
+    HashSnapshot snapshot;
+    BOOST_CHECK(snapshot.Open(path));
+    BOOST_CHECK(snapshot.CanAppend());
+    BOOST_CHECK_EQUAL(snapshot.GetBlockCount(), 2);
+    BOOST_CHECK_EQUAL(snapshot.Count(HASH_SNAPSHOT_BMM), 100);
+    for (const uint256& u : vBMM)
+        BOOST_CHECK(snapshot.Contains(HASH_SNAPSHOT_BMM, u));
+    BOOST_CHECK(!snapshot.Contains(HASH_SNAPSHOT_BMM, GetRandHash()));
+    BOOST_CHECK(!snapshot.Contains(HASH_SNAPSHOT_DEPOSIT, vBMM.front()));
+
+    // Unsorted blocks keep their order
+    BOOST_CHECK(snapshot.Get(HASH_SNAPSHOT_MAIN_BLOCK) == vMain);
+
+    // Append a block
+    uint256 hashNew = GetRandHash();
+    BOOST_CHECK(AppendHashSnapshot(path, {HashSnapshotBlock(HASH_SNAPSHOT_BMM, HASH_SNAPSHOT_SORTED, {hashNew})}));
+    BOOST_CHECK(snapshot.Open(path));
+    BOOST_CHECK_EQUAL(snapshot.GetBlockCount(), 3);
+    BOOST_CHECK(snapshot.Contains(HASH_SNAPSHOT_BMM, hashNew));
+    BOOST_CHECK(snapshot.Contains(HASH_SNAPSHOT_BMM, vBMM.back()));
+
+    // A damaged block at the end is ignored and the file must be rewritten
+    FILE* file = fsbridge::fopen(path, "ab");
+    BOOST_CHECK(file);
+    const unsigned char garbage[20] = {2, 0, 0, 0, 1, 0, 0, 0, 5, 0, 0, 0};
+    BOOST_CHECK(fwrite(garbage, 1, sizeof(garbage), file) == sizeof(garbage));
+    fclose(file);
+    BOOST_CHECK(snapshot.Open(path));
+    BOOST_CHECK_EQUAL(snapshot.GetBlockCount(), 3);
+    BOOST_CHECK(snapshot.Contains(HASH_SNAPSHOT_BMM, hashNew));
+    BOOST_CHECK(!snapshot.CanAppend());
+    snapshot.Close();
+
+    // A damaged block before the end is only found when its type is used
+    std::vector<unsigned char> vch;
+    {
+        std::ifstream in(path.string(), std::ios::binary);
+        vch.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::vector<unsigned char> vchDamaged(vch.begin(), vch.end() - sizeof(garbage));
+    vchDamaged[8 + 12] ^= 1; // First hash of the first BMM block
+    {
+        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        out.write((const char*)vchDamaged.data(), vchDamaged.size());
+    }
+    BOOST_CHECK(snapshot.Open(path));
+    BOOST_CHECK_EQUAL(snapshot.GetBlockCount(), 3);
+    BOOST_CHECK(snapshot.Get(HASH_SNAPSHOT_MAIN_BLOCK) == vMain);
+    BOOST_CHECK(snapshot.CanAppend());
+    BOOST_CHECK(!snapshot.Contains(HASH_SNAPSHOT_BMM, vBMM.back()));
+    BOOST_CHECK(snapshot.Contains(HASH_SNAPSHOT_BMM, hashNew));
+    BOOST_CHECK_EQUAL(snapshot.Count(HASH_SNAPSHOT_BMM), 1);
+    BOOST_CHECK(!snapshot.CanAppend());
+    snapshot.Close();
+    {
+        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        out.write((const char*)vch.data(), vch.size());
+    }
+
+    // The BMM cache looks up hashes in the snapshot and only keeps new ones
+    BMMCache cache;
+    std::unique_ptr<HashSnapshot> snapshotCache(new HashSnapshot());
+    BOOST_CHECK(snapshotCache->Open(path));
+    cache.SetSnapshot(std::move(snapshotCache));
+    BOOST_CHECK(cache.HaveVerifiedBMM(vBMM.front()));
+    cache.CacheVerifiedBMM(vBMM.front());
+    BOOST_CHECK(cache.GetVerifiedBMMCache().empty());
+    cache.CacheVerifiedBMM(hashNew);
+    cache.CacheVerifiedBMM(GetRandHash());
+    BOOST_CHECK_EQUAL(cache.GetVerifiedBMMCache().size(), 1);
+
+    // Only main block hashes which have not been written are dumped
+    bool fRewrite = false;
+    cache.CacheMainBlockHash(vMain);
+    BOOST_CHECK_EQUAL(cache.GetMainBlockHashesToDump(fRewrite).size(), 100);
+    BOOST_CHECK(fRewrite);
+    cache.SetMainBlockHashesDumped();
+    cache.CacheMainBlockHash(GetRandHash());
+    BOOST_CHECK_EQUAL(cache.GetMainBlockHashesToDump(fRewrite).size(), 1);
+    BOOST_CHECK(!fRewrite);
+
+    fs::remove(path);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
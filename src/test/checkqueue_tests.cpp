@@ -146,11 +146,11 @@ typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
 /** This test case checks that the CCheckQueue works properly
  * with each specified size_t Checks pushed.
  */
-void Correct_Queue_range(std::vector<size_t> range)
+void Correct_Queue_range(std::vector<size_t> range, int nThreads = nScriptCheckThreads)
 {
     auto small_queue = std::unique_ptr<Correct_Queue>(new Correct_Queue {QUEUE_BATCH_SIZE});
     boost::thread_group tg;
-    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+    for (auto x = 0; x < nThreads; ++x) {
        tg.create_thread([&]{small_queue->Thread();});
     }
     // Make vChecks here to save on malloc (this test can be slow...)
@@ -208,6 +208,15 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Random)
         range.push_back(i);
     Correct_Queue_range(range);
 }
+/** Test that checks are correct when workers have to share their queues
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_SharedQueues)
+{
+    std::vector<size_t> range;
+    for (size_t i = 1; i < 10000; i += 997)
+        range.push_back(i);
+    Correct_Queue_range(range, CHECKQUEUE_WORKER_QUEUES + 2);
+}
 
 
 /** Test that failing checks are caught */
@@ -13,6 +13,7 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 #include <boost/test/unit_test.hpp>
 
@@ -30,6 +31,33 @@ bool operator==(const Coin &a, const Coin &b) {
            a.out == b.out;
 }
 
+/** std::allocator which counts the malloc usage of what it allocates */
+template <typename T>
+class CountingAllocator : public std::allocator<T>
+{
+public:
+    size_t* pnUsage;
+
+    template <typename U>
+    struct rebind { typedef CountingAllocator<U> other; };
+
+    explicit CountingAllocator(size_t* pnUsageIn) : pnUsage(pnUsageIn) {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) : pnUsage(other.pnUsage) {}
+
+    T* allocate(size_t n)
+    {
+        *pnUsage += memusage::MallocUsage(n * sizeof(T));
+        return std::allocator<T>::allocate(n);
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        *pnUsage -= memusage::MallocUsage(n * sizeof(T));
+        std::allocator<T>::deallocate(p, n);
+    }
+};
+
 class CCoinsViewTest : public CCoinsView
 {
     uint256 hashBestBlock_;
@@ -586,7 +614,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
     InsertCoinsMapEntry(map, value, flags);
     view.BatchWrite(map, {});
 }
@@ -855,4 +884,74 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(prefetch_coins)
+{
+    CCoinsViewTest base;
+    const COutPoint outA(InsecureRand256(), 0), outB(InsecureRand256(), 0), outMissing(InsecureRand256(), 0);
+    {
+        CCoinsViewCache cache(&base);
+        cache.AddCoin(outA, Coin(CTxOut(1, CScript() << OP_TRUE), 1, false), false);
+        cache.AddCoin(outB, Coin(CTxOut(2, CScript() << OP_TRUE), 1, false), false);
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(cache.Flush());
+    }
+
+    // B was spent by a block that hasn't been written to base yet
+    CCoinsViewCacheTest cache(&base);
+    BOOST_CHECK(cache.SpendCoin(outB));
+
+    CMutableTransaction tx1, tx2;
+    tx1.vin.resize(3);
+    tx1.vin[0].prevout = outA;
+    tx1.vin[1].prevout = outB;
+    tx1.vin[2].prevout = outMissing;
+    tx1.vout.resize(1);
+    tx2.vin.resize(1);
+    tx2.vin[0].prevout = COutPoint(tx1.GetHash(), 0);
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(tx1));
+    block.vtx.push_back(MakeTransactionRef(tx2));
+
+    BOOST_CHECK(!cache.HaveCoinInCache(outA));
+    PrefetchCoins(block, cache, base);
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 2);
+    BOOST_CHECK(cache.HaveCoinInCache(outA));
+    BOOST_CHECK_EQUAL(cache.map().at(outA).flags, 0);
+    BOOST_CHECK(cache.AccessCoin(outB).IsSpent());
+    BOOST_CHECK(!cache.HaveCoinInCache(outMissing));
+    BOOST_CHECK(!cache.HaveCoinInCache(tx2.vin[0].prevout));
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_coins_per_mb)
+{
+    // The same -dbcache holds more coins when the cache entries come from
+    // the pool than when every entry is allocated with malloc
+    const size_t nCacheBytes = 16 << 20;
+    const Coin coin(CTxOut(CENT, GetScriptForDestination(CKeyID(uint160()))), 1, false);
+
+    CCoinsView viewDummy;
+    CCoinsViewCache cache(&viewDummy);
+    size_t nPoolCoins = 0;
+    while (cache.DynamicMemoryUsage() < nCacheBytes) {
+        cache.AddCoin(COutPoint(InsecureRand256(), 0), Coin(coin), false);
+        nPoolCoins++;
+    }
+
+    typedef std::pair<const COutPoint, CCoinsCacheEntry> Entry;
+    size_t nUsage = 0;
+    std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CountingAllocator<Entry> > map(
+        0, SaltedOutpointHasher(), std::equal_to<COutPoint>(), CountingAllocator<Entry>(&nUsage));
+    size_t nCoinsUsage = 0;
+    size_t nStdCoins = 0;
+    while (nUsage + nCoinsUsage < nCacheBytes) {
+        map.emplace(COutPoint(InsecureRand256(), 0), CCoinsCacheEntry(Coin(coin)));
+        nCoinsUsage += coin.DynamicMemoryUsage();
+        nStdCoins++;
+    }
+
+    BOOST_TEST_MESSAGE(strprintf("Coins per MB of cache: %u with the pool, %u with std::allocator", nPoolCoins / (nCacheBytes >> 20), nStdCoins / (nCacheBytes >> 20)));
+    BOOST_CHECK_GT(nPoolCoins, nStdCoins);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
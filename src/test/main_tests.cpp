@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <consensus/validation.h>
 #include <validation.h>
 #include <net.h>
 
@@ -74,4 +75,55 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+static CBlock MakeCheckBlockTestBlock(unsigned int nTx)
+{
+    CBlock block;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << OP_1 << OP_1;
+    coinbase.vout.resize(1);
+    coinbase.vout[0].nValue = 50 * COIN;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+
+    for (unsigned int i = 1; i < nTx; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = COIN;
+        mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        block.vtx.push_back(MakeTransactionRef(mtx));
+    }
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(checkblock_parallel_tx_checks)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    // Large enough to be checked by the tx check queue
+    CBlock block = MakeCheckBlockTestBlock(MIN_PARALLEL_TX_CHECKS * 2);
+    CValidationState state;
+    BOOST_CHECK(CheckBlock(block, state, consensusParams, false, false));
+    BOOST_CHECK(state.IsValid());
+
+    // Make two transactions invalid, the first one in the block must be
+    // reported just like when the transactions are checked in order.
+    CMutableTransaction noInputs(*block.vtx[10]);
+    noInputs.vin.clear();
+    block.vtx[10] = MakeTransactionRef(noInputs);
+
+    CMutableTransaction noOutputs(*block.vtx[block.vtx.size() - 10]);
+    noOutputs.vout.clear();
+    block.vtx[block.vtx.size() - 10] = MakeTransactionRef(noOutputs);
+
+    for (int i = 0; i < 10; i++) {
+        CValidationState stateInvalid;
+        BOOST_CHECK(!CheckBlock(block, stateInvalid, consensusParams, false, false));
+        BOOST_CHECK_EQUAL(stateInvalid.GetRejectReason(), "bad-txns-vin-empty");
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
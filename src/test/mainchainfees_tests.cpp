@@ -0,0 +1,154 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <mainchainfees.h>
+#include <random.h>
+#include <sidechain.h>
+#include <uint256.h>
+#include <validation.h>
+
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+/** Create a withdrawal bundle with nWithdrawal withdrawals paying nFees */
+static SidechainWithdrawalBundle MakeBundle(CAmount nFees, size_t nWithdrawal, int status)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout.hash = GetRandHash();
+    mtx.vout.resize(2);
+    mtx.vout[0].scriptPubKey = CScript() << OP_RETURN;
+    mtx.vout[1].scriptPubKey = EncodeWithdrawalFees(nFees);
+
+    SidechainWithdrawalBundle bundle;
+    bundle.tx = MakeTransactionRef(mtx);
+    for (size_t i = 0; i < nWithdrawal; i++)
+        bundle.vWithdrawalID.push_back(GetRandHash());
+    bundle.status = status;
+
+    return bundle;
+}
+
+BOOST_FIXTURE_TEST_SUITE(mainchainfees_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(mainchainfees_no_data)
+{
+    CMainchainFeeEstimator estimator;
+    MainchainFeeEstimate estimate;
+    BOOST_CHECK(!estimator.EstimateFee(estimate));
+
+    // Bundles that were only created say nothing about mainchain fees
+    estimator.AddBundleOutcome(MakeBundle(10000, 2, WITHDRAWAL_BUNDLE_CREATED));
+    BOOST_CHECK(!estimator.EstimateFee(estimate));
+    BOOST_CHECK(estimator.GetBundles().empty());
+}
+
+BOOST_AUTO_TEST_CASE(mainchainfees_spent_median)
+{
+    CMainchainFeeEstimator estimator;
+    estimator.AddBundleOutcome(MakeBundle(3000, 3, WITHDRAWAL_BUNDLE_SPENT));
+    estimator.AddBundleOutcome(MakeBundle(5000, 1, WITHDRAWAL_BUNDLE_SPENT));
+    estimator.AddBundleOutcome(MakeBundle(4000, 2, WITHDRAWAL_BUNDLE_SPENT));
+
+    // Per withdrawal fees 1000, 5000 and 2000
+    MainchainFeeEstimate estimate;
+    BOOST_CHECK(estimator.EstimateFee(estimate));
+    BOOST_CHECK_EQUAL(estimate.nFee, 2000);
+    BOOST_CHECK_EQUAL(estimate.strSource, "bundles");
+    BOOST_CHECK_EQUAL(estimate.nSpent, 3U);
+    BOOST_CHECK_EQUAL(estimate.nFailed, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(mainchainfees_failed_bump)
+{
+    CMainchainFeeEstimator estimator;
+    estimator.AddBundleOutcome(MakeBundle(1000, 1, WITHDRAWAL_BUNDLE_SPENT));
+
+    // A failure before the last paid out bundle does not raise the estimate
+    SidechainWithdrawalBundle failed = MakeBundle(6000, 2, WITHDRAWAL_BUNDLE_FAILED);
+    estimator.AddBundleOutcome(failed);
+    estimator.AddBundleOutcome(MakeBundle(1500, 1, WITHDRAWAL_BUNDLE_SPENT));
+
+    MainchainFeeEstimate estimate;
+    BOOST_CHECK(estimator.EstimateFee(estimate));
+    BOOST_CHECK_EQUAL(estimate.nFee, 1500);
+    BOOST_CHECK_EQUAL(estimate.nFailed, 1U);
+
+    // A failure since then at or above the median does
+    estimator.AddBundleOutcome(MakeBundle(4000, 2, WITHDRAWAL_BUNDLE_FAILED));
+    BOOST_CHECK(estimator.EstimateFee(estimate));
+    BOOST_CHECK_EQUAL(estimate.nFee, 2001);
+    BOOST_CHECK_EQUAL(estimate.nFailed, 2U);
+
+    // Replacing the outcome of a bundle moves it to the end of the history
+    failed.status = WITHDRAWAL_BUNDLE_SPENT;
+    estimator.AddBundleOutcome(failed);
+    BOOST_CHECK_EQUAL(estimator.GetBundles().size(), 4U);
+    BOOST_CHECK(estimator.EstimateFee(estimate));
+    BOOST_CHECK_EQUAL(estimate.nFee, 1500);
+    BOOST_CHECK_EQUAL(estimate.nSpent, 3U);
+    BOOST_CHECK_EQUAL(estimate.nFailed, 1U);
+
+    // Disconnecting the block recording an outcome removes it
+    estimator.RemoveBundleOutcome(failed.tx->GetHash());
+    BOOST_CHECK_EQUAL(estimator.GetBundles().size(), 3U);
+    BOOST_CHECK(estimator.EstimateFee(estimate));
+    BOOST_CHECK_EQUAL(estimate.nFee, 2001);
+}
+
+BOOST_AUTO_TEST_CASE(mainchainfees_samples)
+{
+    CMainchainFeeEstimator estimator;
+    uint256 hashTip = GetRandHash();
+    estimator.AddMainchainFeeSample(hashTip, 700);
+    estimator.AddMainchainFeeSample(GetRandHash(), 300);
+    estimator.AddMainchainFeeSample(GetRandHash(), 500);
+
+    MainchainFeeEstimate estimate;
+    BOOST_CHECK(estimator.EstimateFee(estimate));
+    BOOST_CHECK_EQUAL(estimate.nFee, 500);
+    BOOST_CHECK_EQUAL(estimate.strSource, "mainchain");
+    BOOST_CHECK_EQUAL(estimate.nSamples, 3U);
+
+    // A new sample at the same tip replaces the last one
+    uint256 hashNewTip = GetRandHash();
+    estimator.AddMainchainFeeSample(hashNewTip, 100);
+    estimator.AddMainchainFeeSample(hashNewTip, 900);
+    BOOST_CHECK(estimator.EstimateFee(estimate));
+    BOOST_CHECK_EQUAL(estimate.nSamples, 4U);
+    BOOST_CHECK_EQUAL(estimate.nFee, 700);
+
+    // Failed bundles raise the estimate
+    estimator.AddBundleOutcome(MakeBundle(2000, 1, WITHDRAWAL_BUNDLE_FAILED));
+    BOOST_CHECK(estimator.EstimateFee(estimate));
+    BOOST_CHECK_EQUAL(estimate.nFee, 2001);
+
+    // Bundle outcomes take over from the samples once one was paid out
+    estimator.AddBundleOutcome(MakeBundle(3000, 1, WITHDRAWAL_BUNDLE_SPENT));
+    BOOST_CHECK(estimator.EstimateFee(estimate));
+    BOOST_CHECK_EQUAL(estimate.nFee, 3000);
+    BOOST_CHECK_EQUAL(estimate.strSource, "bundles");
+
+    estimator.Clear();
+    BOOST_CHECK(!estimator.EstimateFee(estimate));
+}
+
+BOOST_AUTO_TEST_CASE(mainchainfees_history_limit)
+{
+    CMainchainFeeEstimator estimator;
+    for (size_t i = 0; i < MAINCHAIN_FEE_BUNDLE_HISTORY * 2; i++)
+        estimator.AddBundleOutcome(MakeBundle(i < MAINCHAIN_FEE_BUNDLE_HISTORY ? 100 : 200, 1, WITHDRAWAL_BUNDLE_SPENT));
+    for (size_t i = 0; i < MAINCHAIN_FEE_SAMPLE_HISTORY * 2; i++)
+        estimator.AddMainchainFeeSample(GetRandHash(), 1);
+
+    // Only the most recent outcomes are kept
+    MainchainFeeEstimate estimate;
+    BOOST_CHECK(estimator.EstimateFee(estimate));
+    BOOST_CHECK_EQUAL(estimator.GetBundles().size(), MAINCHAIN_FEE_BUNDLE_HISTORY);
+    BOOST_CHECK_EQUAL(estimate.nSamples, MAINCHAIN_FEE_SAMPLE_HISTORY);
+    BOOST_CHECK_EQUAL(estimate.nFee, 200);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
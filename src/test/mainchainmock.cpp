@@ -0,0 +1,426 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/mainchainmock.h>
+
+#include <core_io.h>
+#include <hash.h>
+#include <sidechain.h>
+#include <sidechainclient.h>
+#include <univalue.h>
+#include <utiltime.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+static const CAmount DEFAULT_MOCK_AVERAGE_FEE = 10000;
+
+MockMainchain::MockMainchain(int64_t nLatencyMicrosIn)
+{
+    nLatencyMicros = nLatencyMicrosIn;
+    nAverageFee = DEFAULT_MOCK_AVERAGE_FEE;
+    nReorg = 0;
+    amountCTIP = 0;
+
+    // Genesis block
+    Block genesis;
+    genesis.hash = (CHashWriter(SER_GETHASH, 0) << std::string("mockmainchain")).GetHash();
+    genesis.nTime = GetTime();
+    vBlock.push_back(genesis);
+    mapBlockHeight[genesis.hash] = 0;
+
+    SetMainchainRequestHandler(std::bind(&MockMainchain::HandleRequest, this, std::placeholders::_1, std::placeholders::_2));
+}
+
+MockMainchain::~MockMainchain()
+{
+    SetMainchainRequestHandler(MainchainRequestHandler());
+}
+
+void MockMainchain::MineBlock()
+{
+    const Block& prev = vBlock.back();
+
+    Block block;
+    block.hash = (CHashWriter(SER_GETHASH, 0) << prev.hash << (uint32_t)vBlock.size() << nReorg).GetHash();
+    // Sidechain blocks take their time from the mainchain block, which must
+    // be increasing and not in the future.
+    block.nTime = std::max<int64_t>(GetTime(), prev.nTime + 1);
+    block.mapBMM.swap(mapBMMQueued);
+    block.vDeposit.swap(vDepositQueued);
+
+    // The coinbase and BMM requests come before the deposits
+    for (size_t i = 0; i < block.vDeposit.size(); i++) {
+        block.vDeposit[i].hashBlock = block.hash;
+        block.vDeposit[i].nTx = 1 + block.mapBMM.size() + i;
+    }
+
+    mapBlockHeight[block.hash] = vBlock.size();
+    vBlock.push_back(std::move(block));
+}
+
+void MockMainchain::Mine(int nBlocks)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    for (int i = 0; i < nBlocks; i++)
+        MineBlock();
+}
+
+void MockMainchain::Reorg(int nDisconnect, int nConnect)
+{
+    std::lock_guard<std::mutex> lock(cs);
+
+    // The BMM commitments and deposits of the disconnected blocks are
+    // dropped, and so are the queued BMM requests, which were made for the
+    // old tip, and queued deposits, which may spend an orphaned CTIP.
+    nDisconnect = std::min<int>(nDisconnect, vBlock.size() - 1);
+    for (int i = 0; i < nDisconnect; i++) {
+        mapBlockHeight.erase(vBlock.back().hash);
+        vBlock.pop_back();
+    }
+    mapBMMQueued.clear();
+    vDepositQueued.clear();
+
+    ctip.SetNull();
+    amountCTIP = 0;
+    for (const Block& block : vBlock) {
+        if (!block.vDeposit.empty()) {
+            const CTransactionRef& tx = block.vDeposit.back().tx;
+            ctip = COutPoint(tx->GetHash(), 1);
+            amountCTIP = tx->vout[1].nValue;
+        }
+    }
+
+    nReorg++;
+    for (int i = 0; i < nConnect; i++)
+        MineBlock();
+}
+
+uint256 MockMainchain::QueueBMM(const uint256& hashBMM)
+{
+    uint256 txid = (CHashWriter(SER_GETHASH, 0) << hashBMM << (uint32_t)vBlock.size() << nReorg).GetHash();
+    mapBMMQueued[hashBMM] = txid;
+    return txid;
+}
+
+uint256 MockMainchain::AddBMMCommit(const uint256& hashBMM)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return QueueBMM(hashBMM);
+}
+
+uint256 MockMainchain::AddDeposit(const std::string& strDest, CAmount amount)
+{
+    std::lock_guard<std::mutex> lock(cs);
+
+    // Deposit layout: the previous CTIP and the depositor's coins are spent,
+    // the destination is in an OP_RETURN output followed by the new CTIP.
+    CMutableTransaction mtx;
+    mtx.nVersion = 2;
+    if (!ctip.IsNull())
+        mtx.vin.push_back(CTxIn(ctip));
+    mtx.vin.push_back(CTxIn(COutPoint((CHashWriter(SER_GETHASH, 0) << strDest << amount << ctip).GetHash(), 0)));
+
+    std::vector<unsigned char> vchDest(strDest.begin(), strDest.end());
+    mtx.vout.push_back(CTxOut(0, CScript() << OP_RETURN << vchDest));
+    mtx.vout.push_back(CTxOut(amountCTIP + amount, CScript() << OP_TRUE));
+
+    Deposit deposit;
+    deposit.tx = MakeTransactionRef(std::move(mtx));
+    deposit.strDest = strDest;
+    deposit.nTx = 0; // Set when mined
+    vDepositQueued.push_back(deposit);
+
+    ctip = COutPoint(deposit.tx->GetHash(), 1);
+    amountCTIP += amount;
+
+    return deposit.tx->GetHash();
+}
+
+void MockMainchain::SetWithdrawalBundleSpent(const uint256& hash)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    setWithdrawalBundleSpent.insert(hash);
+}
+
+void MockMainchain::SetWithdrawalBundleFailed(const uint256& hash)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    setWithdrawalBundleFailed.insert(hash);
+}
+
+void MockMainchain::SetWorkScore(const uint256& hash, int nWorkScore)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    mapWorkScore[hash] = nWorkScore;
+}
+
+void MockMainchain::SetAverageFee(CAmount nFee)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    nAverageFee = nFee;
+}
+
+void MockMainchain::SetLatency(int64_t nMicros)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    nLatencyMicros = nMicros;
+}
+
+int MockMainchain::GetHeight() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return vBlock.size() - 1;
+}
+
+uint256 MockMainchain::GetBlockHash(int nHeight) const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (nHeight < 0 || nHeight >= (int)vBlock.size())
+        return uint256();
+    return vBlock[nHeight].hash;
+}
+
+uint256 MockMainchain::GetTipHash() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return vBlock.back().hash;
+}
+
+std::vector<uint256> MockMainchain::GetWithdrawalBundles() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return vWithdrawalBundle;
+}
+
+uint64_t MockMainchain::GetRequestCount(const std::string& strMethod) const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (!strMethod.empty()) {
+        std::map<std::string, uint64_t>::const_iterator it = mapRequestCount.find(strMethod);
+        return it == mapRequestCount.end() ? 0 : it->second;
+    }
+
+    uint64_t nCount = 0;
+    for (const auto& p : mapRequestCount)
+        nCount += p.second;
+    return nCount;
+}
+
+std::vector<const MockMainchain::Deposit*> MockMainchain::GetDeposits() const
+{
+    std::vector<const Deposit*> vDeposit;
+    for (const Block& block : vBlock) {
+        for (const Deposit& deposit : block.vDeposit)
+            vDeposit.push_back(&deposit);
+    }
+    return vDeposit;
+}
+
+bool MockMainchain::HandleRequest(const std::string& strRequest, std::string& strReply)
+{
+    UniValue request;
+    if (!request.read(strRequest) || !request.isObject())
+        return false;
+
+    const UniValue& method = find_value(request, "method");
+    const UniValue& params = find_value(request, "params");
+    if (!method.isStr() || !params.isArray())
+        return false;
+
+    int64_t nLatency;
+    UniValue result;
+    bool fOk;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        mapRequestCount[method.get_str()]++;
+        nLatency = nLatencyMicros;
+        try {
+            fOk = Call(method.get_str(), params, result);
+        } catch (const std::exception&) {
+            // Invalid parameters
+            fOk = false;
+        }
+    }
+
+    if (nLatency > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(nLatency));
+
+    if (!fOk)
+        return false;
+
+    UniValue reply(UniValue::VOBJ);
+    reply.pushKV("result", result);
+    reply.pushKV("error", NullUniValue);
+    reply.pushKV("id", find_value(request, "id"));
+    strReply = reply.write();
+
+    return true;
+}
+
+bool MockMainchain::Call(const std::string& strMethod, const UniValue& params, UniValue& result)
+{
+    if (strMethod == "getblockcount") {
+        result = UniValue((int)vBlock.size() - 1);
+        return true;
+    }
+
+    if (strMethod == "getblockhash") {
+        if (params.size() < 1 || !params[0].isNum())
+            return false;
+        const int nHeight = params[0].get_int();
+        if (nHeight < 0 || nHeight >= (int)vBlock.size())
+            return false;
+        result = UniValue(vBlock[nHeight].hash.GetHex());
+        return true;
+    }
+
+    if (strMethod == "verifybmm") {
+        if (params.size() < 2)
+            return false;
+        std::map<uint256, int>::const_iterator it = mapBlockHeight.find(uint256S(params[0].get_str()));
+        if (it == mapBlockHeight.end())
+            return false;
+        const Block& block = vBlock[it->second];
+        std::map<uint256, uint256>::const_iterator itBMM = block.mapBMM.find(uint256S(params[1].get_str()));
+        if (itBMM == block.mapBMM.end())
+            return false;
+
+        UniValue bmm(UniValue::VOBJ);
+        bmm.pushKV("txid", itBMM->second.GetHex());
+        bmm.pushKV("time", (uint64_t)block.nTime);
+        result = UniValue(UniValue::VOBJ);
+        result.pushKV("bmm", bmm);
+        return true;
+    }
+
+    if (strMethod == "createbmmcriticaldatatx") {
+        if (params.size() < 3)
+            return false;
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", QueueBMM(uint256S(params[2].get_str())).GetHex());
+        result = UniValue(UniValue::VOBJ);
+        result.pushKV("txid", obj);
+        return true;
+    }
+
+    if (strMethod == "listsidechaindeposits") {
+        std::vector<const Deposit*> vDeposit = GetDeposits();
+
+        // Only list the deposits after the one the sidechain has
+        size_t nStart = 0;
+        if (params.size() >= 2) {
+            const uint256 txid = uint256S(params[1].get_str());
+            nStart = vDeposit.size();
+            for (size_t i = 0; i < vDeposit.size(); i++) {
+                if (vDeposit[i]->tx->GetHash() == txid) {
+                    nStart = i + 1;
+                    break;
+                }
+            }
+        }
+
+        // Newest first, like the mainchain node
+        result = UniValue(UniValue::VARR);
+        for (size_t i = vDeposit.size(); i > nStart; i--) {
+            const Deposit& deposit = *vDeposit[i - 1];
+            UniValue obj(UniValue::VOBJ);
+            obj.pushKV("nsidechain", (int)THIS_SIDECHAIN);
+            obj.pushKV("strdest", deposit.strDest);
+            obj.pushKV("txhex", EncodeHexTx(*deposit.tx));
+            obj.pushKV("nburnindex", 1);
+            obj.pushKV("ntx", (int)deposit.nTx);
+            obj.pushKV("hashblock", deposit.hashBlock.GetHex());
+            result.push_back(obj);
+        }
+        return true;
+    }
+
+    if (strMethod == "verifydeposit") {
+        if (params.size() < 3 || !params[2].isNum())
+            return false;
+        std::map<uint256, int>::const_iterator it = mapBlockHeight.find(uint256S(params[0].get_str()));
+        if (it == mapBlockHeight.end())
+            return false;
+        const uint256 txid = uint256S(params[1].get_str());
+        for (const Deposit& deposit : vBlock[it->second].vDeposit) {
+            if (deposit.tx->GetHash() == txid && (int)deposit.nTx == params[2].get_int()) {
+                result = UniValue(txid.GetHex());
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (strMethod == "listsidechainctip") {
+        std::vector<const Deposit*> vDeposit = GetDeposits();
+        if (vDeposit.empty())
+            return false;
+        result = UniValue(UniValue::VOBJ);
+        result.pushKV("txid", vDeposit.back()->tx->GetHash().GetHex());
+        result.pushKV("n", 1);
+        return true;
+    }
+
+    if (strMethod == "getaveragefee") {
+        result = UniValue(UniValue::VOBJ);
+        result.pushKV("feeaverage", ValueFromAmount(nAverageFee));
+        return true;
+    }
+
+    if (strMethod == "getworkscore") {
+        if (params.size() < 2)
+            return false;
+        std::map<uint256, int>::const_iterator it = mapWorkScore.find(uint256S(params[1].get_str()));
+        if (it == mapWorkScore.end())
+            return false;
+        result = UniValue(it->second);
+        return true;
+    }
+
+    if (strMethod == "receivewithdrawalbundle") {
+        if (params.size() < 2)
+            return false;
+        CMutableTransaction mtx;
+        if (!DecodeHexTx(mtx, params[1].get_str()))
+            return false;
+        const uint256 hash = mtx.GetHash();
+        if (std::find(vWithdrawalBundle.begin(), vWithdrawalBundle.end(), hash) == vWithdrawalBundle.end())
+            vWithdrawalBundle.push_back(hash);
+        result = UniValue(hash.GetHex());
+        return true;
+    }
+
+    if (strMethod == "listwithdrawalstatus") {
+        // Bundles still tracked by the mainchain SCDB
+        result = UniValue(UniValue::VARR);
+        for (const uint256& hash : vWithdrawalBundle) {
+            if (setWithdrawalBundleSpent.count(hash) || setWithdrawalBundleFailed.count(hash))
+                continue;
+            std::map<uint256, int>::const_iterator it = mapWorkScore.find(hash);
+            UniValue obj(UniValue::VOBJ);
+            obj.pushKV("hash", hash.GetHex());
+            obj.pushKV("nworkscore", it == mapWorkScore.end() ? 1 : it->second);
+            result.push_back(obj);
+        }
+        return true;
+    }
+
+    if (strMethod == "havespentwithdrawal") {
+        if (params.size() < 1)
+            return false;
+        result = UniValue((bool)setWithdrawalBundleSpent.count(uint256S(params[0].get_str())));
+        return true;
+    }
+
+    if (strMethod == "havefailedwithdrawal") {
+        if (params.size() < 1)
+            return false;
+        result = UniValue((bool)setWithdrawalBundleFailed.count(uint256S(params[0].get_str())));
+        return true;
+    }
+
+    return false;
+}
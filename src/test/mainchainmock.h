@@ -0,0 +1,124 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TEST_MAINCHAINMOCK_H
+#define BITCOIN_TEST_MAINCHAINMOCK_H
+
+#include <amount.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+class UniValue;
+
+/**
+ * In process stand-in for the mainchain node.
+ *
+ * While it exists, all requests SidechainClient would send to the mainchain
+ * are answered from a synthetic chain instead. Blocks are mined on demand and
+ * include the BMM requests and deposits made since the previous block, so
+ * sidechain code can be tested and benchmarked deterministically without a
+ * mainchain node. An optional latency is added to every request to model the
+ * round trip to a real node.
+ *
+ * Only one mock may exist at a time.
+ */
+class MockMainchain
+{
+public:
+    explicit MockMainchain(int64_t nLatencyMicrosIn = 0);
+    ~MockMainchain();
+
+    MockMainchain(const MockMainchain&) = delete;
+    MockMainchain& operator=(const MockMainchain&) = delete;
+
+    /** Mine nBlocks blocks, the first includes the queued BMM and deposits */
+    void Mine(int nBlocks = 1);
+
+    /** Replace the last nDisconnect blocks with nConnect new blocks */
+    void Reorg(int nDisconnect, int nConnect);
+
+    /** Queue a BMM commitment of h* hashBMM for the next block */
+    uint256 AddBMMCommit(const uint256& hashBMM);
+
+    /**
+     * Queue a deposit of amount to strDest for the next block. Deposits spend
+     * the CTIP of the previous one. Returns the deposit txid.
+     */
+    uint256 AddDeposit(const std::string& strDest, CAmount amount);
+
+    /** Mark a withdrawal bundle the mainchain received as spent or failed */
+    void SetWithdrawalBundleSpent(const uint256& hash);
+    void SetWithdrawalBundleFailed(const uint256& hash);
+
+    void SetWorkScore(const uint256& hash, int nWorkScore);
+    void SetAverageFee(CAmount nFee);
+    void SetLatency(int64_t nMicros);
+
+    /** Height of the tip, the genesis block has height 0 */
+    int GetHeight() const;
+    uint256 GetBlockHash(int nHeight) const;
+    uint256 GetTipHash() const;
+
+    /** Withdrawal bundles received, in order */
+    std::vector<uint256> GetWithdrawalBundles() const;
+
+    /** Number of requests for strMethod, or of all requests if empty */
+    uint64_t GetRequestCount(const std::string& strMethod = "") const;
+
+private:
+    struct Deposit
+    {
+        CTransactionRef tx;
+        std::string strDest;
+        uint256 hashBlock;
+        uint32_t nTx;
+    };
+
+    struct Block
+    {
+        uint256 hash;
+        uint32_t nTime;
+        std::map<uint256, uint256> mapBMM; // h* -> BMM request txid
+        std::vector<Deposit> vDeposit;
+    };
+
+    mutable std::mutex cs;
+
+    int64_t nLatencyMicros;
+    CAmount nAverageFee;
+
+    /** Changes the hashes of the blocks mined after a reorg */
+    uint32_t nReorg;
+
+    std::vector<Block> vBlock;
+    std::map<uint256, int> mapBlockHeight;
+
+    std::map<uint256, uint256> mapBMMQueued;
+    std::vector<Deposit> vDepositQueued;
+
+    /** CTIP output of the last deposit */
+    COutPoint ctip;
+    CAmount amountCTIP;
+
+    std::vector<uint256> vWithdrawalBundle;
+    std::set<uint256> setWithdrawalBundleSpent;
+    std::set<uint256> setWithdrawalBundleFailed;
+    std::map<uint256, int> mapWorkScore;
+
+    std::map<std::string, uint64_t> mapRequestCount;
+
+    void MineBlock();
+    uint256 QueueBMM(const uint256& hashBMM);
+    std::vector<const Deposit*> GetDeposits() const;
+    bool HandleRequest(const std::string& strRequest, std::string& strReply);
+    bool Call(const std::string& strMethod, const UniValue& params, UniValue& result);
+};
+
+#endif // BITCOIN_TEST_MAINCHAINMOCK_H
@@ -2,9 +2,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <consensus/validation.h>
+#include <key.h>
 #include <policy/policy.h>
+#include <script/interpreter.h>
+#include <sidechain.h>
 #include <txmempool.h>
 #include <util.h>
+#include <validation.h>
 
 #include <test/test_bitcoin.h>
 
@@ -571,4 +576,346 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolSidechainIndexTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+
+    // Transactions making withdrawals with mainchain fees 3000, 1000 and
+    // 2000, the first one makes two
+    std::vector<CMutableTransaction> vtx(3);
+    std::vector<uint256> vID;
+    for (size_t i = 0; i < vtx.size(); i++) {
+        vtx[i].vin.resize(1);
+        vtx[i].vin[0].scriptSig = CScript() << (int)i;
+        for (int j = 0; j < (i == 0 ? 2 : 1); j++) {
+            SidechainWithdrawal withdrawal;
+            withdrawal.nSidechain = THIS_SIDECHAIN;
+            withdrawal.strDestination = "dest" + std::to_string(i);
+            withdrawal.strRefundDestination = "refund" + std::to_string(i);
+            withdrawal.amount = COIN;
+            withdrawal.mainchainFee = (i == 0 ? 3000 - j * 2500 : i == 1 ? 1000 : 2000);
+            withdrawal.hashBlindTx = GetRandHash();
+            vtx[i].vout.push_back(CTxOut(CAmount(0), withdrawal.GetScript()));
+            vID.push_back(withdrawal.GetID());
+        }
+        pool.addUnchecked(vtx[i].GetHash(), entry.FromTx(vtx[i]));
+    }
+
+    std::vector<CTxMemPoolSidechainEntry> vWithdrawal = pool.GetWithdrawalsByMainchainFee();
+    BOOST_REQUIRE_EQUAL(vWithdrawal.size(), 4U);
+    BOOST_CHECK_EQUAL(vWithdrawal[0].mainchainFee, 3000);
+    BOOST_CHECK(vWithdrawal[0].id == vID[0]);
+    BOOST_CHECK(vWithdrawal[0].txid == vtx[0].GetHash());
+    BOOST_CHECK_EQUAL(vWithdrawal[0].strDestination, "dest0");
+    BOOST_CHECK_EQUAL(vWithdrawal[0].amount, COIN);
+    BOOST_CHECK_EQUAL(vWithdrawal[1].mainchainFee, 2000);
+    BOOST_CHECK_EQUAL(vWithdrawal[2].mainchainFee, 1000);
+    BOOST_CHECK_EQUAL(vWithdrawal[3].mainchainFee, 500);
+    BOOST_CHECK(vWithdrawal[3].id == vID[1]);
+    BOOST_CHECK_EQUAL(pool.GetWithdrawalsByMainchainFee(2).size(), 2U);
+
+    // A refund request for the withdrawal with fee 1000
+    CMutableTransaction txRefund;
+    txRefund.vin.resize(1);
+    txRefund.vin[0].scriptSig = CScript() << OP_11;
+    txRefund.vout.resize(1);
+    pool.addUnchecked(txRefund.GetHash(), entry.WithdrawalRefund(vID[2]).FromTx(txRefund));
+    entry.WithdrawalRefund(uint256());
+
+    BOOST_CHECK(pool.WithdrawalRefundExists(vID[2]));
+    BOOST_CHECK(!pool.WithdrawalRefundExists(vID[0]));
+    CTxMemPoolSidechainEntry refund;
+    BOOST_CHECK(pool.GetWithdrawalRefund(vID[2], refund));
+    BOOST_CHECK(refund.txid == txRefund.GetHash());
+    BOOST_CHECK_EQUAL(pool.GetWithdrawalsByMainchainFee().size(), 4U);
+
+    // Removing a transaction removes all of its withdrawals
+    pool.removeRecursive(vtx[0]);
+    vWithdrawal = pool.GetWithdrawalsByMainchainFee();
+    BOOST_REQUIRE_EQUAL(vWithdrawal.size(), 2U);
+    BOOST_CHECK_EQUAL(vWithdrawal[0].mainchainFee, 2000);
+    BOOST_CHECK_EQUAL(vWithdrawal[1].mainchainFee, 1000);
+
+    pool.removeRecursive(txRefund);
+    BOOST_CHECK(!pool.WithdrawalRefundExists(vID[2]));
+    BOOST_CHECK(!pool.GetWithdrawalRefund(vID[2], refund));
+
+    pool.clear();
+    BOOST_CHECK(pool.GetWithdrawalsByMainchainFee().empty());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolAncestorMainchainScoreTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+
+    // A pays a high fee
+    CMutableTransaction txA;
+    txA.vin.resize(1);
+    txA.vin[0].scriptSig = CScript() << OP_1;
+    txA.vout.resize(1);
+    txA.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    txA.vout[0].nValue = COIN;
+    pool.addUnchecked(txA.GetHash(), entry.Fee(5000LL).FromTx(txA));
+
+    // B pays a low fee, but makes a withdrawal with a high mainchain fee
+    SidechainWithdrawal withdrawal;
+    withdrawal.nSidechain = THIS_SIDECHAIN;
+    withdrawal.strDestination = "dest";
+    withdrawal.strRefundDestination = "refund";
+    withdrawal.amount = COIN;
+    withdrawal.mainchainFee = 50000;
+    withdrawal.hashBlindTx = GetRandHash();
+
+    CMutableTransaction txB;
+    txB.vin.resize(1);
+    txB.vin[0].scriptSig = CScript() << OP_2;
+    txB.vout.resize(2);
+    txB.vout[0].scriptPubKey = CScript() << OP_2 << OP_EQUAL;
+    txB.vout[0].nValue = COIN;
+    txB.vout[1].scriptPubKey = withdrawal.GetScript();
+    pool.addUnchecked(txB.GetHash(), entry.Fee(2000LL).FromTx(txB));
+
+    // C spends B and pays a lower fee, the mainchain fee of its parent
+    // doesn't count towards its score
+    CMutableTransaction txC;
+    txC.vin.resize(1);
+    txC.vin[0].prevout = COutPoint(txB.GetHash(), 0);
+    txC.vin[0].scriptSig = CScript() << OP_3;
+    txC.vout.resize(1);
+    txC.vout[0].scriptPubKey = CScript() << OP_3 << OP_EQUAL;
+    txC.vout[0].nValue = COIN;
+    pool.addUnchecked(txC.GetHash(), entry.Fee(500LL).FromTx(txC));
+
+    BOOST_CHECK_EQUAL(pool.mapTx.find(txA.GetHash())->GetMainchainFee(), 0);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(txB.GetHash())->GetMainchainFee(), 50000);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(txC.GetHash())->GetMainchainFee(), 0);
+
+    std::vector<uint256> vFee;
+    for (const CTxMemPoolEntry& e : pool.mapTx.get<ancestor_score>())
+        vFee.push_back(e.GetTx().GetHash());
+    BOOST_REQUIRE_EQUAL(vFee.size(), 3U);
+    BOOST_CHECK(vFee[0] == txA.GetHash());
+    BOOST_CHECK(vFee[1] == txB.GetHash());
+    BOOST_CHECK(vFee[2] == txC.GetHash());
+
+    // The miner ranks the entries by mainchain fees itself, the mempool
+    // keeps no index for it
+    CompareTxMemPoolEntryByAncestorMainchainFee compare;
+    const CTxMemPoolEntry& entryA = *pool.mapTx.find(txA.GetHash());
+    const CTxMemPoolEntry& entryB = *pool.mapTx.find(txB.GetHash());
+    const CTxMemPoolEntry& entryC = *pool.mapTx.find(txC.GetHash());
+    BOOST_CHECK(compare(entryB, entryA));
+    BOOST_CHECK(compare(entryA, entryC));
+    BOOST_CHECK(!compare(entryA, entryB));
+
+    // Prioritising A above B moves it back to the front
+    pool.PrioritiseTransaction(txA.GetHash(), 100000LL);
+    BOOST_CHECK(compare(entryA, entryB));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolUpdateTransactionsFromBlockTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+
+    // P1 and P2 are in a disconnected block, P2 spends P1
+    CMutableTransaction txP1;
+    txP1.vin.resize(1);
+    txP1.vin[0].scriptSig = CScript() << OP_1;
+    txP1.vout.resize(2);
+    txP1.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    txP1.vout[0].nValue = COIN;
+    txP1.vout[1].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    txP1.vout[1].nValue = COIN;
+
+    CMutableTransaction txP2;
+    txP2.vin.resize(1);
+    txP2.vin[0].prevout = COutPoint(txP1.GetHash(), 0);
+    txP2.vin[0].scriptSig = CScript() << OP_2;
+    txP2.vout.resize(2);
+    txP2.vout[0].scriptPubKey = CScript() << OP_2 << OP_EQUAL;
+    txP2.vout[0].nValue = COIN;
+    txP2.vout[1].scriptPubKey = CScript() << OP_2 << OP_EQUAL;
+    txP2.vout[1].nValue = COIN;
+
+    // C1 spends both, C2 spends C1. They stayed in the mempool.
+    CMutableTransaction txC1;
+    txC1.vin.resize(2);
+    txC1.vin[0].prevout = COutPoint(txP1.GetHash(), 1);
+    txC1.vin[1].prevout = COutPoint(txP2.GetHash(), 1);
+    txC1.vout.resize(1);
+    txC1.vout[0].scriptPubKey = CScript() << OP_3 << OP_EQUAL;
+    txC1.vout[0].nValue = COIN;
+
+    CMutableTransaction txC2;
+    txC2.vin.resize(1);
+    txC2.vin[0].prevout = COutPoint(txC1.GetHash(), 0);
+    txC2.vout.resize(1);
+    txC2.vout[0].scriptPubKey = CScript() << OP_4 << OP_EQUAL;
+    txC2.vout[0].nValue = COIN;
+
+    pool.addUnchecked(txC1.GetHash(), entry.Fee(1000LL).FromTx(txC1));
+    pool.addUnchecked(txC2.GetHash(), entry.Fee(2000LL).FromTx(txC2));
+
+    // Re-add the block transactions the way a reorg does
+    pool.addUnchecked(txP1.GetHash(), entry.Fee(3000LL).FromTx(txP1));
+    pool.addUnchecked(txP2.GetHash(), entry.Fee(4000LL).FromTx(txP2));
+    std::vector<uint256> vHashUpdate;
+    vHashUpdate.push_back(txP1.GetHash());
+    vHashUpdate.push_back(txP2.GetHash());
+    pool.UpdateTransactionsFromBlock(vHashUpdate);
+
+    CTxMemPool::txiter itP1 = pool.mapTx.find(txP1.GetHash());
+    CTxMemPool::txiter itP2 = pool.mapTx.find(txP2.GetHash());
+    CTxMemPool::txiter itC1 = pool.mapTx.find(txC1.GetHash());
+    CTxMemPool::txiter itC2 = pool.mapTx.find(txC2.GetHash());
+
+    // Shared descendants are counted once
+    BOOST_CHECK_EQUAL(itP1->GetCountWithDescendants(), 4U);
+    BOOST_CHECK_EQUAL(itP1->GetModFeesWithDescendants(), 10000LL);
+    BOOST_CHECK_EQUAL(itP2->GetCountWithDescendants(), 3U);
+    BOOST_CHECK_EQUAL(itP2->GetModFeesWithDescendants(), 7000LL);
+    BOOST_CHECK_EQUAL(itC1->GetCountWithDescendants(), 2U);
+
+    BOOST_CHECK_EQUAL(itC1->GetCountWithAncestors(), 3U);
+    BOOST_CHECK_EQUAL(itC1->GetModFeesWithAncestors(), 8000LL);
+    BOOST_CHECK_EQUAL(itC2->GetCountWithAncestors(), 4U);
+    BOOST_CHECK_EQUAL(itC2->GetModFeesWithAncestors(), 10000LL);
+
+    CTxMemPool::setEntries setDescendants;
+    pool.CalculateDescendants(itP1, setDescendants);
+    BOOST_CHECK_EQUAL(setDescendants.size(), 4U);
+
+    // Walking on from a set that already holds some descendants adds the rest
+    setDescendants.clear();
+    pool.CalculateDescendants(itC1, setDescendants);
+    pool.CalculateDescendants(itP2, setDescendants);
+    BOOST_CHECK_EQUAL(setDescendants.size(), 3U);
+    BOOST_CHECK(!setDescendants.count(itP1));
+
+    CTxMemPool::setEntries setAncestors;
+    std::string dummy;
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    BOOST_CHECK(pool.CalculateMemPoolAncestors(*itC2, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false));
+    BOOST_CHECK_EQUAL(setAncestors.size(), 3U);
+
+    // The limits still count every ancestor once
+    setAncestors.clear();
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(*itC2, setAncestors, 3, nNoLimit, nNoLimit, nNoLimit, dummy, false));
+    setAncestors.clear();
+    BOOST_CHECK(pool.CalculateMemPoolAncestors(*itC2, setAncestors, 4, nNoLimit, nNoLimit, nNoLimit, dummy, false));
+
+    // Removing P1 as if it was mined again updates its descendants
+    CTxMemPool::setEntries setRemove;
+    setRemove.insert(itP1);
+    pool.RemoveStaged(setRemove, true);
+    itC2 = pool.mapTx.find(txC2.GetHash());
+    BOOST_CHECK_EQUAL(itC2->GetCountWithAncestors(), 3U);
+    BOOST_CHECK_EQUAL(itC2->GetModFeesWithAncestors(), 7000LL);
+}
+
+/** Create a transaction paying nFee, signed with key, spending a P2PK output */
+static CTransactionRef SpendP2PK(const COutPoint& prevout, const CScript& scriptPubKey, CAmount nValue, CAmount nFee, const CKey& key)
+{
+    CMutableTransaction tx;
+    tx.nVersion = 1;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = prevout;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = nValue - nFee;
+    tx.vout[0].scriptPubKey = scriptPubKey;
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, tx, 0, SIGHASH_ALL, nValue, SIGVERSION_BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+
+    return MakeTransactionRef(tx);
+}
+
+static bool ToMemPool(const CTransactionRef& tx)
+{
+    LOCK(cs_main);
+    CValidationState state;
+    return AcceptToMemoryPool(mempool, state, tx, nullptr /* pfMissingInputs */,
+                              nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolPersistTest)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+
+    // Coins to spend
+    std::vector<COutPoint> vOutPoint;
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < 3; i++) {
+            vOutPoint.emplace_back(GetRandHash(), 0);
+            pcoinsTip->AddCoin(vOutPoint.back(), Coin(CTxOut(COIN, scriptPubKey), 1, false), false);
+        }
+    }
+
+    // Two transactions and a child of the first one
+    CTransactionRef txA = SpendP2PK(vOutPoint[0], scriptPubKey, COIN, 10000, key);
+    CTransactionRef txB = SpendP2PK(vOutPoint[1], scriptPubKey, COIN, 10000, key);
+    CTransactionRef txC = SpendP2PK(COutPoint(txA->GetHash(), 0), scriptPubKey, txA->vout[0].nValue, 10000, key);
+    BOOST_CHECK(ToMemPool(txA));
+    BOOST_CHECK(ToMemPool(txB));
+    BOOST_CHECK(ToMemPool(txC));
+    mempool.PrioritiseTransaction(txB->GetHash(), 5000);
+
+    fs::path pathJournal = GetDataDir() / "mempooljournal.dat";
+    BOOST_CHECK(DumpMempool());
+    BOOST_CHECK(!fs::exists(pathJournal));
+
+    // Another transaction goes to the journal
+    CTransactionRef txD = SpendP2PK(vOutPoint[2], scriptPubKey, COIN, 10000, key);
+    BOOST_CHECK(ToMemPool(txD));
+    BOOST_CHECK(DumpMempoolIncremental());
+    BOOST_CHECK(fs::exists(pathJournal));
+
+    // Reload from the dump and the journal, children after their parents
+    mempool.clear();
+    mempool.ClearPrioritisation(txB->GetHash());
+    BOOST_CHECK(LoadMempool());
+    BOOST_CHECK_EQUAL(mempool.size(), 4U);
+    BOOST_CHECK(mempool.exists(txA->GetHash()));
+    BOOST_CHECK(mempool.exists(txB->GetHash()));
+    BOOST_CHECK(mempool.exists(txC->GetHash()));
+    BOOST_CHECK(mempool.exists(txD->GetHash()));
+    {
+        LOCK(mempool.cs);
+        BOOST_CHECK_EQUAL(mempool.mapTx.find(txB->GetHash())->GetModifiedFee(), 15000);
+    }
+
+    // A full dump replaces the journal
+    BOOST_CHECK(DumpMempool());
+    BOOST_CHECK(!fs::exists(pathJournal));
+
+    // A cleared fee delta is journaled too, as when its transaction is mined
+    uint256 hashMined = InsecureRand256();
+    mempool.PrioritiseTransaction(hashMined, 3000);
+    BOOST_CHECK(DumpMempool());
+    mempool.ClearPrioritisation(hashMined);
+    BOOST_CHECK(DumpMempoolIncremental());
+    BOOST_CHECK(fs::exists(pathJournal));
+    mempool.clear();
+    mempool.ClearPrioritisation(txB->GetHash());
+    BOOST_CHECK(LoadMempool());
+    BOOST_CHECK_EQUAL(mempool.size(), 4U);
+    {
+        LOCK(mempool.cs);
+        BOOST_CHECK(!mempool.mapDeltas.count(hashMined));
+        BOOST_CHECK_EQUAL(mempool.mapTx.find(txB->GetHash())->GetModifiedFee(), 15000);
+    }
+
+    mempool.clear();
+    mempool.ClearPrioritisation(txB->GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 
 #include <policy/policy.h>
 #include <policy/fees.h>
+#include <streams.h>
 #include <txmempool.h>
 #include <uint256.h>
 #include <util.h>
@@ -12,6 +13,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <fstream>
+
 BOOST_FIXTURE_TEST_SUITE(policyestimator_tests, BasicTestingSetup)
 
 BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
@@ -179,4 +182,91 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BlockPolicyEstimatesWriteRead)
+{
+    CBlockPolicyEstimator feeEst;
+    CTxMemPool mpool(&feeEst);
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 0LL;
+
+    // Confirm higher fee txs sooner, leave some unconfirmed so failures are
+    // tracked too
+    std::vector<uint256> vHash;
+    for (int blocknum = 0; blocknum < 100; blocknum++) {
+        std::vector<CTransactionRef> block;
+        for (int j = 0; j < 10; j++) {
+            tx.vin[0].prevout.n = 100 * blocknum + j;
+            mpool.addUnchecked(tx.GetHash(), entry.Fee(1000 * (j + 1)).Height(blocknum).FromTx(tx));
+            vHash.push_back(tx.GetHash());
+        }
+        for (const uint256& hash : vHash) {
+            CTransactionRef ptx = mpool.get(hash);
+            if (ptx && (ptx->vin[0].prevout.n % 10 >= 5 || blocknum % 3 == 0) && ptx->vin[0].prevout.n % 7)
+                block.push_back(ptx);
+        }
+        mpool.removeForBlock(block, blocknum + 1);
+    }
+
+    // Like on shutdown, the txs left in the mempool count as failures and
+    // the counters of unconfirmed txs, which aren't written, are emptied
+    feeEst.FlushUnconfirmed();
+
+    fs::path path = fs::temp_directory_path() / fs::unique_path("fee_estimates_%%%%%%%%.dat");
+    {
+        CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!fileout.IsNull());
+        BOOST_CHECK(feeEst.Write(fileout));
+    }
+
+    CBlockPolicyEstimator feeEstRead;
+    {
+        CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!filein.IsNull());
+        BOOST_CHECK(feeEstRead.Read(filein));
+    }
+    fs::remove(path);
+
+    // The estimates read back are the same for every horizon and target
+    BOOST_CHECK_EQUAL(feeEstRead.GetBestSeenHeight(), 100U);
+    int nEstimates = 0;
+    const FeeEstimateHorizon horizons[] = {FeeEstimateHorizon::SHORT_HALFLIFE, FeeEstimateHorizon::MED_HALFLIFE, FeeEstimateHorizon::LONG_HALFLIFE};
+    for (FeeEstimateHorizon horizon : horizons) {
+        BOOST_CHECK_EQUAL(feeEstRead.HighestTargetTracked(horizon), feeEst.HighestTargetTracked(horizon));
+        for (unsigned int i = 1; i <= feeEst.HighestTargetTracked(horizon); i++) {
+            EstimationResult result, resultRead;
+            CFeeRate feeRate = feeEst.estimateRawFee(i, 0.85, horizon, &result);
+            CFeeRate feeRateRead = feeEstRead.estimateRawFee(i, 0.85, horizon, &resultRead);
+            BOOST_CHECK(feeRate == feeRateRead);
+            if (feeRate != CFeeRate(0))
+                nEstimates++;
+            BOOST_CHECK_EQUAL(result.pass.withinTarget, resultRead.pass.withinTarget);
+            BOOST_CHECK_EQUAL(result.fail.leftMempool, resultRead.fail.leftMempool);
+        }
+    }
+    BOOST_CHECK(nEstimates > 0);
+
+    // Writing again gives the same file
+    {
+        path = fs::temp_directory_path() / fs::unique_path("fee_estimates_%%%%%%%%.dat");
+        CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        feeEst.Write(fileout);
+    }
+    fs::path pathRead = fs::temp_directory_path() / fs::unique_path("fee_estimates_%%%%%%%%.dat");
+    {
+        CAutoFile fileout(fsbridge::fopen(pathRead, "wb"), SER_DISK, CLIENT_VERSION);
+        feeEstRead.Write(fileout);
+    }
+    BOOST_CHECK_EQUAL(fs::file_size(path), fs::file_size(pathRead));
+    std::ifstream file(path.string(), std::ios::binary), fileRead(pathRead.string(), std::ios::binary);
+    BOOST_CHECK(std::equal(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), std::istreambuf_iterator<char>(fileRead)));
+    file.close();
+    fileRead.close();
+    fs::remove(path);
+    fs::remove(pathRead);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 #include <core_io.h>
 #include <key.h>
 #include <keystore.h>
+#include <policy/policy.h>
 #include <script/script.h>
 #include <script/script_error.h>
 #include <script/sign.h>
@@ -1479,4 +1480,97 @@ BOOST_AUTO_TEST_CASE(script_can_append_self)
     BOOST_CHECK(s == d);
 }
 
+/** Check that VerifyScript gives the same result and error as the generic interpreter */
+static void CheckFastPath(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, const CAmount& amount)
+{
+    static const unsigned int vFlags[] = {
+        SCRIPT_VERIFY_NONE,
+        SCRIPT_VERIFY_P2SH,
+        SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS,
+        SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_NULLFAIL,
+        STANDARD_SCRIPT_VERIFY_FLAGS,
+    };
+
+    CMutableTransaction txCredit = BuildCreditingTransaction(scriptPubKey, amount);
+    CMutableTransaction txSpend = BuildSpendingTransaction(scriptSig, witness, txCredit);
+    MutableTransactionSignatureChecker checker(&txSpend, 0, amount);
+    for (unsigned int flags : vFlags) {
+        ScriptError err, errGeneric;
+        bool fResult = VerifyScript(scriptSig, scriptPubKey, &witness, flags, checker, &err);
+        bool fResultGeneric = VerifyScriptGeneric(scriptSig, scriptPubKey, &witness, flags, checker, &errGeneric);
+        BOOST_CHECK_EQUAL(fResult, fResultGeneric);
+        BOOST_CHECK_MESSAGE(err == errGeneric, std::string(FormatScriptError(err)) + " != " + FormatScriptError(errGeneric));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(script_standard_fast_path)
+{
+    const CAmount amount = 1000;
+    CKey key, keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(false);
+    const CPubKey pubkey = key.GetPubKey();
+    const std::vector<unsigned char> vchPubKey = ToByteVector(pubkey);
+    const std::vector<unsigned char> vchPubKeyOther = ToByteVector(keyOther.GetPubKey());
+    const CScriptWitness witnessEmpty;
+
+    // P2PKH
+    {
+        const CScript scriptPubKey = GetScriptForDestination(pubkey.GetID());
+        CMutableTransaction txSpend = BuildSpendingTransaction(CScript(), witnessEmpty, BuildCreditingTransaction(scriptPubKey, amount));
+        std::vector<unsigned char> vchSig;
+        BOOST_CHECK(key.Sign(SignatureHash(scriptPubKey, txSpend, 0, SIGHASH_ALL, amount, SIGVERSION_BASE), vchSig));
+        vchSig.push_back(SIGHASH_ALL);
+        std::vector<unsigned char> vchSigBad(vchSig);
+        vchSigBad[10] ^= 1;
+        std::vector<unsigned char> vchSigHashType(vchSig);
+        vchSigHashType.back() = 0x21;
+
+        CScriptWitness witness;
+        witness.stack.push_back(vchSig);
+
+        CheckFastPath(CScript() << vchSig << vchPubKey, scriptPubKey, witnessEmpty, amount);
+        CheckFastPath(CScript() << vchSig << vchPubKey, scriptPubKey, witness, amount);
+        CheckFastPath(CScript() << vchSig << vchPubKeyOther, scriptPubKey, witnessEmpty, amount);
+        CheckFastPath(CScript() << vchSigBad << vchPubKey, scriptPubKey, witnessEmpty, amount);
+        CheckFastPath(CScript() << vchSigHashType << vchPubKey, scriptPubKey, witnessEmpty, amount);
+        CheckFastPath(CScript() << std::vector<unsigned char>(2, 0) << vchPubKey, scriptPubKey, witnessEmpty, amount);
+        CheckFastPath(CScript() << vchPubKey, scriptPubKey, witnessEmpty, amount);
+        CheckFastPath(CScript() << vchSig << vchPubKey << OP_NOP, scriptPubKey, witnessEmpty, amount);
+    }
+
+    // P2WPKH
+    {
+        const CScript scriptPubKey = GetScriptForWitness(GetScriptForDestination(pubkey.GetID()));
+        const CScript scriptCode = GetScriptForDestination(pubkey.GetID());
+        CMutableTransaction txSpend = BuildSpendingTransaction(CScript(), witnessEmpty, BuildCreditingTransaction(scriptPubKey, amount));
+        std::vector<unsigned char> vchSig;
+        BOOST_CHECK(key.Sign(SignatureHash(scriptCode, txSpend, 0, SIGHASH_ALL, amount, SIGVERSION_WITNESS_V0), vchSig));
+        vchSig.push_back(SIGHASH_ALL);
+        std::vector<unsigned char> vchSigBad(vchSig);
+        vchSigBad[10] ^= 1;
+
+        CScriptWitness witness;
+        witness.stack = {vchSig, vchPubKey};
+        CheckFastPath(CScript(), scriptPubKey, witness, amount);
+        CheckFastPath(CScript() << OP_0, scriptPubKey, witness, amount);
+        CheckFastPath(CScript(), scriptPubKey, witnessEmpty, amount);
+
+        witness.stack = {vchSig, vchPubKeyOther};
+        CheckFastPath(CScript(), scriptPubKey, witness, amount);
+        witness.stack = {vchSigBad, vchPubKey};
+        CheckFastPath(CScript(), scriptPubKey, witness, amount);
+        witness.stack = {std::vector<unsigned char>(), vchPubKey};
+        CheckFastPath(CScript(), scriptPubKey, witness, amount);
+        witness.stack = {vchSig, vchPubKey, vchPubKey};
+        CheckFastPath(CScript(), scriptPubKey, witness, amount);
+        witness.stack = {std::vector<unsigned char>(MAX_SCRIPT_ELEMENT_SIZE + 1, 0), vchPubKey};
+        CheckFastPath(CScript(), scriptPubKey, witness, amount);
+
+        // A program of all zeros leaves false on the stack
+        witness.stack = {vchSig, vchPubKey};
+        CheckFastPath(CScript(), CScript() << OP_0 << std::vector<unsigned char>(20, 0), witness, amount);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
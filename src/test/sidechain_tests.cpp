@@ -6,6 +6,7 @@
 #include "bmmcache.h"
 #include "base58.h"
 #include "chainparams.h"
+#include "consensus/merkle.h"
 #include "consensus/validation.h"
 #include "core_io.h"
 #include "miner.h"
@@ -18,6 +19,7 @@
 #include "utilstrencodings.h"
 #include "validation.h"
 
+#include "test/mainchainmock.h"
 #include "test/test_bitcoin.h"
 
 #include <boost/test/unit_test.hpp>
@@ -32,6 +34,58 @@ static BlockAssembler AssemblerForTest(const CChainParams& params) {
     return BlockAssembler(params, options);
 }
 
+/** Spend an output paying nValue that is added to the coins cache directly */
+static CTransactionRef SpendNewCoin(CAmount nValue, CAmount nFee, const CScript& scriptPubKey = CScript() << OP_TRUE)
+{
+    const CScript scriptTrue = CScript() << OP_TRUE;
+    const COutPoint prevout(GetRandHash(), 0);
+    pcoinsTip->AddCoin(prevout, Coin(CTxOut(nValue, scriptPubKey), 1, false), false);
+
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = prevout;
+    mtx.vout.push_back(CTxOut(nValue - nFee, scriptTrue));
+    return MakeTransactionRef(std::move(mtx));
+}
+
+/** Hashes of the non coinbase transactions of a block, in block order */
+static std::vector<uint256> GetBlockTxHashes(const CBlock& block)
+{
+    std::vector<uint256> vHash;
+    for (size_t i = 1; i < block.vtx.size(); i++)
+        vHash.push_back(block.vtx[i]->GetHash());
+    return vHash;
+}
+
+/**
+ * A block on top of prev which keeps the prev block commit of prev, so it is
+ * only valid if its mainchain commitments aren't checked
+ */
+static CBlock NextBlockWithPrevCommit(const CBlock& prev)
+{
+    CBlock block = prev;
+    block.hashPrevBlock = prev.GetHash();
+    block.nTime = prev.nTime + 1;
+
+    CMutableTransaction mtxCoinbase(*prev.vtx[0]);
+    mtxCoinbase.vin[0].scriptSig << OP_TRUE;
+    block.vtx[0] = MakeTransactionRef(std::move(mtxCoinbase));
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    return block;
+}
+
+/** Commit the BMM of block in a new mainchain block */
+static void CommitBMM(MockMainchain& mainchain, CBlock& block)
+{
+    mainchain.AddBMMCommit(block.hashMerkleRoot);
+    mainchain.Mine();
+    block.hashMainchainBlock = mainchain.GetTipHash();
+
+    bool fReorg = false;
+    std::vector<uint256> vDisconnected;
+    BOOST_CHECK(UpdateMainBlockHashCache(fReorg, vDisconnected));
+}
+
 BOOST_FIXTURE_TEST_SUITE(sidechain_tests, TestChain100Setup)
 
 BOOST_AUTO_TEST_CASE(sidechain_obj)
@@ -408,10 +462,23 @@ BOOST_AUTO_TEST_CASE(wt_refund_script)
     BOOST_CHECK(idFromScript == wt.GetID());
     BOOST_CHECK(vchSigFromScript == vchSig);
 
-    // Verify refund script
+    // Verify refund script with the signature check deferred and without
+    // storing the result in the cache
     SidechainWithdrawal wtOut;
+    std::vector<CRefundCheck> vChecks;
+    BOOST_CHECK(VerifyWithdrawalRefundRequest(idFromScript, vchSigFromScript, wtOut, false, &vChecks));
+    BOOST_REQUIRE(vChecks.size() == 1);
+    BOOST_CHECK(vChecks.front()());
+
+    // Verify refund script
     BOOST_CHECK(VerifyWithdrawalRefundRequest(idFromScript, vchSigFromScript, wtOut));
 
+    // The refund request was cached by the last check, so there is no
+    // signature check to defer
+    vChecks.clear();
+    BOOST_CHECK(VerifyWithdrawalRefundRequest(idFromScript, vchSigFromScript, wtOut, false, &vChecks));
+    BOOST_CHECK(vChecks.empty());
+
     // Verify again ourselves
     CPubKey pubkey;
     BOOST_CHECK(pubkey.RecoverCompact(hashMessage, vchSig));
@@ -493,6 +560,12 @@ BOOST_AUTO_TEST_CASE(wt_refund_script_invalid_address)
     // Refund script should be invalid
     SidechainWithdrawal wtOut;
     BOOST_CHECK(!VerifyWithdrawalRefundRequest(idFromScript, vchSigFromScript, wtOut));
+
+    // Deferred signature check should fail
+    std::vector<CRefundCheck> vChecks;
+    BOOST_CHECK(VerifyWithdrawalRefundRequest(idFromScript, vchSigFromScript, wtOut, false, &vChecks));
+    BOOST_REQUIRE(vChecks.size() == 1);
+    BOOST_CHECK(!vChecks.front()());
 }
 
 BOOST_AUTO_TEST_CASE(wt_refund_script_invalid_wtid)
@@ -551,6 +624,197 @@ BOOST_AUTO_TEST_CASE(wt_refund_script_invalid_wtid)
     BOOST_CHECK(!VerifyWithdrawalRefundRequest(idFromScript, vchSigFromScript, wtOut));
 }
 
+BOOST_AUTO_TEST_CASE(sidechain_block_template_cache)
+{
+    const CScript scriptPubKey = CScript() << OP_TRUE;
+    TestMemPoolEntryHelper entry;
+
+    CTransactionRef txA = SpendNewCoin(COIN, 10000);
+    CTransactionRef txB = SpendNewCoin(COIN, 20000);
+    {
+        LOCK2(cs_main, mempool.cs);
+        mempool.addUnchecked(txA->GetHash(), entry.Fee(10000).FromTx(*txA));
+        mempool.addUnchecked(txB->GetHash(), entry.Fee(20000).FromTx(*txB));
+    }
+
+    CBlock block;
+    std::string strError;
+    BOOST_CHECK(AssemblerForTest(Params()).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    std::vector<uint256> vHash = {txB->GetHash(), txA->GetHash()};
+    BOOST_CHECK(GetBlockTxHashes(block) == vHash);
+
+    // The unchanged mempool gives the same transactions
+    CBlock blockAgain;
+    BOOST_CHECK(AssemblerForTest(Params()).GenerateBMMBlock(blockAgain, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    BOOST_CHECK(GetBlockTxHashes(blockAgain) == vHash);
+    BOOST_CHECK(blockAgain.vtx[0]->GetValueOut() == 30000);
+
+    // New transactions are added to the cached ones, a child after its parent
+    CMutableTransaction mtxChild;
+    mtxChild.vin.resize(1);
+    mtxChild.vin[0].prevout = COutPoint(txA->GetHash(), 0);
+    mtxChild.vout.push_back(CTxOut(txA->vout[0].nValue - 50000, scriptPubKey));
+    CTransactionRef txChild = MakeTransactionRef(std::move(mtxChild));
+    CTransactionRef txC = SpendNewCoin(COIN, 30000);
+    {
+        LOCK2(cs_main, mempool.cs);
+        mempool.addUnchecked(txChild->GetHash(), entry.Fee(50000).FromTx(*txChild));
+        mempool.addUnchecked(txC->GetHash(), entry.Fee(30000).FromTx(*txC));
+    }
+
+    BOOST_CHECK(AssemblerForTest(Params()).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    vHash = {txB->GetHash(), txA->GetHash(), txChild->GetHash(), txC->GetHash()};
+    BOOST_CHECK(GetBlockTxHashes(block) == vHash);
+    BOOST_CHECK(block.vtx[0]->GetValueOut() == 110000);
+
+    // Transactions that left the mempool are dropped with their descendants
+    {
+        LOCK2(cs_main, mempool.cs);
+        mempool.removeRecursive(*txA);
+    }
+    BOOST_CHECK(AssemblerForTest(Params()).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    vHash = {txB->GetHash(), txC->GetHash()};
+    BOOST_CHECK(GetBlockTxHashes(block) == vHash);
+    BOOST_CHECK(block.vtx[0]->GetValueOut() == 50000);
+
+    // A cached transaction whose fee was lowered below the minimum is left
+    // out
+    mempool.PrioritiseTransaction(txB->GetHash(), -COIN);
+    BOOST_CHECK(AssemblerForTest(Params()).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    vHash = {txC->GetHash()};
+    BOOST_CHECK(GetBlockTxHashes(block) == vHash);
+    mempool.PrioritiseTransaction(txB->GetHash(), COIN);
+    BOOST_CHECK(AssemblerForTest(Params()).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    vHash = {txC->GetHash(), txB->GetHash()};
+    BOOST_CHECK(GetBlockTxHashes(block) == vHash);
+
+    // Added transactions are checked in full
+    CTransactionRef txInvalid = SpendNewCoin(COIN, 10000, CScript() << OP_FALSE);
+    {
+        LOCK2(cs_main, mempool.cs);
+        mempool.addUnchecked(txInvalid->GetHash(), entry.Fee(10000).FromTx(*txInvalid));
+    }
+    BOOST_CHECK_THROW(AssemblerForTest(Params()).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey), std::runtime_error);
+    {
+        LOCK2(cs_main, mempool.cs);
+        mempool.removeRecursive(*txInvalid);
+    }
+
+    // After the failure the template is selected from scratch, by fee rate
+    BOOST_CHECK(AssemblerForTest(Params()).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    vHash = {txC->GetHash(), txB->GetHash()};
+    BOOST_CHECK(GetBlockTxHashes(block) == vHash);
+
+    // With room for two of these transactions, new ones which pay more
+    // replace the cached ones once the block is full
+    BlockAssembler::Options options;
+    options.nBlockMaxWeight = 4000 + 2 * GetTransactionWeight(*txB) + 100;
+    options.blockMinFeeRate = blockMinFeeRate;
+    BOOST_CHECK(BlockAssembler(Params(), options).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    BOOST_CHECK(GetBlockTxHashes(block) == vHash);
+    CTransactionRef txD = SpendNewCoin(COIN, 40000);
+    CTransactionRef txE = SpendNewCoin(COIN, 50000);
+    {
+        LOCK2(cs_main, mempool.cs);
+        mempool.addUnchecked(txD->GetHash(), entry.Fee(40000).FromTx(*txD));
+        mempool.addUnchecked(txE->GetHash(), entry.Fee(50000).FromTx(*txE));
+    }
+    BOOST_CHECK(BlockAssembler(Params(), options).GenerateBMMBlock(block, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    vHash = {txE->GetHash(), txD->GetHash()};
+    BOOST_CHECK(GetBlockTxHashes(block) == vHash);
+
+    mempool.clear();
+}
+
+BOOST_AUTO_TEST_CASE(sidechain_assume_bmm_valid)
+{
+    const CChainParams& chainparams = Params();
+    const CScript scriptPubKey = CScript() << OP_TRUE;
+    MockMainchain mainchain;
+
+    bool fReorg = false;
+    std::vector<uint256> vDisconnected;
+    BOOST_CHECK(UpdateMainBlockHashCache(fReorg, vDisconnected));
+    const CBlockIndex* pindexStart = chainActive.Tip();
+
+    // Three blocks with BMM but the wrong prev block commits, the second one
+    // is assumed to be valid
+    CBlock block1;
+    std::string strError;
+    BOOST_CHECK(AssemblerForTest(chainparams).GenerateBMMBlock(block1, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    mainchain.Mine();
+    CommitBMM(mainchain, block1);
+    CBlock block2 = NextBlockWithPrevCommit(block1);
+    CommitBMM(mainchain, block2);
+    CBlock block3 = NextBlockWithPrevCommit(block2);
+    CommitBMM(mainchain, block3);
+
+    hashAssumeBMMValid = block2.GetHash();
+    CValidationState state;
+    BOOST_CHECK(ProcessNewBlockHeaders({block1, block2, block3}, state, chainparams));
+
+    // The commitments are not checked at or below the assumed block
+    BOOST_CHECK(ProcessNewBlock(chainparams, std::make_shared<const CBlock>(block1), true, nullptr));
+    BOOST_CHECK(ProcessNewBlock(chainparams, std::make_shared<const CBlock>(block2), true, nullptr));
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block2.GetHash());
+
+    // Above it, they are
+    BOOST_CHECK(!ProcessNewBlock(chainparams, std::make_shared<const CBlock>(block3), true, nullptr));
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block2.GetHash());
+
+    CBlock block4;
+    BOOST_CHECK(AssemblerForTest(chainparams).GenerateBMMBlock(block4, strError, nullptr, std::vector<CMutableTransaction>(), uint256(), scriptPubKey));
+    CommitBMM(mainchain, block4);
+    BOOST_CHECK(ProcessNewBlock(chainparams, std::make_shared<const CBlock>(block4), true, nullptr));
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block4.GetHash());
+
+    // The background verification invalidates the first assumed block which
+    // fails, and stops assuming
+    BOOST_CHECK(VerifyAssumedBMMBlocks());
+    BOOST_CHECK(chainActive.Tip() == pindexStart);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(mapBlockIndex[block1.GetHash()]->nStatus & BLOCK_FAILED_VALID);
+        BOOST_CHECK(hashAssumeBMMValid.IsNull());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sidechain_mainchain_connection_ttl)
+{
+    MockMainchain mainchain;
+    gArgs.ForceSetArg("-mainchainconnectionttl", "10");
+
+    // Start later than any check made before
+    const int64_t nTime = GetTime() + 1000;
+    SetMockTime(nTime);
+    const uint64_t nRequests = mainchain.GetRequestCount("getblockcount");
+    BOOST_CHECK(CheckMainchainConnection());
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getblockcount"), nRequests + 1);
+
+    // The check is reused within the TTL
+    SetMockTime(nTime + 9);
+    BOOST_CHECK(CheckMainchainConnection());
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getblockcount"), nRequests + 1);
+
+    // and made again once it expires
+    SetMockTime(nTime + 10);
+    BOOST_CHECK(CheckMainchainConnection());
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getblockcount"), nRequests + 2);
+
+    // Without a TTL every call checks
+    gArgs.ForceSetArg("-mainchainconnectionttl", "0");
+    BOOST_CHECK(CheckMainchainConnection());
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getblockcount"), nRequests + 3);
+
+    // Going back in time expires the check
+    gArgs.ForceSetArg("-mainchainconnectionttl", "10");
+    SetMockTime(nTime);
+    BOOST_CHECK(CheckMainchainConnection());
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getblockcount"), nRequests + 4);
+
+    SetMockTime(0);
+    gArgs.ClearArg("-mainchainconnectionttl");
+}
 
 BOOST_AUTO_TEST_CASE(depositaddress)
 {
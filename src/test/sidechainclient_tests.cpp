@@ -0,0 +1,437 @@
+// Copyright (c) 2026 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bmmcache.h>
+#include <core_io.h>
+#include <sidechain.h>
+#include <sidechainclient.h>
+#include <utilstrencodings.h>
+#include <validation.h>
+
+#include <test/mainchainmock.h>
+#include <test/test_bitcoin.h>
+
+#include <fstream>
+#include <thread>
+
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+
+static const std::string strBlockCountReply = "{\"result\":7,\"error\":null,\"id\":\"SidechainClient\"}";
+
+/** HTTP response the test mainchain servers send */
+static std::string HTTPResponse(int nStatus, const std::string& strBody)
+{
+    return strprintf("HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\n\r\n%s",
+        nStatus, nStatus == 200 ? "OK" : "Error", strBody.size(), strBody);
+}
+
+/**
+ * Request the block count with a server on acceptor answering the first
+ * connection with strResponse. The request header is stored in strRequest.
+ */
+template <typename Acceptor>
+static bool GetBlockCountFromServer(boost::asio::io_service& io_service, Acceptor& acceptor, const std::string& strResponse, std::string& strRequest, int& nBlocks)
+{
+    strRequest.clear();
+
+    typename Acceptor::protocol_type::socket socket(io_service);
+    boost::asio::streambuf buf;
+    acceptor.async_accept(socket, [&](const boost::system::error_code& error) {
+        if (error)
+            return;
+
+        boost::asio::read_until(socket, buf, "\n\n");
+        strRequest.assign(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_end(buf.data()));
+
+        boost::asio::write(socket, boost::asio::buffer(strResponse));
+        socket.close();
+    });
+
+    // The client might not connect at all, so the server is stopped
+    // instead of waiting for the connection
+    std::thread server([&io_service] { io_service.run(); });
+    bool fRet = SidechainClient().GetBlockCount(nBlocks);
+    io_service.stop();
+    server.join();
+    io_service.reset();
+
+    return fRet;
+}
+
+/** Request the block count from a mainchain server on 127.0.0.1 */
+static bool GetBlockCountTCP(const std::string& strResponse, std::string& strRequest, int& nBlocks)
+{
+    using boost::asio::ip::tcp;
+
+    boost::asio::io_service io_service;
+    tcp::acceptor acceptor(io_service, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    gArgs.ForceSetArg("-mainchainrpchost", "127.0.0.1");
+    gArgs.ForceSetArg("-mainchainrpcport", std::to_string(acceptor.local_endpoint().port()));
+
+    return GetBlockCountFromServer(io_service, acceptor, strResponse, strRequest, nBlocks);
+}
+
+/** Authorization header for user:password */
+static std::string AuthHeader(const std::string& strAuth)
+{
+    return "Authorization: Basic " + EncodeBase64(strAuth) + "\n";
+}
+
+BOOST_FIXTURE_TEST_SUITE(sidechainclient_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sidechainclient_block_hashes)
+{
+    MockMainchain mainchain;
+    mainchain.Mine(10);
+
+    SidechainClient client;
+    int nBlocks = 0;
+    BOOST_CHECK(client.GetBlockCount(nBlocks));
+    BOOST_CHECK_EQUAL(nBlocks, 10);
+
+    for (int i = 0; i <= 10; i++) {
+        uint256 hashBlock;
+        BOOST_CHECK(client.GetBlockHash(i, hashBlock));
+        BOOST_CHECK(hashBlock == mainchain.GetBlockHash(i));
+    }
+    uint256 hashBlock;
+    BOOST_CHECK(!client.GetBlockHash(11, hashBlock));
+
+    // The block hash cache follows the mock mainchain through a reorg
+    bmmCache.ResetMainBlockCache();
+    bool fReorg = false;
+    std::vector<uint256> vDisconnected;
+    BOOST_CHECK(UpdateMainBlockHashCache(fReorg, vDisconnected));
+    BOOST_CHECK(!fReorg);
+    BOOST_CHECK(bmmCache.GetLastMainBlockHash() == mainchain.GetTipHash());
+
+    const uint256 hashOrphan = mainchain.GetTipHash();
+    mainchain.Reorg(2, 3);
+    BOOST_CHECK_EQUAL(mainchain.GetHeight(), 11);
+    BOOST_CHECK(mainchain.GetBlockHash(10) != hashOrphan);
+
+    BOOST_CHECK(UpdateMainBlockHashCache(fReorg, vDisconnected));
+    BOOST_CHECK(fReorg);
+    BOOST_CHECK_EQUAL(vDisconnected.size(), 2U);
+    BOOST_CHECK(std::find(vDisconnected.begin(), vDisconnected.end(), hashOrphan) != vDisconnected.end());
+    BOOST_CHECK(bmmCache.GetLastMainBlockHash() == mainchain.GetTipHash());
+    bmmCache.ResetMainBlockCache();
+}
+
+BOOST_AUTO_TEST_CASE(sidechainclient_verify_bmm)
+{
+    MockMainchain mainchain;
+
+    const uint256 hashBMM = GetRandHash();
+    uint256 txidBMM = mainchain.AddBMMCommit(hashBMM);
+    mainchain.Mine();
+
+    SidechainClient client;
+    uint256 txid;
+    uint32_t nTime = 0;
+    BOOST_CHECK(client.VerifyBMM(mainchain.GetTipHash(), hashBMM, txid, nTime));
+    BOOST_CHECK(txid == txidBMM);
+    BOOST_CHECK(nTime != 0);
+
+    // Only the block with the commitment has it
+    BOOST_CHECK(!client.VerifyBMM(mainchain.GetBlockHash(0), hashBMM, txid, nTime));
+    BOOST_CHECK(!client.VerifyBMM(mainchain.GetTipHash(), GetRandHash(), txid, nTime));
+
+    // BMM requests are included in the next block
+    const uint256 hashRequest = GetRandHash();
+    txid = client.SendBMMRequest(hashRequest, mainchain.GetTipHash());
+    BOOST_CHECK(!txid.IsNull());
+    BOOST_CHECK(!client.VerifyBMM(mainchain.GetTipHash(), hashRequest, txid, nTime));
+    mainchain.Mine();
+    BOOST_CHECK(client.VerifyBMM(mainchain.GetTipHash(), hashRequest, txid, nTime));
+}
+
+BOOST_AUTO_TEST_CASE(sidechainclient_deposits)
+{
+    MockMainchain mainchain;
+
+    SidechainClient client;
+    BOOST_CHECK(client.UpdateDeposits(uint256(), 0).empty());
+
+    std::vector<uint256> vTxid;
+    for (int i = 0; i < 3; i++)
+        vTxid.push_back(mainchain.AddDeposit("dest" + std::to_string(i), (i + 1) * COIN));
+    mainchain.Mine();
+    for (int i = 3; i < 5; i++)
+        vTxid.push_back(mainchain.AddDeposit("dest" + std::to_string(i), (i + 1) * COIN));
+    mainchain.Mine();
+
+    // All deposits, in CTIP spend order
+    std::vector<SidechainDeposit> vDeposit = client.UpdateDeposits(uint256(), 0);
+    BOOST_REQUIRE_EQUAL(vDeposit.size(), 5U);
+    for (size_t i = 0; i < vDeposit.size(); i++) {
+        BOOST_CHECK(vDeposit[i].dtx->GetHash() == vTxid[i]);
+        BOOST_CHECK_EQUAL(vDeposit[i].strDest, "dest" + std::to_string(i));
+        BOOST_CHECK(client.VerifyDeposit(vDeposit[i].hashMainchainBlock, vTxid[i], vDeposit[i].nTx));
+    }
+    BOOST_CHECK(vDeposit[0].hashMainchainBlock == mainchain.GetBlockHash(1));
+    BOOST_CHECK(vDeposit[4].hashMainchainBlock == mainchain.GetBlockHash(2));
+    BOOST_CHECK_EQUAL(vDeposit[4].amtUserPayout, 15 * COIN);
+    BOOST_CHECK(!client.VerifyDeposit(vDeposit[0].hashMainchainBlock, vTxid[4], vDeposit[4].nTx));
+
+    std::vector<SidechainDeposit> vReverse(vDeposit.rbegin(), vDeposit.rend());
+    std::vector<SidechainDeposit> vDepositSorted;
+    BOOST_CHECK(SortDeposits(vReverse, vDepositSorted));
+    BOOST_CHECK(vDepositSorted == vDeposit);
+
+    // Deposits after the last one we have
+    std::vector<SidechainDeposit> vNew = client.UpdateDeposits(vTxid[2], vDeposit[2].nBurnIndex);
+    BOOST_REQUIRE_EQUAL(vNew.size(), 2U);
+    BOOST_CHECK(vNew[0].dtx->GetHash() == vTxid[3]);
+    BOOST_CHECK(vNew[1].dtx->GetHash() == vTxid[4]);
+
+    std::pair<uint256, uint32_t> ctip;
+    BOOST_CHECK(client.GetCTIP(ctip));
+    BOOST_CHECK(ctip.first == vTxid[4]);
+    BOOST_CHECK_EQUAL(ctip.second, vDeposit[4].nBurnIndex);
+}
+
+BOOST_AUTO_TEST_CASE(sidechainclient_withdrawal_bundle)
+{
+    MockMainchain mainchain;
+
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vout.push_back(CTxOut(COIN, CScript() << OP_TRUE));
+    const uint256 hash = mtx.GetHash();
+
+    SidechainClient client;
+    std::vector<uint256> vHash;
+    BOOST_CHECK(!client.ListWithdrawalBundleStatus(vHash));
+
+    BOOST_CHECK(client.BroadcastWithdrawalBundle(EncodeHexTx(mtx)));
+    BOOST_CHECK(client.ListWithdrawalBundleStatus(vHash));
+    BOOST_REQUIRE_EQUAL(vHash.size(), 1U);
+    BOOST_CHECK(vHash[0] == hash);
+
+    int nWorkScore = 0;
+    BOOST_CHECK(!client.GetWorkScore(hash, nWorkScore));
+    mainchain.SetWorkScore(hash, 42);
+    BOOST_CHECK(client.GetWorkScore(hash, nWorkScore));
+    BOOST_CHECK_EQUAL(nWorkScore, 42);
+
+    BOOST_CHECK(!client.HaveSpentWithdrawalBundle(hash));
+    BOOST_CHECK(!client.HaveFailedWithdrawalBundle(hash));
+    mainchain.SetWithdrawalBundleSpent(hash);
+    BOOST_CHECK(client.HaveSpentWithdrawalBundle(hash));
+    BOOST_CHECK(!client.HaveFailedWithdrawalBundle(hash));
+
+    vHash.clear();
+    BOOST_CHECK(!client.ListWithdrawalBundleStatus(vHash));
+
+    CAmount nFees = 0;
+    mainchain.SetAverageFee(12345);
+    BOOST_CHECK(client.GetAverageFees(6, 0, nFees));
+    BOOST_CHECK_EQUAL(nFees, 12345);
+}
+
+BOOST_AUTO_TEST_CASE(sidechainclient_mock_requests)
+{
+    SidechainClient client;
+    int nBlocks = 0;
+    {
+        MockMainchain mainchain(1000);
+        int64_t nStart = GetTimeMicros();
+        BOOST_CHECK(client.GetBlockCount(nBlocks));
+        BOOST_CHECK(GetTimeMicros() - nStart >= 1000);
+
+        uint256 hashBlock;
+        BOOST_CHECK(client.GetBlockHash(0, hashBlock));
+        BOOST_CHECK(!client.GetBlockHash(-1, hashBlock));
+        BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getblockcount"), 1U);
+        BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getblockhash"), 2U);
+        BOOST_CHECK_EQUAL(mainchain.GetRequestCount(), 3U);
+    }
+
+    // Requests go to the mainchain node again, which isn't configured
+    BOOST_CHECK(!client.GetBlockCount(nBlocks));
+}
+
+BOOST_AUTO_TEST_CASE(sidechainclient_cache)
+{
+    MockMainchain mainchain;
+    mainchain.Mine(10);
+    mainchain.SetAverageFee(1000);
+    BOOST_CHECK_EQUAL(GetMainchainCacheSize(), 0U);
+
+    // Nothing is cached without a mainchain tip
+    SidechainClient client;
+    uint256 hashBlock;
+    BOOST_CHECK(client.GetBlockHash(5, hashBlock));
+    BOOST_CHECK(client.GetBlockHash(5, hashBlock));
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getblockhash"), 2U);
+
+    bmmCache.ResetMainBlockCache();
+    bool fReorg = false;
+    std::vector<uint256> vDisconnected;
+    BOOST_CHECK(UpdateMainBlockHashCache(fReorg, vDisconnected));
+    const uint64_t nRequests = mainchain.GetRequestCount("getblockhash");
+    const MainchainCacheStats statsStart = GetMainchainCacheStats()["getblockhash"];
+
+    // Block hashes up to the tip come from the main block hash cache, and
+    // updating the main block hash cache doesn't use it
+    BOOST_CHECK(client.GetBlockHash(5, hashBlock));
+    BOOST_CHECK(client.GetBlockHash(5, hashBlock));
+    BOOST_CHECK(hashBlock == mainchain.GetBlockHash(5));
+    BOOST_CHECK(client.GetBlockHash(10, hashBlock));
+    BOOST_CHECK(!client.GetBlockHash(11, hashBlock));
+    BOOST_CHECK(!client.GetBlockHash(11, hashBlock));
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getblockhash"), nRequests + 2);
+    BOOST_CHECK(SidechainClient(false).GetBlockHash(5, hashBlock));
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getblockhash"), nRequests + 3);
+
+    const MainchainCacheStats stats = GetMainchainCacheStats()["getblockhash"];
+    BOOST_CHECK_EQUAL(stats.nHits - statsStart.nHits, 3U);
+    BOOST_CHECK_EQUAL(stats.nMisses - statsStart.nMisses, 2U);
+
+    // Replies which can change without a new tip expire
+    CAmount nFees = 0;
+    BOOST_CHECK(client.GetAverageFees(6, 0, nFees));
+    mainchain.SetAverageFee(2000);
+    BOOST_CHECK(client.GetAverageFees(6, 0, nFees));
+    BOOST_CHECK_EQUAL(nFees, 1000);
+    BOOST_CHECK(client.GetAverageFees(6, 1, nFees));
+    BOOST_CHECK_EQUAL(nFees, 2000);
+    SetMockTime(GetTime() + DEFAULT_MAINCHAIN_CACHE_TTL);
+    BOOST_CHECK(client.GetAverageFees(6, 0, nFees));
+    BOOST_CHECK_EQUAL(nFees, 2000);
+    SetMockTime(0);
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getaveragefee"), 3U);
+
+    // A broadcasted bundle is listed right away
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    std::vector<uint256> vHash;
+    BOOST_CHECK(!client.ListWithdrawalBundleStatus(vHash));
+    BOOST_CHECK(client.BroadcastWithdrawalBundle(EncodeHexTx(mtx)));
+    BOOST_CHECK(client.ListWithdrawalBundleStatus(vHash));
+    BOOST_CHECK(client.ListWithdrawalBundleStatus(vHash));
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("listwithdrawalstatus"), 2U);
+
+    // Replies about a mainchain block are kept across tips, until the block
+    // is disconnected
+    const uint256 hashBMM = GetRandHash();
+    const MainchainCacheStats statsBMMStart = GetMainchainCacheStats()["verifybmm"];
+    BOOST_CHECK(!client.SendBMMRequest(hashBMM, mainchain.GetTipHash()).IsNull());
+    mainchain.Mine();
+    BOOST_CHECK(UpdateMainBlockHashCache(fReorg, vDisconnected));
+    const uint256 hashBMMBlock = mainchain.GetTipHash();
+    uint256 txid;
+    uint32_t nTime = 0;
+    BOOST_CHECK(client.VerifyBMM(hashBMMBlock, hashBMM, txid, nTime));
+    mainchain.Mine();
+    BOOST_CHECK(UpdateMainBlockHashCache(fReorg, vDisconnected));
+    BOOST_CHECK(client.VerifyBMM(hashBMMBlock, hashBMM, txid, nTime));
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("verifybmm"), 1U);
+    mainchain.Reorg(2, 2);
+    BOOST_CHECK(UpdateMainBlockHashCache(fReorg, vDisconnected));
+    BOOST_CHECK(fReorg);
+    BOOST_CHECK(!client.VerifyBMM(hashBMMBlock, hashBMM, txid, nTime));
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("verifybmm"), 2U);
+
+    const MainchainCacheStats statsBMM = GetMainchainCacheStats()["verifybmm"];
+    BOOST_CHECK_EQUAL(statsBMM.nHits - statsBMMStart.nHits, 1U);
+    BOOST_CHECK_EQUAL(statsBMM.nMisses - statsBMMStart.nMisses, 2U);
+
+    // A new tip invalidates everything else
+    mainchain.Mine();
+    BOOST_CHECK(UpdateMainBlockHashCache(fReorg, vDisconnected));
+    mainchain.SetAverageFee(3000);
+    BOOST_CHECK(client.GetAverageFees(6, 0, nFees));
+    BOOST_CHECK_EQUAL(nFees, 3000);
+
+    // Caching can be turned off for the replies that expire
+    gArgs.ForceSetArg("-mainchaincachettl", "0");
+    BOOST_CHECK(client.GetAverageFees(6, 0, nFees));
+    BOOST_CHECK_EQUAL(mainchain.GetRequestCount("getaveragefee"), 5U);
+    gArgs.ForceSetArg("-mainchaincachettl", std::to_string(DEFAULT_MAINCHAIN_CACHE_TTL));
+
+    BOOST_CHECK(GetMainchainCacheSize() > 0);
+    bmmCache.ResetMainBlockCache();
+}
+
+BOOST_AUTO_TEST_CASE(sidechainclient_mainchain_endpoint)
+{
+    std::string strRequest;
+    int nBlocks = 0;
+
+    // No credentials at all
+    BOOST_CHECK(!SidechainClient().GetBlockCount(nBlocks));
+
+    // Our own -rpcuser is used for compatibility
+    gArgs.ForceSetArg("-rpcuser", "sideuser");
+    gArgs.ForceSetArg("-rpcpassword", "sidepass");
+    BOOST_CHECK(GetBlockCountTCP(HTTPResponse(200, strBlockCountReply), strRequest, nBlocks));
+    BOOST_CHECK_EQUAL(nBlocks, 7);
+    BOOST_CHECK(strRequest.find("POST / HTTP/1.1\nHost: 127.0.0.1\n") == 0);
+    BOOST_CHECK(strRequest.find(AuthHeader("sideuser:sidepass")) != std::string::npos);
+
+    // -mainchainrpcuser takes precedence
+    gArgs.ForceSetArg("-mainchainrpcuser", "mainuser");
+    gArgs.ForceSetArg("-mainchainrpcpassword", "mainpass");
+    nBlocks = 0;
+    BOOST_CHECK(GetBlockCountTCP(HTTPResponse(200, strBlockCountReply), strRequest, nBlocks));
+    BOOST_CHECK_EQUAL(nBlocks, 7);
+    BOOST_CHECK(strRequest.find(AuthHeader("mainuser:mainpass")) != std::string::npos);
+
+    // Errors aren't parsed as a reply
+    BOOST_CHECK(!GetBlockCountTCP(HTTPResponse(500, strBlockCountReply), strRequest, nBlocks));
+
+    // The cookie file takes precedence over both, and is read again after
+    // the mainchain node rejected it
+    const fs::path pathTemp = fs::temp_directory_path() / fs::unique_path("test_mainchain_%%%%%%%%");
+    fs::create_directories(pathTemp);
+    const fs::path pathCookie = pathTemp / "mainchain.cookie";
+    {
+        std::ofstream file(pathCookie.string().c_str());
+        file << "__cookie__:first\n";
+    }
+    gArgs.ForceSetArg("-mainchainrpccookiefile", pathCookie.string());
+    BOOST_CHECK(GetBlockCountTCP(HTTPResponse(200, strBlockCountReply), strRequest, nBlocks));
+    BOOST_CHECK(strRequest.find(AuthHeader("__cookie__:first")) != std::string::npos);
+    {
+        std::ofstream file(pathCookie.string().c_str());
+        file << "__cookie__:second\n";
+    }
+    BOOST_CHECK(GetBlockCountTCP(HTTPResponse(200, strBlockCountReply), strRequest, nBlocks));
+    BOOST_CHECK(strRequest.find(AuthHeader("__cookie__:first")) != std::string::npos);
+    BOOST_CHECK(!GetBlockCountTCP(HTTPResponse(401, ""), strRequest, nBlocks));
+    BOOST_CHECK(GetBlockCountTCP(HTTPResponse(200, strBlockCountReply), strRequest, nBlocks));
+    BOOST_CHECK(strRequest.find(AuthHeader("__cookie__:second")) != std::string::npos);
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    // Unix domain socket transport
+    {
+        using boost::asio::local::stream_protocol;
+
+        const fs::path pathSocket = pathTemp / "mainchain.sock";
+        boost::asio::io_service io_service;
+        stream_protocol::acceptor acceptor(io_service, stream_protocol::endpoint(pathSocket.string()));
+        gArgs.ForceSetArg("-mainchainrpcsocket", pathSocket.string());
+
+        nBlocks = 0;
+        BOOST_CHECK(GetBlockCountFromServer(io_service, acceptor, HTTPResponse(200, strBlockCountReply), strRequest, nBlocks));
+        BOOST_CHECK_EQUAL(nBlocks, 7);
+        BOOST_CHECK(strRequest.find(AuthHeader("__cookie__:second")) != std::string::npos);
+    }
+#endif
+    fs::remove_all(pathTemp);
+
+    gArgs.ClearArg("-rpcuser");
+    gArgs.ClearArg("-rpcpassword");
+    gArgs.ClearArg("-mainchainrpcuser");
+    gArgs.ClearArg("-mainchainrpcpassword");
+    gArgs.ClearArg("-mainchainrpchost");
+    gArgs.ClearArg("-mainchainrpcport");
+    gArgs.ClearArg("-mainchainrpccookiefile");
+    gArgs.ClearArg("-mainchainrpcsocket");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -119,6 +119,7 @@ struct TestMemPoolEntryHelper
     TestMemPoolEntryHelper &Height(unsigned int _height) { nHeight = _height; return *this; }
     TestMemPoolEntryHelper &SpendsCoinbase(bool _flag) { spendsCoinbase = _flag; return *this; }
     TestMemPoolEntryHelper &SigOpsCost(unsigned int _sigopsCost) { sigOpCost = _sigopsCost; return *this; }
+    TestMemPoolEntryHelper &WithdrawalRefund(const uint256& _wtID) { fWithdrawalRefund = !_wtID.IsNull(); wtID = _wtID; return *this; }
 };
 
 CBlock getBlock13b8a();
@@ -745,4 +745,36 @@ BOOST_AUTO_TEST_CASE(test_IsStandard)
     BOOST_CHECK(IsStandardTx(t, reason));
 }
 
+BOOST_AUTO_TEST_CASE(cached_sizes)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(2);
+    mtx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    mtx.vin[0].scriptSig = CScript() << OP_1;
+    mtx.vin[1].prevout = COutPoint(InsecureRand256(), 1);
+    mtx.vin[1].scriptWitness.stack.push_back(std::vector<unsigned char>(100, 1));
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 1000;
+    mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+
+    CTransactionRef tx = MakeTransactionRef(mtx);
+    const size_t nStripped = ::GetSerializeSize(*tx, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    const size_t nTotal = ::GetSerializeSize(*tx, SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(nTotal > nStripped);
+    BOOST_CHECK_EQUAL(tx->GetStrippedSize(), nStripped);
+    BOOST_CHECK_EQUAL(tx->GetTotalSize(), nTotal);
+    BOOST_CHECK_EQUAL(GetTransactionWeight(*tx), nStripped * (WITNESS_SCALE_FACTOR - 1) + nTotal);
+
+    // A copy keeps the cached sizes
+    CTransaction txCopy(*tx);
+    BOOST_CHECK_EQUAL(txCopy.GetTotalSize(), nTotal);
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(CMutableTransaction()));
+    block.vtx.push_back(tx);
+    BOOST_CHECK_EQUAL(GetBlockStrippedSize(block), ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    BOOST_CHECK_EQUAL(GetBlockTotalSize(block), ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    BOOST_CHECK_EQUAL(GetBlockWeight(block), GetBlockStrippedSize(block) * (WITNESS_SCALE_FACTOR - 1) + GetBlockTotalSize(block));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #include <pubkey.h>
 #include <txmempool.h>
 #include <random.h>
+#include <script/sigcache.h>
 #include <script/standard.h>
 #include <script/sign.h>
 #include <test/test_bitcoin.h>
@@ -17,6 +18,8 @@
 #include <keystore.h>
 #include <policy/policy.h>
 
+#include <thread>
+
 #include <boost/test/unit_test.hpp>
 
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks);
@@ -368,4 +371,109 @@ BOOST_FIXTURE_TEST_CASE(checkinputs_test, TestChain100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(signature_cache_flush, BasicTestingSetup)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey = key.GetPubKey();
+    const uint256 hash = GetRandHash();
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(key.Sign(hash, vchSig));
+
+    const CTransaction tx;
+    PrecomputedTransactionData txdata(tx);
+    const CachingTransactionSignatureChecker checkerStore(&tx, 0, 0, true, txdata);
+    const CachingTransactionSignatureChecker checker(&tx, 0, 0, false, txdata);
+
+    const SignatureCacheStats stats = GetSignatureCacheStats();
+    BOOST_CHECK(checkerStore.VerifySignature(vchSig, pubkey, hash));
+    BOOST_CHECK_EQUAL(GetSignatureCacheStats().nMisses, stats.nMisses + 1);
+
+    // Stored signatures are only found once they are flushed
+    BOOST_CHECK(checker.VerifySignature(vchSig, pubkey, hash));
+    BOOST_CHECK_EQUAL(GetSignatureCacheStats().nMisses, stats.nMisses + 2);
+    FlushSignatureCache();
+    BOOST_CHECK_EQUAL(GetSignatureCacheStats().nInserts, stats.nInserts + 1);
+    std::thread t([&] {
+        BOOST_CHECK(checker.VerifySignature(vchSig, pubkey, hash));
+    });
+    t.join();
+    BOOST_CHECK_EQUAL(GetSignatureCacheStats().nHits, stats.nHits + 1);
+    BOOST_CHECK_EQUAL(GetSignatureCacheStats().nMisses, stats.nMisses + 2);
+
+    // An invalid signature is never cached
+    vchSig[10] ^= 1;
+    BOOST_CHECK(!checkerStore.VerifySignature(vchSig, pubkey, hash));
+    FlushSignatureCache();
+    BOOST_CHECK_EQUAL(GetSignatureCacheStats().nInserts, stats.nInserts + 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(script_check_batch, BasicTestingSetup)
+{
+    CKey key1, key2;
+    key1.MakeNewKey(true);
+    key2.MakeNewKey(true);
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG;
+
+    // Spends of scriptPubKey, with scriptSig built from a signature by key
+    struct Spend {
+        CScript scriptPubKey;
+        CKey key;
+        bool fCorrupt;
+        std::function<CScript(const std::vector<unsigned char>&)> scriptSig;
+    };
+    const CScript p2pkh = GetScriptForDestination(key1.GetPubKey().GetID());
+    const CScript checksig = CScript() << ToByteVector(key1.GetPubKey()) << OP_CHECKSIG;
+    const CScript multisig = GetScriptForMultisig(1, {key1.GetPubKey(), key2.GetPubKey()});
+    auto p2pkhSig = [&](const std::vector<unsigned char>& vchSig) { return CScript() << vchSig << ToByteVector(key1.GetPubKey()); };
+    auto sig = [](const std::vector<unsigned char>& vchSig) { return CScript() << vchSig; };
+    auto multisigSig = [](const std::vector<unsigned char>& vchSig) { return CScript() << OP_0 << vchSig; };
+
+    auto run = [&](const std::vector<Spend>& vSpend) {
+        std::vector<CTransaction> vTx;
+        std::vector<PrecomputedTransactionData> vTxData;
+        vTx.reserve(vSpend.size());
+        vTxData.reserve(vSpend.size());
+        for (const Spend& spend : vSpend) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+            tx.vout.resize(1);
+            tx.vout[0].nValue = 1000;
+            uint256 hash = SignatureHash(spend.scriptPubKey, tx, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+            std::vector<unsigned char> vchSig;
+            BOOST_CHECK(spend.key.Sign(hash, vchSig));
+            if (spend.fCorrupt)
+                vchSig[10] ^= 1;
+            vchSig.push_back((unsigned char)SIGHASH_ALL);
+            tx.vin[0].scriptSig = spend.scriptSig(vchSig);
+            vTx.emplace_back(tx);
+            vTxData.emplace_back(vTx.back());
+        }
+        std::vector<CScriptCheck> vChecks;
+        for (size_t i = 0; i < vTx.size(); i++)
+            vChecks.emplace_back(CTxOut(0, vSpend[i].scriptPubKey), vTx[i], 0, flags, false, &vTxData[i]);
+        return RunChecks(vChecks);
+    };
+
+    const Spend valid{p2pkh, key1, false, p2pkhSig};
+    const Spend invalid{p2pkh, key1, true, p2pkhSig};
+    BOOST_CHECK(run({valid, valid, valid}));
+    BOOST_CHECK(!run({valid, invalid, valid}));
+    BOOST_CHECK(!run({invalid}));
+
+    // Scripts that are valid because a signature is invalid
+    const Spend checksigNot{CScript(checksig) << OP_NOT, key1, true, sig};
+    const Spend checksigDrop{CScript(checksig) << OP_DROP << OP_1, key1, true, sig};
+    BOOST_CHECK(run({valid, checksigNot, valid}));
+    BOOST_CHECK(run({valid, checksigDrop, valid}));
+    BOOST_CHECK(!run({checksigDrop, invalid}));
+
+    // The signature is tried against the first key before the one it is for
+    const Spend multisigFirst{multisig, key1, false, multisigSig};
+    const Spend multisigSecond{multisig, key2, false, multisigSig};
+    BOOST_CHECK(run({multisigFirst, multisigSecond, valid}));
+    BOOST_CHECK(!run({multisigSecond, invalid}));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
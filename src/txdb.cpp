@@ -324,7 +324,7 @@ bool CSidechainTreeDB::WriteSidechainIndex(const std::vector<std::pair<uint256,
             batch.Write(key, *ptr);
 
             // Also index the WithdrawalBundle by the WithdrawalBundle transaction hash
-            uint256 hashWithdrawalBundle = ptr->tx.GetHash();
+            uint256 hashWithdrawalBundle = ptr->tx->GetHash();
             std::pair<char, uint256> keyTx = std::make_pair(DB_SIDECHAIN_WITHDRAWAL_BUNDLE_OP, hashWithdrawalBundle);
             batch.Write(keyTx, *ptr);
 
@@ -372,7 +372,7 @@ bool CSidechainTreeDB::WriteWithdrawalBundleUpdate(const SidechainWithdrawalBund
     batch.Write(key, withdrawalBundle);
 
     // Also index the WithdrawalBundle by the WithdrawalBundle transaction hash
-    uint256 hashWithdrawalBundle = withdrawalBundle.tx.GetHash();
+    uint256 hashWithdrawalBundle = withdrawalBundle.tx->GetHash();
     std::pair<char, uint256> keyTx = std::make_pair(DB_SIDECHAIN_WITHDRAWAL_BUNDLE_OP, hashWithdrawalBundle);
     batch.Write(keyTx, withdrawalBundle);
 
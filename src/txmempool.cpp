@@ -12,6 +12,7 @@
 #include <policy/policy.h>
 #include <policy/fees.h>
 #include <reverse_iterator.h>
+#include <sidechain.h>
 #include <streams.h>
 #include <timedata.h>
 #include <util.h>
@@ -22,7 +23,7 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
                                  int64_t _nTime, unsigned int _entryHeight,
                                  bool _spendsCoinbase, bool _fWithdrawalRefund, uint256 _wtID, int64_t _sigOpsCost, LockPoints lp):
     tx(_tx), nFee(_nFee), nTime(_nTime), entryHeight(_entryHeight),
-    spendsCoinbase(_spendsCoinbase), fWithdrawalRefund(_fWithdrawalRefund), wtID(_wtID), sigOpCost(_sigOpsCost), lockPoints(lp)
+    spendsCoinbase(_spendsCoinbase), fWithdrawalRefund(_fWithdrawalRefund), wtID(_wtID), nMainchainFee(0), sigOpCost(_sigOpsCost), lockPoints(lp)
 {
     nTxWeight = GetTransactionWeight(*tx);
     nUsageSize = RecursiveDynamicUsage(tx);
@@ -37,6 +38,8 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     nSizeWithAncestors = GetTxSize();
     nModFeesWithAncestors = nFee;
     nSigOpCostWithAncestors = sigOpCost;
+
+    nEpoch = 0;
 }
 
 void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
@@ -56,44 +59,64 @@ size_t CTxMemPoolEntry::GetTxSize() const
     return GetVirtualTransactionSize(nTxWeight, sigOpCost);
 }
 
+CTxMemPool::EpochGuard::EpochGuard(const CTxMemPool& poolIn) : pool(poolIn)
+{
+    assert(!pool.fHaveEpochGuard);
+    pool.nEpoch++;
+    pool.fHaveEpochGuard = true;
+}
+
+CTxMemPool::EpochGuard::~EpochGuard()
+{
+    pool.fHaveEpochGuard = false;
+}
+
 // Update the given tx for any in-mempool descendants.
 // Assumes that setMemPoolChildren is correct for the given tx and all
 // descendants.
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude)
 {
-    setEntries stageEntries, setAllDescendants;
-    stageEntries = GetMemPoolChildren(updateIt);
-
-    while (!stageEntries.empty()) {
-        const txiter cit = *stageEntries.begin();
-        setAllDescendants.insert(cit);
-        stageEntries.erase(cit);
-        const setEntries &setChildren = GetMemPoolChildren(cit);
-        for (const txiter childEntry : setChildren) {
-            cacheMap::iterator cacheIt = cachedDescendants.find(childEntry);
-            if (cacheIt != cachedDescendants.end()) {
-                // We've already calculated this one, just add the entries for this set
-                // but don't traverse again.
-                for (const txiter cacheEntry : cacheIt->second) {
-                    setAllDescendants.insert(cacheEntry);
+    std::vector<txiter> vStage, vAllDescendants;
+    {
+        const EpochGuard epoch(*this);
+        for (const txiter childEntry : GetMemPoolChildren(updateIt)) {
+            visited(childEntry);
+            vStage.push_back(childEntry);
+        }
+
+        while (!vStage.empty()) {
+            const txiter cit = vStage.back();
+            vStage.pop_back();
+            vAllDescendants.push_back(cit);
+            const setEntries &setChildren = GetMemPoolChildren(cit);
+            for (const txiter childEntry : setChildren) {
+                cacheMap::iterator cacheIt = cachedDescendants.find(childEntry);
+                if (cacheIt != cachedDescendants.end()) {
+                    // We've already calculated this one, just add the entries for this set
+                    // but don't traverse again.
+                    for (const txiter cacheEntry : cacheIt->second) {
+                        if (!visited(cacheEntry))
+                            vAllDescendants.push_back(cacheEntry);
+                    }
+                } else if (!visited(childEntry)) {
+                    // Schedule for later processing
+                    vStage.push_back(childEntry);
                 }
-            } else if (!setAllDescendants.count(childEntry)) {
-                // Schedule for later processing
-                stageEntries.insert(childEntry);
             }
         }
     }
-    // setAllDescendants now contains all in-mempool descendants of updateIt.
+    // vAllDescendants now contains all in-mempool descendants of updateIt.
     // Update and add to cached descendant map
     int64_t modifySize = 0;
     CAmount modifyFee = 0;
     int64_t modifyCount = 0;
-    for (txiter cit : setAllDescendants) {
+    std::vector<txiter>& vCachedDescendants = cachedDescendants[updateIt];
+    for (txiter cit : vAllDescendants) {
         if (!setExclude.count(cit->GetTx().GetHash())) {
             modifySize += cit->GetTxSize();
             modifyFee += cit->GetModifiedFee();
             modifyCount++;
-            cachedDescendants[updateIt].insert(cit);
+            vCachedDescendants.push_back(cit);
             // Update ancestor state for each descendant
             mapTx.modify(cit, update_ancestor_state(updateIt->GetTxSize(), updateIt->GetModifiedFee(), 1, updateIt->GetSigOpCost()));
         }
@@ -124,8 +147,6 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
     // setMemPoolChildren will be updated, an assumption made in
     // UpdateForDescendants.
     for (const uint256 &hash : reverse_iterate(vHashesToUpdate)) {
-        // we cache the in-mempool children to avoid duplicate updates
-        setEntries setChildren;
         // calculate children from mapNextTx
         txiter it = mapTx.find(hash);
         if (it == mapTx.end()) {
@@ -134,15 +155,19 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
         auto iter = mapNextTx.lower_bound(COutPoint(hash, 0));
         // First calculate the children, and update setMemPoolChildren to
         // include them, and update their setMemPoolParents to include this tx.
-        for (; iter != mapNextTx.end() && iter->first->hash == hash; ++iter) {
-            const uint256 &childHash = iter->second->GetHash();
-            txiter childIter = mapTx.find(childHash);
-            assert(childIter != mapTx.end());
-            // We can skip updating entries we've encountered before or that
-            // are in the block (which are already accounted for).
-            if (setChildren.insert(childIter).second && !setAlreadyIncluded.count(childHash)) {
-                UpdateChild(it, childIter, true);
-                UpdateParent(childIter, it, true);
+        {
+            // we mark the in-mempool children to avoid duplicate updates
+            const EpochGuard epoch(*this);
+            for (; iter != mapNextTx.end() && iter->first->hash == hash; ++iter) {
+                const uint256 &childHash = iter->second->GetHash();
+                txiter childIter = mapTx.find(childHash);
+                assert(childIter != mapTx.end());
+                // We can skip updating entries we've encountered before or that
+                // are in the block (which are already accounted for).
+                if (!visited(childIter) && !setAlreadyIncluded.count(childHash)) {
+                    UpdateChild(it, childIter, true);
+                    UpdateParent(childIter, it, true);
+                }
             }
         }
         UpdateForDescendants(it, mapMemPoolDescendantsToUpdate, setAlreadyIncluded);
@@ -152,8 +177,12 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
 bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents /* = true */) const
 {
     LOCK(cs);
+    const EpochGuard epoch(*this);
 
-    setEntries parentHashes;
+    // Ancestors found but not walked yet. Entries are marked visited when
+    // they are staged, so parentHashes holds no entry twice and no entry
+    // already in setAncestors.
+    std::vector<txiter> parentHashes;
     const CTransaction &tx = entry.GetTx();
 
     if (fSearchForParents) {
@@ -162,8 +191,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // iterate mapTx to find parents.
         for (unsigned int i = 0; i < tx.vin.size(); i++) {
             txiter piter = mapTx.find(tx.vin[i].prevout.hash);
-            if (piter != mapTx.end()) {
-                parentHashes.insert(piter);
+            if (piter != mapTx.end() && !visited(piter)) {
+                parentHashes.push_back(piter);
                 if (parentHashes.size() + 1 > limitAncestorCount) {
                     errString = strprintf("too many unconfirmed parents [limit: %u]", limitAncestorCount);
                     return false;
@@ -174,16 +203,19 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // If we're not searching for parents, we require this to be an
         // entry in the mempool already.
         txiter it = mapTx.iterator_to(entry);
-        parentHashes = GetMemPoolParents(it);
+        for (const txiter &piter : GetMemPoolParents(it)) {
+            visited(piter);
+            parentHashes.push_back(piter);
+        }
     }
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
 
     while (!parentHashes.empty()) {
-        txiter stageit = *parentHashes.begin();
+        txiter stageit = parentHashes.back();
 
         setAncestors.insert(stageit);
-        parentHashes.erase(stageit);
+        parentHashes.pop_back();
         totalSizeWithAncestors += stageit->GetTxSize();
 
         if (stageit->GetSizeWithDescendants() + entry.GetTxSize() > limitDescendantSize) {
@@ -200,8 +232,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
         for (const txiter &phash : setMemPoolParents) {
             // If this is a new ancestor, add it.
-            if (setAncestors.count(phash) == 0) {
-                parentHashes.insert(phash);
+            if (!visited(phash)) {
+                parentHashes.push_back(phash);
             }
             if (parentHashes.size() + setAncestors.size() + 1 > limitAncestorCount) {
                 errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
@@ -215,7 +247,7 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
 
 void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors)
 {
-    setEntries parentIters = GetMemPoolParents(it);
+    const setEntries &parentIters = GetMemPoolParents(it);
     // add or remove this tx as a child of each parent
     for (txiter piter : parentIters) {
         UpdateChild(piter, it, add);
@@ -262,14 +294,14 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // Here we only update statistics and not data in mapLinks (which
         // we need to preserve until we're finished with all operations that
         // need to traverse the mempool).
+        std::vector<txiter> vDescendants;
         for (txiter removeIt : entriesToRemove) {
-            setEntries setDescendants;
-            CalculateDescendants(removeIt, setDescendants);
-            setDescendants.erase(removeIt); // don't update state for self
+            vDescendants.clear();
+            CalculateDescendants(removeIt, vDescendants);
             int64_t modifySize = -((int64_t)removeIt->GetTxSize());
             CAmount modifyFee = -removeIt->GetModifiedFee();
             int modifySigOps = -removeIt->GetSigOpCost();
-            for (txiter dit : setDescendants) {
+            for (txiter dit : vDescendants) {
                 mapTx.modify(dit, update_ancestor_state(modifySize, modifyFee, -1, modifySigOps));
             }
         }
@@ -329,7 +361,7 @@ void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee,
 }
 
 CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator) :
-    nTransactionsUpdated(0), minerPolicyEstimator(estimator)
+    nTransactionsUpdated(0), minerPolicyEstimator(estimator), nEpoch(0), fHaveEpochGuard(false)
 {
     _clear(); //lock free clear
 
@@ -413,14 +445,60 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     vTxHashes.emplace_back(tx.GetWitnessHash(), newit);
     newit->vTxHashesIdx = vTxHashes.size() - 1;
 
-    // Keep track of Withdrawalrefunds
-    if (entry.IsWithdrawalRefund()) {
-        setWithdrawalRefund.insert(entry.GetWITHDRAWALID());
-    }
+    // Keep track of withdrawals and Withdrawalrefunds
+    AddSidechainEntries(newit);
 
     return true;
 }
 
+size_t CTxMemPoolSidechainEntry::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(strDestination) + memusage::DynamicUsage(strRefundDestination);
+}
+
+void CTxMemPool::AddSidechainEntries(txiter it)
+{
+    const CTransaction& tx = it->GetTx();
+
+    if (it->IsWithdrawalRefund()) {
+        CTxMemPoolSidechainEntry refund;
+        refund.txid = tx.GetHash();
+        refund.fRefund = true;
+        refund.id = it->GetWITHDRAWALID();
+        mapSidechain.insert(refund);
+    }
+
+    CAmount nMainchainFee = 0;
+    for (const CTxOut& txout : tx.vout) {
+        std::vector<unsigned char> vch;
+        if (!txout.scriptPubKey.IsSidechainObj(vch))
+            continue;
+
+        std::unique_ptr<SidechainObj> obj(ParseSidechainObj(vch));
+        if (!obj || obj->sidechainop != DB_SIDECHAIN_WITHDRAWAL_OP)
+            continue;
+
+        const SidechainWithdrawal* withdrawal = static_cast<const SidechainWithdrawal*>(obj.get());
+
+        CTxMemPoolSidechainEntry sidechainEntry;
+        sidechainEntry.txid = tx.GetHash();
+        sidechainEntry.id = withdrawal->GetID();
+        sidechainEntry.amount = withdrawal->amount;
+        sidechainEntry.mainchainFee = withdrawal->mainchainFee;
+        sidechainEntry.strDestination = withdrawal->strDestination;
+        sidechainEntry.strRefundDestination = withdrawal->strRefundDestination;
+
+        auto ret = mapSidechain.insert(sidechainEntry);
+        if (ret.second)
+            cachedInnerUsage += ret.first->DynamicMemoryUsage();
+
+        nMainchainFee += withdrawal->mainchainFee;
+    }
+
+    if (nMainchainFee)
+        mapTx.modify(it, update_mainchain_fee(nMainchainFee));
+}
+
 void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 {
     NotifyEntryRemoved(it->GetSharedTx(), reason);
@@ -438,10 +516,11 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
         vTxHashes.clear();
     }
 
-    // If we are removing a Withdrawalrefund request, also remove the WithdrawalID from set
-    if (it->IsWithdrawalRefund()) {
-        setWithdrawalRefund.erase(it->GetWITHDRAWALID());
-    }
+    // Remove the withdrawals and Withdrawalrefund request of the transaction
+    auto range = mapSidechain.get<sidechain_txid>().equal_range(hash);
+    for (auto itSidechain = range.first; itSidechain != range.second; itSidechain++)
+        cachedInnerUsage -= itSidechain->DynamicMemoryUsage();
+    mapSidechain.get<sidechain_txid>().erase(range.first, range.second);
 
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
@@ -460,22 +539,46 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 // can save time by not iterating over those entries.
 void CTxMemPool::CalculateDescendants(txiter entryit, setEntries &setDescendants)
 {
-    setEntries stage;
-    if (setDescendants.count(entryit) == 0) {
-        stage.insert(entryit);
+    if (setDescendants.count(entryit)) {
+        return;
     }
+    // Entries already in setDescendants only need looking up when the caller
+    // passed some in, everything added here is marked visited.
+    const bool fHaveDescendants = !setDescendants.empty();
+    const EpochGuard epoch(*this);
+    std::vector<txiter> stage(1, entryit);
+    visited(entryit);
     // Traverse down the children of entry, only adding children that are not
     // accounted for in setDescendants already (because those children have either
     // already been walked, or will be walked in this iteration).
     while (!stage.empty()) {
-        txiter it = *stage.begin();
+        txiter it = stage.back();
         setDescendants.insert(it);
-        stage.erase(it);
+        stage.pop_back();
 
         const setEntries &setChildren = GetMemPoolChildren(it);
         for (const txiter &childiter : setChildren) {
-            if (!setDescendants.count(childiter)) {
-                stage.insert(childiter);
+            if (!visited(childiter) && !(fHaveDescendants && setDescendants.count(childiter))) {
+                stage.push_back(childiter);
+            }
+        }
+    }
+}
+
+void CTxMemPool::CalculateDescendants(txiter entryit, std::vector<txiter>& vDescendants) const
+{
+    const EpochGuard epoch(*this);
+    size_t nWalked = vDescendants.size();
+    for (const txiter &childiter : GetMemPoolChildren(entryit)) {
+        visited(childiter);
+        vDescendants.push_back(childiter);
+    }
+    // vDescendants doubles as the queue of entries left to walk
+    while (nWalked < vDescendants.size()) {
+        const setEntries &setChildren = GetMemPoolChildren(vDescendants[nWalked++]);
+        for (const txiter &childiter : setChildren) {
+            if (!visited(childiter)) {
+                vDescendants.push_back(childiter);
             }
         }
     }
@@ -604,6 +707,7 @@ void CTxMemPool::_clear()
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
+    mapSidechain.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
@@ -744,6 +848,11 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
         assert(it2 != mapTx.end());
         assert(&tx == it->second);
     }
+    for (const CTxMemPoolSidechainEntry& sidechainEntry : mapSidechain) {
+        // mapSidechain only has withdrawals and refunds of mempool transactions
+        assert(mapTx.count(sidechainEntry.txid));
+        innerUsage += sidechainEntry.DynamicMemoryUsage();
+    }
 
     assert(totalTxSize == checkTotal);
     assert(innerUsage == cachedInnerUsage);
@@ -825,6 +934,30 @@ std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
     return ret;
 }
 
+std::vector<CTxMemPoolSidechainEntry> CTxMemPool::GetWithdrawalsByMainchainFee(size_t nMax) const
+{
+    LOCK(cs);
+
+    std::vector<CTxMemPoolSidechainEntry> vWithdrawal;
+    auto range = mapSidechain.get<mainchain_fee>().equal_range(boost::make_tuple(false));
+    for (auto it = range.first; it != range.second && (!nMax || vWithdrawal.size() < nMax); it++)
+        vWithdrawal.push_back(*it);
+
+    return vWithdrawal;
+}
+
+bool CTxMemPool::GetWithdrawalRefund(const uint256& wtid, CTxMemPoolSidechainEntry& refund) const
+{
+    LOCK(cs);
+
+    auto it = mapSidechain.get<sidechain_id>().find(boost::make_tuple(true, wtid));
+    if (it == mapSidechain.get<sidechain_id>().end())
+        return false;
+
+    refund = *it;
+    return true;
+}
+
 CTransactionRef CTxMemPool::get(const uint256& hash) const
 {
     LOCK(cs);
@@ -918,7 +1051,7 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::MallocUsage(sizeof(CTxMemPoolSidechainEntry) + 9 * sizeof(void*)) * mapSidechain.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
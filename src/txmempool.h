@@ -22,7 +22,9 @@
 #include <random.h>
 
 #include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/signals2/signal.hpp>
@@ -73,6 +75,7 @@ private:
     bool spendsCoinbase;       //!< keep track of transactions that spend a coinbase
     bool fWithdrawalRefund;            //!< Track transactions that are Withdrawalrefund requests
     uint256 wtID;              //!< The ID of a Withdrawalfor a Withdrawalrefund (if it is one)
+    CAmount nMainchainFee;     //!< Mainchain fees of the withdrawals the transaction makes, set when it is added to the mempool
     int64_t sigOpCost;         //!< Total sigop cost
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
@@ -115,6 +118,8 @@ public:
     // Updates the fee delta used for mining priority score, and the
     // modified fees with descendants.
     void UpdateFeeDelta(int64_t feeDelta);
+    // Sets the mainchain fees once the withdrawals have been parsed
+    void UpdateMainchainFee(CAmount mainchainFee) { nMainchainFee = mainchainFee; }
     // Update the LockPoints after a reorg
     void UpdateLockPoints(const LockPoints& lp);
 
@@ -126,6 +131,7 @@ public:
 
     bool IsWithdrawalRefund() const { return fWithdrawalRefund; }
     uint256 GetWITHDRAWALID() const { return wtID; }
+    const CAmount& GetMainchainFee() const { return nMainchainFee; }
 
     uint64_t GetCountWithAncestors() const { return nCountWithAncestors; }
     uint64_t GetSizeWithAncestors() const { return nSizeWithAncestors; }
@@ -133,6 +139,7 @@ public:
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable uint64_t nEpoch; //!< Last mempool traversal epoch this entry was visited in
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -177,6 +184,16 @@ private:
     int64_t feeDelta;
 };
 
+struct update_mainchain_fee
+{
+    explicit update_mainchain_fee(CAmount _mainchainFee) : mainchainFee(_mainchainFee) { }
+
+    void operator() (CTxMemPoolEntry &e) { e.UpdateMainchainFee(mainchainFee); }
+
+private:
+    CAmount mainchainFee;
+};
+
 struct update_lock_points
 {
     explicit update_lock_points(const LockPoints& _lp) : lp(_lp) { }
@@ -318,10 +335,84 @@ public:
     }
 };
 
+/** \class CompareTxMemPoolEntryByAncestorMainchainFee
+ *
+ *  Like CompareTxMemPoolEntryByAncestorFee, but the mainchain fees of the
+ *  withdrawals an entry makes are added to its fee and its fee with
+ *  ancestors. Mainchain fees are paid in the same (pegged) coin, but out of
+ *  the withdrawn amount on the mainchain, so they are only a miner policy.
+ *  Only the entry's own mainchain fees count, not its ancestors'.
+ */
+class CompareTxMemPoolEntryByAncestorMainchainFee
+{
+public:
+    template<typename T>
+    bool operator()(const T& a, const T& b) const
+    {
+        double a_fee, a_size, b_fee, b_size;
+
+        GetFeeAndSize(a, a_fee, a_size);
+        GetFeeAndSize(b, b_fee, b_size);
+
+        // Avoid division by rewriting (a/b > c/d) as (a*d > c*b).
+        double f1 = a_fee * b_size;
+        double f2 = a_size * b_fee;
+
+        if (f1 == f2) {
+            return a.GetTx().GetHash() < b.GetTx().GetHash();
+        }
+        return f1 > f2;
+    }
+
+    // Return the fee/size we're using for sorting this entry.
+    template <typename T>
+    void GetFeeAndSize(const T &a, double &fee, double &size) const
+    {
+        double fee_self = (double)a.GetModifiedFee() + a.GetMainchainFee();
+        double fee_ancestors = (double)a.GetModFeesWithAncestors() + a.GetMainchainFee();
+
+        // Compare score with ancestors to score of the transaction, and
+        // return the fee/size for the min.
+        double f1 = fee_self * a.GetSizeWithAncestors();
+        double f2 = fee_ancestors * a.GetTxSize();
+
+        if (f1 > f2) {
+            fee = fee_ancestors;
+            size = a.GetSizeWithAncestors();
+        } else {
+            fee = fee_self;
+            size = a.GetTxSize();
+        }
+    }
+};
+
 // Multi_index tag names
 struct descendant_score {};
 struct entry_time {};
 struct ancestor_score {};
+struct ancestor_mainchain_score {};
+struct sidechain_txid {};
+struct sidechain_id {};
+struct mainchain_fee {};
+
+/**
+ * A withdrawal, or a withdrawal refund request, made by a mempool
+ * transaction. A transaction can make several.
+ */
+struct CTxMemPoolSidechainEntry
+{
+    uint256 txid;
+    bool fRefund;
+    uint256 id;                        //!< Withdrawal ID, or the ID of the withdrawal to refund
+    CAmount amount;                    //!< Withdrawals only
+    CAmount mainchainFee;              //!< Withdrawals only
+    std::string strDestination;        //!< Withdrawals only
+    std::string strRefundDestination;  //!< Withdrawals only
+
+    CTxMemPoolSidechainEntry() : fRefund(false), amount(0), mainchainFee(0) {}
+
+    size_t DynamicMemoryUsage() const;
+};
 
 class CBlockPolicyEstimator;
 
@@ -456,6 +547,9 @@ private:
     mutable bool blockSinceLastRollingFeeBump;
     mutable double rollingMinimumFeeRate; //!< minimum fee to get into the pool, decreases exponentially
 
+    mutable uint64_t nEpoch; //!< Current traversal epoch, see EpochGuard
+    mutable bool fHaveEpochGuard;
+
     void trackPackageRemoved(const CFeeRate& rate);
 
 public:
@@ -504,7 +598,35 @@ public:
     const setEntries & GetMemPoolParents(txiter entry) const;
     const setEntries & GetMemPoolChildren(txiter entry) const;
 private:
-    typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
+    typedef std::map<txiter, std::vector<txiter>, CompareIteratorByHash> cacheMap;
+
+    /**
+     * Graph walks over mapLinks mark the entries they reach with the current
+     * epoch instead of collecting them in a setEntries to skip them later.
+     * An EpochGuard starts a fresh epoch for its lifetime, within which
+     * visited() marks an entry and tells whether it was marked already.
+     * Epochs don't nest, so a walk must not call another one.
+     */
+    class EpochGuard
+    {
+    public:
+        explicit EpochGuard(const CTxMemPool& poolIn);
+        ~EpochGuard();
+
+        EpochGuard(const EpochGuard&) = delete;
+        EpochGuard& operator=(const EpochGuard&) = delete;
+
+    private:
+        const CTxMemPool& pool;
+    };
+
+    bool visited(txiter it) const
+    {
+        assert(fHaveEpochGuard);
+        bool fVisited = it->nEpoch == nEpoch;
+        it->nEpoch = nEpoch;
+        return fVisited;
+    }
 
     struct TxLinks {
         setEntries parents;
@@ -514,14 +636,55 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
+    typedef boost::multi_index_container<
+        CTxMemPoolSidechainEntry,
+        boost::multi_index::indexed_by<
+            // by transaction, to remove them with it
+            boost::multi_index::hashed_non_unique<
+                boost::multi_index::tag<sidechain_txid>,
+                boost::multi_index::member<CTxMemPoolSidechainEntry, uint256, &CTxMemPoolSidechainEntry::txid>,
+                SaltedTxidHasher
+            >,
+            // refunds and withdrawals by ID
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::tag<sidechain_id>,
+                boost::multi_index::composite_key<
+                    CTxMemPoolSidechainEntry,
+                    boost::multi_index::member<CTxMemPoolSidechainEntry, bool, &CTxMemPoolSidechainEntry::fRefund>,
+                    boost::multi_index::member<CTxMemPoolSidechainEntry, uint256, &CTxMemPoolSidechainEntry::id>
+                >
+            >,
+            // withdrawals by mainchain fee, highest first
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::tag<mainchain_fee>,
+                boost::multi_index::composite_key<
+                    CTxMemPoolSidechainEntry,
+                    boost::multi_index::member<CTxMemPoolSidechainEntry, bool, &CTxMemPoolSidechainEntry::fRefund>,
+                    boost::multi_index::member<CTxMemPoolSidechainEntry, CAmount, &CTxMemPoolSidechainEntry::mainchainFee>
+                >,
+                boost::multi_index::composite_key_compare<
+                    std::less<bool>,
+                    std::greater<CAmount>
+                >
+            >
+        >
+    > indexed_sidechain_set;
+
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const;
 
-    // In mempool Withdrawalrefund IDs - keep track of them so we don't accept multiple
-    // refunds for the same Withdrawalinto the mempool.
-    std::set<uint256> setWithdrawalRefund;
+    // In mempool withdrawals and Withdrawalrefunds, so that they can be
+    // listed without scanning the mempool, and so that we don't accept
+    // multiple refunds for the same Withdrawalinto the mempool.
+    indexed_sidechain_set mapSidechain;
+
+    /**
+     * Add the withdrawals and refund request of a new entry to mapSidechain,
+     * and set its mainchain fee
+     */
+    void AddSidechainEntries(txiter it);
 
 public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx;
@@ -652,9 +815,15 @@ public:
     bool WithdrawalRefundExists(const uint256& wtid) const
     {
         LOCK(cs);
-        return setWithdrawalRefund.count(wtid);
+        return mapSidechain.get<sidechain_id>().count(boost::make_tuple(true, wtid));
     }
 
+    /** Withdrawals in the mempool by mainchain fee, highest first, at most nMax if nonzero */
+    std::vector<CTxMemPoolSidechainEntry> GetWithdrawalsByMainchainFee(size_t nMax = 0) const;
+
+    /** Get the refund request of the withdrawal wtid if there is one */
+    bool GetWithdrawalRefund(const uint256& wtid, CTxMemPoolSidechainEntry& refund) const;
+
     CTransactionRef get(const uint256& hash) const;
     TxMempoolInfo info(const uint256& hash) const;
     std::vector<TxMempoolInfo> infoAll() const;
@@ -681,6 +850,8 @@ private:
     void UpdateForDescendants(txiter updateIt,
             cacheMap &cachedDescendants,
             const std::set<uint256> &setExclude);
+    /** Collect all in-mempool descendants of it, not including it, into vDescendants */
+    void CalculateDescendants(txiter it, std::vector<txiter>& vDescendants) const;
     /** Update ancestors of hash to add/remove it as a descendant transaction. */
     void UpdateAncestorsOf(bool add, txiter hash, setEntries &setAncestors);
     /** Set ancestor state for an entry */
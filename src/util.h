@@ -291,6 +291,9 @@ public:
     // Forces an arg setting. Called by SoftSetArg() if the arg hasn't already
     // been set. Also called directly in testing.
     void ForceSetArg(const std::string& strArg, const std::string& strValue);
+
+    // Remove an arg setting, used only in testing
+    void ClearArg(const std::string& strArg);
 };
 
 extern ArgsManager gArgs;
@@ -20,7 +20,9 @@
 #include <core_io.h>
 #include <cuckoocache.h>
 #include <hash.h>
+#include <hashsnapshot.h>
 #include <init.h>
+#include <mainchainfees.h>
 #include <net.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
@@ -47,7 +49,9 @@
 #include <warnings.h>
 
 #include <future>
+#include <memory>
 #include <sstream>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -208,6 +212,7 @@ private:
 CCriticalSection cs_main;
 
 BMMCache bmmCache;
+CMainchainFeeEstimator mainchainFeeEstimator;
 
 BlockMap& mapBlockIndex = g_chainstate.mapBlockIndex;
 std::map<uint256, CBlockIndex*>& mapBlockMainHashIndex = g_chainstate.mapBlockMainHashIndex;
@@ -216,6 +221,7 @@ CBlockIndex *pindexBestHeader = nullptr;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nCoinPrefetchThreads = 0;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fTxIndex = false;
@@ -232,6 +238,7 @@ bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
 bool fSidechainIndex = true;
 
 uint256 hashAssumeValid;
+uint256 hashAssumeBMMValid;
 
 CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
 CAmount maxTxFee = DEFAULT_TRANSACTION_MAXFEE;
@@ -247,6 +254,16 @@ const std::string strRefundMessageMagic = "REFUND DhjM9iNapSA 3e243e21\n";
 
 std::mutex mainBlockCacheMutex;
 std::mutex mainBlockCacheReorgMutex;
+std::mutex depositQueueMutex;
+
+/** Whether the deposit queue has been synced with the mainchain since it was
+ *  loaded or cleared. Guarded by depositQueueMutex. */
+static bool fDepositQueueSynced = false;
+
+/** Incremented when the deposit queue is replaced, so that an update which
+ *  downloaded deposits without holding the lock can tell if it is stale.
+ *  Guarded by depositQueueMutex. */
+static uint64_t nDepositQueueGeneration = 0;
 
 // Internal stuff
 namespace {
@@ -1375,6 +1392,53 @@ bool CScriptCheck::operator()() {
     return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata), &error);
 }
 
+bool CScriptCheck::operator()(CSignatureBatch& batch) {
+    if (cacheStore)
+        return (*this)();
+    const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
+    const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
+    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, BatchingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, *txdata, batch), &error);
+}
+
+static bool RunScriptChecks(std::vector<CScriptCheck>& vChecks)
+{
+    CSignatureBatch batch;
+    // End of each check's signatures in the batch
+    std::vector<size_t> vEnd;
+    vEnd.reserve(vChecks.size());
+    for (CScriptCheck& check : vChecks) {
+        const size_t nBegin = batch.size();
+        if (!check(batch)) {
+            batch.Truncate(nBegin);
+            if (!check())
+                return false;
+        }
+        vEnd.push_back(batch.size());
+    }
+
+    if (batch.Verify())
+        return true;
+
+    size_t nBegin = 0;
+    for (size_t i = 0; i < vChecks.size(); i++) {
+        if (!batch.Verify(nBegin, vEnd[i]) && !vChecks[i]())
+            return false;
+        nBegin = vEnd[i];
+    }
+    return true;
+}
+
+bool RunChecks(std::vector<CScriptCheck>& vChecks)
+{
+    bool fOk = RunScriptChecks(vChecks);
+
+    // Check queue workers store signatures in their own buffer, write them
+    // to the cache before the master is told the batch is done
+    FlushSignatureCache();
+
+    return fOk;
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -1386,6 +1450,17 @@ int GetSpendHeight(const CCoinsViewCache& inputs)
 static CuckooCache::cache<uint256, SignatureCacheHasher> scriptExecutionCache;
 static uint256 scriptExecutionCacheNonce(GetRandHash());
 
+/** Script execution cache entry for the scripts of tx checked with flags */
+static uint256 GetScriptExecutionCacheEntry(const CTransaction& tx, unsigned int flags)
+{
+    uint256 hashCacheEntry;
+    // We only use the first 19 bytes of nonce to avoid a second SHA
+    // round - giving us 19 + 32 + 4 = 55 bytes (+ 8 + 1 = 64)
+    static_assert(55 - sizeof(flags) - 32 >= 128/8, "Want at least 128 bits of nonce for script execution cache");
+    CSHA256().Write(scriptExecutionCacheNonce.begin(), 55 - sizeof(flags) - 32).Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+    return hashCacheEntry;
+}
+
 void InitScriptExecutionCache() {
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
@@ -1431,11 +1506,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
             // correct (ie that the transaction hash which is in tx's prevouts
             // properly commits to the scriptPubKey in the inputs view of that
             // transaction).
-            uint256 hashCacheEntry;
-            // We only use the first 19 bytes of nonce to avoid a second SHA
-            // round - giving us 19 + 32 + 4 = 55 bytes (+ 8 + 1 = 64)
-            static_assert(55 - sizeof(flags) - 32 >= 128/8, "Want at least 128 bits of nonce for script execution cache");
-            CSHA256().Write(scriptExecutionCacheNonce.begin(), 55 - sizeof(flags) - 32).Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+            uint256 hashCacheEntry = GetScriptExecutionCacheEntry(tx, flags);
             AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
             if (scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
                 return true;
@@ -1481,6 +1552,12 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                 }
             }
 
+            if (cacheSigStore && !pvChecks) {
+                // Make the signatures we just stored visible to the block
+                // validation threads
+                FlushSignatureCache();
+            }
+
             if (cacheFullScriptStore && !pvChecks) {
                 // We executed all of the provided scripts, and were told to
                 // cache the result. Do so now.
@@ -1711,6 +1788,8 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
                     error("DisconnectBlock(): Failed to write withdrawal bundle undo update!");
                     return DISCONNECT_FAILED;
                 }
+
+                mainchainFeeEstimator.RemoveBundleOutcome(hashWithdrawalBundle);
             }
 
             // If output is a Withdrawal refund request set status back to Withdrawal_UNSPENT
@@ -1811,7 +1890,7 @@ static bool WriteTxIndexDataForBlock(const CBlock& block, CValidationState& stat
     for (const CTransactionRef& tx : block.vtx)
     {
         vPos.push_back(std::make_pair(tx->GetHash(), pos));
-        pos.nTxOffset += ::GetSerializeSize(*tx, SER_DISK, CLIENT_VERSION);
+        pos.nTxOffset += tx->GetTotalSize();
     }
 
     if (!pblocktree->WriteTxIndex(vPos)) {
@@ -1828,6 +1907,129 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CTxCheck> txcheckqueue(128);
+
+void ThreadTxCheck() {
+    RenameThread("bitcoin-txcheck");
+    txcheckqueue.Thread();
+}
+
+bool CTxCheck::operator()() {
+    *pnSigOps = GetLegacySigOpCount(*ptx);
+    return CheckTransaction(*ptx, *pstate, true);
+}
+
+static CCheckQueue<CRefundCheck> refundcheckqueue(128);
+
+void ThreadRefundCheck() {
+    RenameThread("bitcoin-refundch");
+    refundcheckqueue.Thread();
+}
+
+static CCheckQueue<CCoinPrefetch> coinprefetchqueue(16);
+
+void ThreadCoinPrefetch() {
+    RenameThread("bitcoin-prefetch");
+    coinprefetchqueue.Thread();
+}
+
+bool CCoinPrefetch::operator()() {
+    try {
+        pbase->GetCoin(*poutpoint, *pcoin);
+    } catch (const std::runtime_error& e) {
+        // Leave it to ConnectBlock to read the coin again and handle the error
+        *pcoin = Coin();
+    }
+    return true;
+}
+
+void PrefetchCoins(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& base)
+{
+    // Outputs created by the block itself aren't in the database
+    std::set<uint256> setTxid;
+    std::vector<COutPoint> vOutPoint;
+    for (const auto& tx : block.vtx) {
+        if (!tx->IsCoinBase()) {
+            for (const CTxIn& txin : tx->vin) {
+                if (!setTxid.count(txin.prevout.hash) && !cache.HaveCoinInCache(txin.prevout))
+                    vOutPoint.push_back(txin.prevout);
+            }
+        }
+        setTxid.insert(tx->GetHash());
+    }
+    if (vOutPoint.empty())
+        return;
+
+    std::vector<Coin> vCoin(vOutPoint.size());
+    {
+        CCheckQueueControl<CCoinPrefetch> control(&coinprefetchqueue);
+        std::vector<CCoinPrefetch> vChecks;
+        vChecks.reserve(vOutPoint.size());
+        for (size_t i = 0; i < vOutPoint.size(); i++)
+            vChecks.emplace_back(base, vOutPoint[i], vCoin[i]);
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    for (size_t i = 0; i < vOutPoint.size(); i++) {
+        if (!vCoin[i].IsSpent())
+            cache.AddFetchedCoin(vOutPoint[i], std::move(vCoin[i]));
+    }
+}
+
+/**
+ * Cache of withdrawal refund requests whose signature we have already checked,
+ * shared between the memory pool and block validation so that a relayed refund
+ * request doesn't have its key recovered again when it is mined.
+ * Entries are SHA256(nonce || withdrawal id || signature). The withdrawal id
+ * commits to the refund address, so an entry stays valid for as long as the
+ * withdrawal exists. The withdrawal status is not cached and is always checked.
+ */
+static CuckooCache::cache<uint256, SignatureCacheHasher> refundCache;
+static uint256 refundCacheNonce(GetRandHash());
+static boost::shared_mutex cs_refundCache;
+
+static uint256 GetRefundCacheEntry(const uint256& id, const std::vector<unsigned char>& vchSig)
+{
+    uint256 entry;
+    CSHA256().Write(refundCacheNonce.begin(), 32).Write(id.begin(), 32).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    return entry;
+}
+
+void InitRefundCache() {
+    size_t nElems = refundCache.setup_bytes(REFUND_CACHE_SIZE);
+    LogPrintf("Using %zu KiB for withdrawal refund cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >> 10, nElems);
+}
+
+bool CRefundCheck::operator()() {
+    // Regenerate standard refund message & get hash
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << strMessageMagic;
+    ss << strRefundMessageMagic;
+    ss << id.ToString();
+
+    // Recover the public key that signed the refund request
+    CPubKey pubkey;
+    if (!pubkey.RecoverCompact(ss.GetHash(), vchSig)) {
+        LogPrintf("%s: Failed to recover pubkey!\n", __func__);
+        return false;
+    }
+
+    // Verify refund address matches the one recreated from signature
+    if (pubkey.GetID() != keyID) {
+        LogPrintf("%s: Refund address does not match signature!\n", __func__);
+        return false;
+    }
+
+    if (cacheStore) {
+        uint256 entry = GetRefundCacheEntry(id, vchSig);
+        boost::unique_lock<boost::shared_mutex> lock(cs_refundCache);
+        refundCache.insert(entry);
+    }
+    return true;
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -1909,6 +2111,44 @@ static unsigned int GetBlockScriptFlags(const CBlockIndex* pindex, const Consens
 
 
 
+typedef std::unordered_set<uint256, BlockHasher> AssumedBlockSet;
+
+/**
+ * Hashes of the -assumebmmvalid block and its ancestors. Built once, when the
+ * block is loaded at startup or its header arrives, and replaced rather than
+ * modified so that CheckBlock can read it without cs_main.
+ */
+static std::shared_ptr<const AssumedBlockSet> psetAssumeBMMValid;
+
+/** Find the ancestors of the -assumebmmvalid block, if pindex is that block */
+static void ResolveAssumeBMMValid(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (hashAssumeBMMValid.IsNull() || pindex->GetBlockHash() != hashAssumeBMMValid)
+        return;
+
+    std::shared_ptr<AssumedBlockSet> pset = std::make_shared<AssumedBlockSet>();
+    pset->reserve(pindex->nHeight + 1);
+    for (; pindex; pindex = pindex->pprev)
+        pset->insert(pindex->GetBlockHash());
+    std::atomic_store(&psetAssumeBMMValid, std::shared_ptr<const AssumedBlockSet>(pset));
+}
+
+/** Stop assuming valid BMM, once the assumed blocks have been verified */
+static void ClearAssumeBMMValid()
+{
+    AssertLockHeld(cs_main);
+    hashAssumeBMMValid.SetNull();
+    std::atomic_store(&psetAssumeBMMValid, std::shared_ptr<const AssumedBlockSet>());
+}
+
+/** Return true if the block is the -assumebmmvalid block or one of its ancestors */
+static bool AssumeBMMValid(const uint256& hashBlock)
+{
+    std::shared_ptr<const AssumedBlockSet> pset = std::atomic_load(&psetAssumeBMMValid);
+    return pset && pset->count(hashBlock);
+}
+
 static int64_t nTimeCheck = 0;
 static int64_t nTimeForks = 0;
 static int64_t nTimeVerify = 0;
@@ -2019,6 +2259,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     CBlockUndo blockundo;
 
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    CCheckQueueControl<CRefundCheck> refundControl(nScriptCheckThreads ? &refundcheckqueue : nullptr);
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -2051,11 +2292,15 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                             REJECT_INVALID, "verify-withdrawal-refund-no-script");
             }
 
+            // The refund signature is checked by the refund check queue
             SidechainWithdrawal withdrawal;
-            if (!VerifyWithdrawalRefundRequest(id, vchSig, withdrawal)) {
+            std::vector<CRefundCheck> vRefundChecks;
+            bool fCacheRefund = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
+            if (!VerifyWithdrawalRefundRequest(id, vchSig, withdrawal, fCacheRefund, nScriptCheckThreads ? &vRefundChecks : nullptr)) {
                 return state.DoS(100, error("%s: Invalid Withdrawal refund!", __func__),
                             REJECT_INVALID, "verify-withdrawal-refund-invalid");
             }
+            refundControl.Add(vRefundChecks);
 
             if (setRefundWithdrawalID.count(id)) {
                 return state.DoS(100, error("%s: Invalid Withdrawal refund!", __func__),
@@ -2152,9 +2397,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                 // First deposit should be spending current CTIP, find the
                 // current CTIP in the deposit's inputs
                 bool fFound = false;
-                for (const CTxIn& in : vDeposit.front().dtx.vin) {
-                    if (in.prevout.hash == prev.dtx.GetHash() &&
-                            prev.dtx.vout.size() > in.prevout.n &&
+                for (const CTxIn& in : vDeposit.front().dtx->vin) {
+                    if (in.prevout.hash == prev.dtx->GetHash() &&
+                            prev.dtx->vout.size() > in.prevout.n &&
                             prev.nBurnIndex == in.prevout.n) {
                         fFound = true;
                         break;
@@ -2164,13 +2409,13 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                     return state.DoS(90, error("%s: invalid sidechain deposit input:\n%s", __func__, vDeposit.front().ToString()), REJECT_INVALID, "invalid-deposit-input");
                 }
                 // Copy the burn amount from CTIP
-                amountPrev = prev.dtx.vout[prev.nBurnIndex].nValue;
+                amountPrev = prev.dtx->vout[prev.nBurnIndex].nValue;
             }
 
             // Check deposit payout amounts & find coinbase output
             for (const SidechainDeposit& d : vDeposit) {
 
-                CAmount burn = d.dtx.vout[d.nBurnIndex].nValue;
+                CAmount burn = d.dtx->vout[d.nBurnIndex].nValue;
                 CAmount payout = burn - amountPrev;
 
                 amountPrev = burn;
@@ -2283,6 +2528,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                                block.vtx[0]->GetValueOut(), blockReward),
                                REJECT_INVALID, "bad-cb-amount");
 
+    if (!refundControl.Wait())
+        return state.DoS(100, error("%s: Invalid Withdrawal refund!", __func__),
+                    REJECT_INVALID, "verify-withdrawal-refund-invalid");
     if (!control.Wait())
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
@@ -2312,7 +2560,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         if (psidechaintree->GetWithdrawalBundle(hashLatestWithdrawalBundle, withdrawalBundleLatest)) {
             // If we haven't broadcasted the latest bundle yet, do it now
             if (!bmmCache.HaveBroadcastedWithdrawalBundle(hashLatestWithdrawalBundle)) {
-                std::string strHex = EncodeHexTx(withdrawalBundleLatest.tx);
+                std::string strHex = EncodeHexTx(*withdrawalBundleLatest.tx);
                 if (client.BroadcastWithdrawalBundle(strHex)) {
                     bmmCache.StoreBroadcastedWithdrawalBundle(hashLatestWithdrawalBundle);
                 }
@@ -2371,8 +2619,10 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             bool fFailCommit = scriptPubKey.IsWithdrawalBundleFailCommit(hashWithdrawalBundle);
 
             if (fFailCommit || scriptPubKey.IsWithdrawalBundleSpentCommit(hashWithdrawalBundle)) {
-                // Verify with the mainchain when we are also checking BMM
-                if (fCheckBMM) {
+                // Verify with the mainchain when we are also checking BMM.
+                // Blocks covered by -assumebmmvalid are verified later by
+                // VerifyAssumedBMMBlocks.
+                if (fCheckBMM && !(pindex->phashBlock && AssumeBMMValid(pindex->GetBlockHash()))) {
                     bool fVerified = fFailCommit ?
                         client.HaveFailedWithdrawalBundle(hashWithdrawalBundle) :
                         client.HaveSpentWithdrawalBundle(hashWithdrawalBundle);
@@ -2387,7 +2637,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                 // update with the new Withdrawal Bundle status. If the commit is for the
                 // current Withdrawal Bundle (which it always should be in practice) we have
                 // already loaded it.
-                if (hashWithdrawalBundle == withdrawalBundleLatest.tx.GetHash()) {
+                if (hashWithdrawalBundle == withdrawalBundleLatest.tx->GetHash()) {
                     withdrawalBundleLatest.status = fFailCommit ? WITHDRAWAL_BUNDLE_FAILED : WITHDRAWAL_BUNDLE_SPENT;
 
                     // Keep track of the height a Withdrawal Bundle was marked failed
@@ -2397,6 +2647,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                     if (!psidechaintree->WriteWithdrawalBundleUpdate(withdrawalBundleLatest))
                         return state.Error(strprintf("%s: Failed to write Withdrawal Bundle update!\n", __func__));
 
+                    mainchainFeeEstimator.AddBundleOutcome(withdrawalBundleLatest);
+
                 } else {
                     SidechainWithdrawalBundle withdrawalBundle;
                     if (!psidechaintree->GetWithdrawalBundle(hashWithdrawalBundle, withdrawalBundle))
@@ -2410,6 +2662,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
                     if (!psidechaintree->WriteWithdrawalBundleUpdate(withdrawalBundle))
                         return state.Error(strprintf("%s: Failed to write Withdrawal Bundle update!\n", __func__));
+
+                    mainchainFeeEstimator.AddBundleOutcome(withdrawalBundle);
                 }
             }
         }
@@ -2486,7 +2740,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                     id = withdrawalBundle->GetID();
                     obj = (SidechainObj *) withdrawalBundle;
 
-                    LogPrintf("%s: Found new Withdrawal Bundle: %s.\n", __func__, withdrawalBundle->tx.GetHash().ToString());
+                    LogPrintf("%s: Found new Withdrawal Bundle: %s.\n", __func__, withdrawalBundle->tx->GetHash().ToString());
                 }
                 else
                 if (obj->sidechainop == DB_SIDECHAIN_DEPOSIT_OP) {
@@ -2787,6 +3041,7 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetchCoins = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2882,6 +3137,12 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    if (nCoinPrefetchThreads) {
+        PrefetchCoins(blockConnecting, *pcoinsTip, *pcoinsdbview);
+        int64_t nTimePrefetch = GetTimeMicros(); nTimePrefetchCoins += nTimePrefetch - nTime2;
+        LogPrint(BCLog::BENCH, "  - Prefetch coins: %.2fms [%.2fs]\n", (nTimePrefetch - nTime2) * MILLI, nTimePrefetchCoins * MICRO);
+        nTime2 = nTimePrefetch;
+    }
     {
         CCoinsViewCache view(pcoinsTip.get());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
@@ -3330,6 +3591,8 @@ CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
     // Add to index of blocks tracked by their mainchain commitment block hash
     mapBlockMainHashIndex[hashMainBlock] = pindexNew;
 
+    ResolveAssumeBMMValid(pindexNew);
+
     setDirtyBlockIndex.insert(pindexNew);
 
     return pindexNew;
@@ -3472,14 +3735,82 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     return true;
 }
 
+/**
+ * Check the parts of a block which must be verified with the mainchain: BMM,
+ * the prev block commit and deposits.
+ */
+static bool CheckBlockMainchain(const CBlock& block, CValidationState& state, bool fGenesis)
+{
+    // Verify BMM with mainchain
+    if (!VerifyBMM(block))
+        return state.DoS(1, false, REJECT_INVALID, "bad-bmm", true, "invalid bmm / failed to verify BMM for block");
+
+    if (!fGenesis) {
+        // Check required PrevBlockCommit
+        bool fPrevCommitFound = false;
+        for (const CTxOut& out : block.vtx[0]->vout) {
+            uint256 hashPrevMain;
+            uint256 hashPrevSide;
+            if (out.scriptPubKey.IsPrevBlockCommit(hashPrevMain, hashPrevSide)) {
+                if (hashPrevMain != bmmCache.GetMainPrevBlockHash(block.hashMainchainBlock)) {
+                    LogPrintf("%s: Invalid mainchain prevBlock commit: %s != %s\n", __func__, hashPrevMain.ToString(), bmmCache.GetMainPrevBlockHash(block.hashMainchainBlock).ToString());
+                    return state.DoS(25, false, REJECT_INVALID, "bad-mc-prev", false, "invalid mainchin prevBlock commit");
+                }
+                if (hashPrevSide != block.hashPrevBlock) {
+                    LogPrintf("%s: Invalid sidechain prevBlock commit: %s != %s\n", __func__, hashPrevSide.ToString(), block.hashPrevBlock.ToString());
+                    return state.DoS(25, false, REJECT_INVALID, "bad-sc-prev", false, "invalid sidechain prevBlock commit");
+                }
+                fPrevCommitFound = true;
+                break;
+            }
+        }
+        if (!fPrevCommitFound) {
+            LogPrintf("%s: Missing prevBlock commit!\n", __func__);
+            return state.DoS(100, false, REJECT_INVALID, "no-prev-commit", false, "PrevBlockCommit not found!");
+        }
+    }
+
+    // Find deposits and verify that they exist with mainchain
+    for (const CTxOut& out : block.vtx[0]->vout) {
+        const CScript& scriptPubKey = out.scriptPubKey;
+
+        std::vector<unsigned char> vch;
+        if (!scriptPubKey.IsSidechainObj(vch))
+            continue;
+
+        SidechainObj *obj = ParseSidechainObj(vch);
+        if (!obj) {
+            return state.DoS(90, error("%s: invalid sidechain deposit obj script", __func__), REJECT_INVALID, "invalid-sidechain-obj-script");
+        }
+
+        if (obj->sidechainop != DB_SIDECHAIN_DEPOSIT_OP)
+            continue;
+
+        const SidechainDeposit* deposit = (const SidechainDeposit *) obj;
+
+        if (!VerifyDeposit(deposit->hashMainchainBlock, deposit->dtx->GetHash(), deposit->nTx)) {
+            delete obj;
+            return state.DoS(1, error("%s: invalid sidechain deposit", __func__), REJECT_INVALID, "invalid-sidechain-deposit");
+        }
+
+        delete obj;
+    }
+
+    return true;
+}
+
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckMerkleRoot, bool fCheckBMM)
 {
     // These are checks that are independent of context.
 
     bool fGenesis = (block.GetHash() == Params().GetConsensus().hashGenesisBlock);
 
+    // Ancestors of the -assumebmmvalid block skip the mainchain round trips
+    // here and are verified in the background by VerifyAssumedBMMBlocks
+    bool fVerifyMainchain = fCheckBMM && !AssumeBMMValid(block.GetHash());
+
     // Check for mainchain connection
-    if (!fGenesis && fCheckBMM && !CheckMainchainConnection()) {
+    if (!fGenesis && fVerifyMainchain && !CheckMainchainConnection()) {
         SetNetworkActive(false, "Failed to connect to mainchain when checking block!");
         return false;
     }
@@ -3507,7 +3838,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     // checks that use witness data may be performed here.
 
     // Size limits
-    if (block.vtx.empty() || block.vtx.size() * WITNESS_SCALE_FACTOR > MAX_BLOCK_WEIGHT || ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) * WITNESS_SCALE_FACTOR > MAX_BLOCK_WEIGHT)
+    if (block.vtx.empty() || block.vtx.size() * WITNESS_SCALE_FACTOR > MAX_BLOCK_WEIGHT || GetBlockStrippedSize(block) * WITNESS_SCALE_FACTOR > MAX_BLOCK_WEIGHT)
         return state.DoS(100, false, REJECT_INVALID, "bad-blk-length", false, "size limits failed");
 
     // First transaction must be coinbase, the rest must not be
@@ -3517,73 +3848,42 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
         if (block.vtx[i]->IsCoinBase())
             return state.DoS(100, false, REJECT_INVALID, "bad-cb-multiple", false, "more than one coinbase");
 
-    // Verify BMM with mainchain
-    if (fCheckBMM && !VerifyBMM(block))
-        return state.DoS(1, false, REJECT_INVALID, "bad-bmm", true, "invalid bmm / failed to verify BMM for block");
-
-    if (!fGenesis && fCheckBMM) {
-        // Check required PrevBlockCommit
-        bool fPrevCommitFound = false;
-        for (const CTxOut& out : block.vtx[0]->vout) {
-            uint256 hashPrevMain;
-            uint256 hashPrevSide;
-            if (out.scriptPubKey.IsPrevBlockCommit(hashPrevMain, hashPrevSide)) {
-                if (hashPrevMain != bmmCache.GetMainPrevBlockHash(block.hashMainchainBlock)) {
-                    LogPrintf("%s: Invalid mainchain prevBlock commit: %s != %s\n", __func__, hashPrevMain.ToString(), bmmCache.GetMainPrevBlockHash(block.hashMainchainBlock).ToString());
-                    return state.DoS(25, false, REJECT_INVALID, "bad-mc-prev", false, "invalid mainchin prevBlock commit");
-                }
-                if (hashPrevSide != block.hashPrevBlock) {
-                    LogPrintf("%s: Invalid sidechain prevBlock commit: %s != %s\n", __func__, hashPrevSide.ToString(), block.hashPrevBlock.ToString());
-                    return state.DoS(25, false, REJECT_INVALID, "bad-sc-prev", false, "invalid sidechain prevBlock commit");
-                }
-                fPrevCommitFound = true;
-                break;
-            }
-        }
-        if (!fPrevCommitFound) {
-            LogPrintf("%s: Missing prevBlock commit!\n", __func__);
-            return state.DoS(100, false, REJECT_INVALID, "no-prev-commit", false, "PrevBlockCommit not found!");
-        }
-    }
-
-    // Find deposits and verify that they exist with mainchain
-    if (fCheckBMM) {
-        for (const CTxOut& out : block.vtx[0]->vout) {
-            const CScript& scriptPubKey = out.scriptPubKey;
-
-            std::vector<unsigned char> vch;
-            if (!scriptPubKey.IsSidechainObj(vch))
-                continue;
-
-            SidechainObj *obj = ParseSidechainObj(vch);
-            if (!obj) {
-                return state.DoS(90, error("%s: invalid sidechain deposit obj script", __func__), REJECT_INVALID, "invalid-sidechain-obj-script");
-            }
-
-            if (obj->sidechainop != DB_SIDECHAIN_DEPOSIT_OP)
-                continue;
-
-            const SidechainDeposit* deposit = (const SidechainDeposit *) obj;
-
-            if (!VerifyDeposit(deposit->hashMainchainBlock, deposit->dtx.GetHash(), deposit->nTx)) {
-                delete obj;
-                return state.DoS(1, error("%s: invalid sidechain deposit", __func__), REJECT_INVALID, "invalid-sidechain-deposit");
-            }
-
-            delete obj;
-        }
-    }
-
-    // Check transactions
-    for (const auto& tx : block.vtx)
-        if (!CheckTransaction(*tx, state, true))
-            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
-                                 strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
+    // Verify BMM, the prev block commit and deposits with the mainchain
+    if (fVerifyMainchain && !CheckBlockMainchain(block, state, fGenesis))
+        return false;
 
+    // Check transactions and count legacy sigops. Large blocks are checked in
+    // parallel by the tx check queue. If any transaction fails, we check them
+    // again in order below so that the same error is reported.
     unsigned int nSigOps = 0;
-    for (const auto& tx : block.vtx)
-    {
-        nSigOps += GetLegacySigOpCount(*tx);
+    bool fParallelChecked = false;
+    if (nScriptCheckThreads && block.vtx.size() >= MIN_PARALLEL_TX_CHECKS) {
+        std::vector<CValidationState> vState(block.vtx.size());
+        std::vector<unsigned int> vSigOps(block.vtx.size(), 0);
+        std::vector<CTxCheck> vChecks;
+        vChecks.reserve(block.vtx.size());
+        for (size_t i = 0; i < block.vtx.size(); i++)
+            vChecks.push_back(CTxCheck(*block.vtx[i], &vState[i], &vSigOps[i]));
+
+        CCheckQueueControl<CTxCheck> control(&txcheckqueue);
+        control.Add(vChecks);
+        if (control.Wait()) {
+            for (unsigned int n : vSigOps)
+                nSigOps += n;
+            fParallelChecked = true;
+        }
+    }
+
+    if (!fParallelChecked) {
+        for (const auto& tx : block.vtx)
+            if (!CheckTransaction(*tx, state, true))
+                return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
+                                     strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
+
+        for (const auto& tx : block.vtx)
+        {
+            nSigOps += GetLegacySigOpCount(*tx);
+        }
     }
     if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
         return state.DoS(100, false, REJECT_INVALID, "bad-blk-sigops", false, "out-of-bounds SigOpCount");
@@ -3850,7 +4150,7 @@ CScript GenerateBlockVersionCommit(const int32_t nVersion)
     return scriptPubKey;
 }
 
-bool VerifyWithdrawalRefundRequest(const uint256& id, const std::vector<unsigned char>& vchSig, SidechainWithdrawal& withdrawal)
+bool VerifyWithdrawalRefundRequest(const uint256& id, const std::vector<unsigned char>& vchSig, SidechainWithdrawal& withdrawal, bool cacheStore, std::vector<CRefundCheck>* pvChecks)
 {
     if (id.IsNull()) {
         LogPrintf("%s: Null Withdrawal ID!\n", __func__);
@@ -3861,19 +4161,6 @@ bool VerifyWithdrawalRefundRequest(const uint256& id, const std::vector<unsigned
         return false;
     }
 
-    // Regenerate standard refund message & get hash
-    CHashWriter ss(SER_GETHASH, 0);
-    ss << strMessageMagic;
-    ss << strRefundMessageMagic;
-    ss << id.ToString();
-
-    // Recover the public key that signed the refund request
-    CPubKey pubkey;
-    if (!pubkey.RecoverCompact(ss.GetHash(), vchSig)) {
-        LogPrintf("%s: Failed to recover pubkey!\n", __func__);
-        return false;
-    }
-
     // Lookup & verify status of Withdrawal
     if (!psidechaintree->GetWithdrawal(id, withdrawal)) {
         LogPrintf("%s: Withdrawal not found!\n", __func__);
@@ -3884,13 +4171,33 @@ bool VerifyWithdrawalRefundRequest(const uint256& id, const std::vector<unsigned
         LogPrintf("%s: Withdrawal status != Withdrawal_UNSPENT\n", __func__);
         return false;
     }
-    // Verify refund address matches the one recreated from signature
-    if (DecodeDestination(withdrawal.strRefundDestination) != CTxDestination(pubkey.GetID())) {
+
+    // Skip the signature check if we have already checked this refund
+    // request, for example when it was accepted to the memory pool
+    {
+        uint256 entry = GetRefundCacheEntry(id, vchSig);
+        boost::shared_lock<boost::shared_mutex> lock(cs_refundCache);
+        if (refundCache.contains(entry, !cacheStore))
+            return true;
+    }
+
+    // Only refund addresses of a key can sign a refund request
+    CTxDestination dest = DecodeDestination(withdrawal.strRefundDestination);
+    const CKeyID* keyID = boost::get<CKeyID>(&dest);
+    if (!keyID) {
         LogPrintf("%s: Refund address does not match signature!\n", __func__);
         return false;
     }
 
-    return true;
+    // Check that the refund address key signed the refund request
+    CRefundCheck check(id, vchSig, *keyID, cacheStore);
+    if (pvChecks) {
+        pvChecks->push_back(CRefundCheck());
+        check.swap(pvChecks->back());
+        return true;
+    }
+
+    return check();
 }
 
 /** Context-dependent validity checks.
@@ -4124,7 +4431,7 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
 static CDiskBlockPos SaveBlockToDisk(const CBlock& block, int nHeight, const CChainParams& chainparams, const CDiskBlockPos* dbp) {
-    unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+    unsigned int nBlockSize = GetBlockTotalSize(block);
     CDiskBlockPos blockPos;
     if (dbp != nullptr)
         blockPos = *dbp;
@@ -4305,25 +4612,201 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
     return true;
 }
 
+/** The last block template that passed TestBlockTemplateValidity */
+static CBlock blockTemplateChecked;
+
 /**
- * BLOCK PRUNING CODE
+ * Number of transactions at the start of a block template, counting the
+ * coinbase, that are unchanged from the last template that passed. Zero if
+ * the template changed more than by adding transactions and paying their
+ * fees in the coinbase.
  */
-
-/* Calculate the amount of disk space the block & undo files currently use */
-uint64_t CalculateCurrentUsage()
+static size_t GetTemplateTxsChecked(const CBlock& block)
 {
-    LOCK(cs_LastBlockFile);
+    const CBlock& blockChecked = blockTemplateChecked;
+    if (blockChecked.vtx.empty() || block.vtx.size() < blockChecked.vtx.size())
+        return 0;
+    if (block.hashPrevBlock != blockChecked.hashPrevBlock ||
+            block.nVersion != blockChecked.nVersion ||
+            block.hashWithdrawalBundle != blockChecked.hashWithdrawalBundle)
+        return 0;
+
+    // Only the coinbase value and the witness commitment may differ
+    const CTransaction& coinbase = *block.vtx[0];
+    const CTransaction& coinbaseChecked = *blockChecked.vtx[0];
+    const int commitpos = GetWitnessCommitmentIndex(block);
+    if (commitpos != GetWitnessCommitmentIndex(blockChecked))
+        return 0;
+    if (coinbase.nVersion != coinbaseChecked.nVersion ||
+            coinbase.nLockTime != coinbaseChecked.nLockTime ||
+            coinbase.vin != coinbaseChecked.vin ||
+            coinbase.vin[0].scriptWitness.stack != coinbaseChecked.vin[0].scriptWitness.stack ||
+            coinbase.vout.size() != coinbaseChecked.vout.size() ||
+            coinbase.vout[0].scriptPubKey != coinbaseChecked.vout[0].scriptPubKey)
+        return 0;
+    for (size_t i = 1; i < coinbase.vout.size(); i++) {
+        if ((int)i != commitpos && coinbase.vout[i] != coinbaseChecked.vout[i])
+            return 0;
+    }
+
+    for (size_t i = 1; i < blockChecked.vtx.size(); i++) {
+        if (block.vtx[i] != blockChecked.vtx[i] &&
+                block.vtx[i]->GetWitnessHash() != blockChecked.vtx[i]->GetWitnessHash())
+            return 0;
+    }
+
+    return blockChecked.vtx.size();
+}
+
+bool TestBlockTemplateValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev)
+{
+    AssertLockHeld(cs_main);
+    assert(pindexPrev && pindexPrev == chainActive.Tip());
 
-    uint64_t retval = 0;
-    for (const CBlockFileInfo &file : vinfoBlockFile) {
-        retval += file.nSize + file.nUndoSize;
+    const size_t nTxChecked = GetTemplateTxsChecked(block);
+    if (!nTxChecked) {
+        if (!TestBlockValidity(state, chainparams, block, pindexPrev, false, false, false)) {
+            blockTemplateChecked.SetNull();
+            return false;
+        }
+        blockTemplateChecked = block;
+        return true;
     }
-    return retval;
-}
 
-/* Prune a block file (modify associated database entries)*/
-void PruneOneBlockFile(const int fileNumber)
-{
+    const Consensus::Params& consensusParams = chainparams.GetConsensus();
+
+    if (!ContextualCheckBlockHeader(block, state, chainparams, pindexPrev, GetAdjustedTime()))
+        return error("%s: Consensus::ContextualCheckBlockHeader: %s", __func__, FormatStateMessage(state));
+
+    // The same block with a later header time, which can't make a transaction
+    // non-final
+    if (nTxChecked == block.vtx.size() &&
+            block.vtx[0]->GetWitnessHash() == blockTemplateChecked.vtx[0]->GetWitnessHash() &&
+            block.GetBlockTime() >= blockTemplateChecked.GetBlockTime())
+        return true;
+
+    if (!CheckBlock(block, state, consensusParams, false, false))
+        return error("%s: Consensus::CheckBlock: %s", __func__, FormatStateMessage(state));
+    if (!ContextualCheckBlock(block, state, consensusParams, pindexPrev))
+        return error("%s: Consensus::ContextualCheckBlock: %s", __func__, FormatStateMessage(state));
+
+    CBlockIndex indexDummy(block);
+    indexDummy.pprev = pindexPrev;
+    indexDummy.nHeight = pindexPrev->nHeight + 1;
+
+    int nLockTimeFlags = 0;
+    if (VersionBitsState(pindexPrev, consensusParams, Consensus::DEPLOYMENT_CSV, versionbitscache) == THRESHOLD_ACTIVE) {
+        nLockTimeFlags |= LOCKTIME_VERIFY_SEQUENCE;
+    }
+    unsigned int flags = GetBlockScriptFlags(&indexDummy, consensusParams);
+
+    // Connect the checked transactions, then check the added ones like
+    // ConnectBlock does
+    CCoinsViewCache view(pcoinsTip.get());
+    CCheckQueueControl<CScriptCheck> control(nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    std::vector<PrecomputedTransactionData> txdata;
+    txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
+    std::vector<int> prevheights;
+    CAmount nFees = 0;
+    int64_t nSigOpsCost = 0;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+
+        if (i >= nTxChecked) {
+            for (size_t o = 0; o < tx.vout.size(); o++) {
+                if (view.HaveCoin(COutPoint(tx.GetHash(), o))) {
+                    return state.DoS(100, error("%s: tried to overwrite transaction", __func__),
+                                     REJECT_INVALID, "bad-txns-BIP30");
+                }
+            }
+
+            // The coinbase has no payout for a refund request that wasn't
+            // in the checked template
+            for (const CTxOut& o : tx.vout) {
+                uint256 id;
+                std::vector<unsigned char> vchSig;
+                if (o.scriptPubKey.IsWithdrawalRefundRequest(id, vchSig)) {
+                    return state.DoS(100, error("%s: Invalid Withdrawal refund!", __func__),
+                                REJECT_INVALID, "verify-withdrawal-refund-missing-payout");
+                }
+            }
+
+            CAmount txfee = 0;
+            if (!Consensus::CheckTxInputs(tx, state, view, indexDummy.nHeight, txfee)) {
+                return error("%s: Consensus::CheckTxInputs: %s, %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
+            }
+            nFees += txfee;
+            if (!MoneyRange(nFees)) {
+                return state.DoS(100, error("%s: accumulated fee in the block out of range.", __func__),
+                                 REJECT_INVALID, "bad-txns-accumulated-fee-outofrange");
+            }
+
+            prevheights.resize(tx.vin.size());
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
+            }
+            if (!SequenceLocks(tx, nLockTimeFlags, &prevheights, indexDummy)) {
+                return state.DoS(100, error("%s: contains a non-BIP68-final transaction", __func__),
+                                 REJECT_INVALID, "bad-txns-nonfinal");
+            }
+        }
+        else
+        if (!view.HaveInputs(tx)) {
+            return state.Invalid(error("%s: inputs of checked transaction %s missing", __func__, tx.GetHash().ToString()),
+                                 REJECT_INVALID, "bad-txns-inputs-missingorspent");
+        }
+
+        nSigOpsCost += GetTransactionSigOpCost(tx, view, flags);
+        if (nSigOpsCost > MAX_BLOCK_SIGOPS_COST)
+            return state.DoS(100, error("%s: too many sigops", __func__),
+                             REJECT_INVALID, "bad-blk-sigops");
+
+        if (i >= nTxChecked) {
+            txdata.emplace_back(tx);
+            std::vector<CScriptCheck> vChecks;
+            if (!CheckInputs(tx, state, view, true, flags, true, true, txdata.back(), nScriptCheckThreads ? &vChecks : nullptr))
+                return error("%s: CheckInputs on %s failed with %s", __func__,
+                    tx.GetHash().ToString(), FormatStateMessage(state));
+            control.Add(vChecks);
+        }
+
+        UpdateCoins(tx, view, indexDummy.nHeight);
+    }
+
+    // The checked coinbase paid no more than it could, the new one may only
+    // add the fees of the added transactions
+    CAmount nValueAdded = block.vtx[0]->GetValueOut() - blockTemplateChecked.vtx[0]->GetValueOut();
+    if (nValueAdded > nFees)
+        return state.DoS(100, error("%s: coinbase pays too much (added=%d vs fees=%d)", __func__, nValueAdded, nFees),
+                         REJECT_INVALID, "bad-cb-amount");
+
+    if (!control.Wait())
+        return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
+
+    blockTemplateChecked = block;
+
+    return true;
+}
+
+/**
+ * BLOCK PRUNING CODE
+ */
+
+/* Calculate the amount of disk space the block & undo files currently use */
+uint64_t CalculateCurrentUsage()
+{
+    LOCK(cs_LastBlockFile);
+
+    uint64_t retval = 0;
+    for (const CBlockFileInfo &file : vinfoBlockFile) {
+        retval += file.nSize + file.nUndoSize;
+    }
+    return retval;
+}
+
+/* Prune a block file (modify associated database entries)*/
+void PruneOneBlockFile(const int fileNumber)
+{
     LOCK(cs_LastBlockFile);
 
     for (const auto& entry : mapBlockIndex) {
@@ -4996,7 +5479,9 @@ void UnloadBlockIndex()
     }
     mapBlockIndex.clear();
     mapBlockMainHashIndex.clear();
+    std::atomic_store(&psetAssumeBMMValid, std::shared_ptr<const AssumedBlockSet>());
     fHavePruned = false;
+    blockTemplateChecked.SetNull();
 
     g_chainstate.UnloadBlockIndex();
 }
@@ -5009,6 +5494,13 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         bool ret = LoadBlockIndexDB(chainparams);
         if (!ret) return false;
         needs_init = mapBlockIndex.empty();
+
+        // Resolve -assumebmmvalid now if we already have the block's header,
+        // otherwise it is resolved when the header arrives
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeBMMValid);
+        if (it != mapBlockIndex.end())
+            ResolveAssumeBMMValid(it->second);
     }
 
     if (needs_init) {
@@ -5391,6 +5883,133 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
 
+/** Maximum number of saved transactions verified and accepted together by LoadMempool */
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 1000;
+
+/** Transactions in the journal before DumpMempoolIncremental always rewrites the dump */
+static const uint64_t MEMPOOL_JOURNAL_MIN_COMPACT = 1000;
+
+/** Serializes writes of the mempool dump and journal */
+static CCriticalSection cs_dumpMempool;
+/** Accept time of the transactions not written yet, 0 until the mempool was fully dumped */
+static int64_t nMempoolDumpTime = 0;
+/** Transactions in the last full dump, and appended to the journal since */
+static uint64_t nMempoolDumpCount = 0;
+static uint64_t nMempoolJournalCount = 0;
+/** Fee deltas as last written */
+static std::map<uint256, CAmount> mapMempoolDumpDeltas;
+
+static fs::path GetMempoolJournalPath()
+{
+    return GetDataDir() / "mempooljournal.dat";
+}
+
+/** A transaction read from the mempool dump or journal */
+struct MempoolDumpEntry
+{
+    CTransactionRef tx;
+    int64_t nTime;
+    int nDepth; // Longest chain of saved ancestors
+};
+
+/**
+ * Read one dump of mempool transactions, recording the fee deltas it holds
+ * for them and for other transactions in mapDeltas. A transaction read again
+ * replaces the earlier one, so a later dump overrides an earlier one.
+ */
+static bool ReadMempoolDump(CAutoFile& file, std::vector<MempoolDumpEntry>& vEntry, std::map<uint256, size_t>& mapEntry, std::map<uint256, CAmount>& mapDeltas)
+{
+    uint64_t version;
+    file >> version;
+    if (version != MEMPOOL_DUMP_VERSION) {
+        return false;
+    }
+    uint64_t num;
+    file >> num;
+    while (num--) {
+        MempoolDumpEntry entry;
+        int64_t nFeeDelta;
+        file >> entry.tx;
+        file >> entry.nTime;
+        file >> nFeeDelta;
+        entry.nDepth = 0;
+
+        const uint256& txid = entry.tx->GetHash();
+        std::map<uint256, size_t>::iterator it = mapEntry.find(txid);
+        if (it != mapEntry.end()) {
+            vEntry[it->second] = entry;
+        } else {
+            mapEntry[txid] = vEntry.size();
+            vEntry.push_back(entry);
+        }
+        mapDeltas[txid] = nFeeDelta;
+    }
+    std::map<uint256, CAmount> mapDumpDeltas;
+    file >> mapDumpDeltas;
+    for (const auto& i : mapDumpDeltas) {
+        mapDeltas[i.first] = i.second;
+    }
+    return true;
+}
+
+/**
+ * Verify the scripts of saved transactions on the script check threads, so
+ * that accepting them afterwards finds them in the script execution cache,
+ * and their signatures in the signature cache. Transactions with missing
+ * inputs or invalid scripts are left for AcceptToMemoryPool to reject.
+ */
+static void PrevalidateMempoolScripts(std::vector<MempoolDumpEntry>::const_iterator itBegin, std::vector<MempoolDumpEntry>::const_iterator itEnd)
+{
+    if (!nScriptCheckThreads) {
+        return;
+    }
+
+    // The flags AcceptToMemoryPool checks the scripts with
+    unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    if (!Params().RequireStandard())
+        flags = gArgs.GetArg("-promiscuousmempoolflags", flags);
+
+    std::vector<const CTransaction*> vTx;
+    std::vector<PrecomputedTransactionData> vTxData;
+    vTxData.reserve(itEnd - itBegin);
+    std::vector<CScriptCheck> vChecks;
+    {
+        LOCK2(cs_main, mempool.cs);
+        CCoinsViewMemPool viewMemPool(pcoinsTip.get(), mempool);
+        CCoinsViewCache view(&viewMemPool);
+        std::vector<CTxOut> vSpent;
+        for (std::vector<MempoolDumpEntry>::const_iterator it = itBegin; it != itEnd; ++it) {
+            const CTransaction& tx = *it->tx;
+            vSpent.clear();
+            for (const CTxIn& txin : tx.vin) {
+                const Coin& coin = view.AccessCoin(txin.prevout);
+                if (coin.IsSpent())
+                    break;
+                vSpent.push_back(coin.out);
+            }
+            if (vSpent.size() != tx.vin.size())
+                continue;
+
+            vTx.push_back(&tx);
+            vTxData.emplace_back(tx);
+            for (unsigned int i = 0; i < tx.vin.size(); i++)
+                vChecks.emplace_back(vSpent[i], tx, i, flags, true /* cacheStore */, &vTxData.back());
+        }
+    }
+
+    // The check queue flushes the signatures each batch stored to the
+    // signature cache
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    if (!control.Wait())
+        return;
+
+    // Every script passed, which is what CheckInputs would cache
+    LOCK(cs_main);
+    for (const CTransaction* ptx : vTx)
+        scriptExecutionCache.insert(GetScriptExecutionCacheEntry(*ptx, flags));
+}
+
 bool LoadMempool(void)
 {
     const CChainParams& chainparams = Params();
@@ -5408,74 +6027,136 @@ bool LoadMempool(void)
     int64_t already_there = 0;
     int64_t nNow = GetTime();
 
+    std::vector<MempoolDumpEntry> vEntry;
+    std::map<uint256, size_t> mapEntry;
+    std::map<uint256, CAmount> mapDeltas;
     try {
-        uint64_t version;
-        file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (!ReadMempoolDump(file, vEntry, mapEntry, mapDeltas)) {
             return false;
         }
-        uint64_t num;
-        file >> num;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    // The journal holds the transactions added after the dump was written.
+    // Whatever was appended before an interrupted write is still usable.
+    CAutoFile journal(fsbridge::fopen(GetMempoolJournalPath(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (!journal.IsNull()) {
+        try {
+            while (!feof(journal.Get()) && ReadMempoolDump(journal, vEntry, mapEntry, mapDeltas)) {
+                // Check for the end of the journal before reading another dump
+                int c = fgetc(journal.Get());
+                if (c == EOF)
+                    break;
+                ungetc(c, journal.Get());
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, nTime,
-                                           nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (mempool.exists(tx->GetHash())) {
-                        ++already_there;
-                    } else {
-                        ++failed;
-                    }
+        } catch (const std::exception& e) {
+            LogPrintf("Failed to deserialize mempool journal on disk: %s. Continuing anyway.\n", e.what());
+        }
+    }
+
+    for (const auto& i : mapDeltas) {
+        if (i.second) {
+            mempool.PrioritiseTransaction(i.first, i.second);
+        }
+    }
+
+    // Accept the transactions in batches by depth, so that all parents of a
+    // batch are in the mempool when its scripts are verified
+    std::vector<MempoolDumpEntry> vAccept;
+    for (const MempoolDumpEntry& entry : vEntry) {
+        if (entry.nTime + nExpiryTimeout > nNow) {
+            vAccept.push_back(entry);
+        } else {
+            ++expired;
+        }
+    }
+    mapEntry.clear();
+    for (size_t i = 0; i < vAccept.size(); i++) {
+        mapEntry[vAccept[i].tx->GetHash()] = i;
+    }
+    bool fChanged = true;
+    for (size_t nPass = 0; fChanged && nPass < vAccept.size(); nPass++) {
+        fChanged = false;
+        for (MempoolDumpEntry& entry : vAccept) {
+            for (const CTxIn& txin : entry.tx->vin) {
+                std::map<uint256, size_t>::const_iterator it = mapEntry.find(txin.prevout.hash);
+                if (it != mapEntry.end() && vAccept[it->second].nDepth >= entry.nDepth) {
+                    entry.nDepth = vAccept[it->second].nDepth + 1;
+                    fChanged = true;
                 }
-            } else {
-                ++expired;
             }
-            if (ShutdownRequested())
-                return false;
         }
-        std::map<uint256, CAmount> mapDeltas;
-        file >> mapDeltas;
+    }
+    std::stable_sort(vAccept.begin(), vAccept.end(),
+            [](const MempoolDumpEntry& a, const MempoolDumpEntry& b) { return a.nDepth < b.nDepth; });
 
-        for (const auto& i : mapDeltas) {
-            mempool.PrioritiseTransaction(i.first, i.second);
+    std::vector<MempoolDumpEntry>::const_iterator itBatch = vAccept.begin();
+    while (itBatch != vAccept.end()) {
+        std::vector<MempoolDumpEntry>::const_iterator itEnd = itBatch;
+        while (itEnd != vAccept.end() && itEnd->nDepth == itBatch->nDepth && size_t(itEnd - itBatch) < MEMPOOL_LOAD_BATCH_SIZE)
+            ++itEnd;
+
+        PrevalidateMempoolScripts(itBatch, itEnd);
+
+        LOCK(cs_main);
+        for (; itBatch != itEnd; ++itBatch) {
+            CValidationState state;
+            AcceptToMemoryPoolWithTime(chainparams, mempool, state, itBatch->tx, nullptr /* pfMissingInputs */, itBatch->nTime,
+                                       nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */);
+            if (state.IsValid()) {
+                ++count;
+            } else {
+                // mempool may contain the transaction already, e.g. from
+                // wallet(s) having loaded it while we were processing
+                // mempool transactions; consider these as valid, instead of
+                // failed, but mark them as 'already there'
+                if (mempool.exists(itBatch->tx->GetHash())) {
+                    ++already_there;
+                } else {
+                    ++failed;
+                }
+            }
         }
-    } catch (const std::exception& e) {
-        LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
-        return false;
+        if (ShutdownRequested())
+            return false;
     }
 
     LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there\n", count, failed, expired, already_there);
     return true;
 }
 
+/** Write a dump of mempool transactions, with the fee deltas of the others */
+static void WriteMempoolDump(CAutoFile& file, const std::vector<TxMempoolInfo>& vinfo, std::map<uint256, CAmount> mapDeltas)
+{
+    uint64_t version = MEMPOOL_DUMP_VERSION;
+    file << version;
+
+    file << (uint64_t)vinfo.size();
+    for (const auto& i : vinfo) {
+        file << *(i.tx);
+        file << (int64_t)i.nTime;
+        file << (int64_t)i.nFeeDelta;
+        mapDeltas.erase(i.tx->GetHash());
+    }
+
+    file << mapDeltas;
+}
+
 bool DumpMempool(void)
 {
+    LOCK(cs_dumpMempool);
+
     int64_t start = GetTimeMicros();
 
     std::map<uint256, CAmount> mapDeltas;
     std::vector<TxMempoolInfo> vinfo;
+    int64_t nDumpTime;
 
     {
-        LOCK(mempool.cs);
+        LOCK2(cs_main, mempool.cs);
+        nDumpTime = GetTime();
         for (const auto &i : mempool.mapDeltas) {
             mapDeltas[i.first] = i.second;
         }
@@ -5491,21 +6172,12 @@ bool DumpMempool(void)
         }
 
         CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
-
-        uint64_t version = MEMPOOL_DUMP_VERSION;
-        file << version;
-
-        file << (uint64_t)vinfo.size();
-        for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << (int64_t)i.nTime;
-            file << (int64_t)i.nFeeDelta;
-            mapDeltas.erase(i.tx->GetHash());
-        }
-
-        file << mapDeltas;
+        WriteMempoolDump(file, vinfo, mapDeltas);
         FileCommit(file.Get());
         file.fclose();
+        // The journal must not be applied to the new dump, remove it first.
+        // A crash in between loses the journal instead of replaying it.
+        fs::remove(GetMempoolJournalPath());
         RenameOver(GetDataDir() / "mempool.dat.new", GetDataDir() / "mempool.dat");
         int64_t last = GetTimeMicros();
         LogPrintf("Dumped mempool: %gs to copy, %gs to dump\n", (mid-start)*MICRO, (last-mid)*MICRO);
@@ -5513,12 +6185,92 @@ bool DumpMempool(void)
         LogPrintf("Failed to dump mempool: %s. Continuing anyway.\n", e.what());
         return false;
     }
+
+    nMempoolDumpTime = nDumpTime;
+    nMempoolDumpCount = vinfo.size();
+    nMempoolJournalCount = 0;
+    mapMempoolDumpDeltas = mapDeltas;
+    return true;
+}
+
+bool DumpMempoolIncremental()
+{
+    LOCK(cs_dumpMempool);
+
+    // Start with a full dump, and rewrite it once the journal outgrows it
+    if (!nMempoolDumpTime || nMempoolJournalCount > std::max(nMempoolDumpCount, MEMPOOL_JOURNAL_MIN_COMPACT)) {
+        return DumpMempool();
+    }
+
+    std::map<uint256, CAmount> mapDeltas;
+    std::vector<TxMempoolInfo> vinfo;
+    int64_t nDumpTime;
+
+    {
+        // Transactions are accepted under cs_main, so none accepted before
+        // nDumpTime can be added after the snapshot
+        LOCK2(cs_main, mempool.cs);
+        nDumpTime = GetTime();
+        for (const auto &i : mempool.mapDeltas) {
+            mapDeltas[i.first] = i.second;
+        }
+        for (const TxMempoolInfo& info : mempool.infoAll()) {
+            if (info.nTime >= nMempoolDumpTime)
+                vinfo.push_back(info);
+        }
+    }
+
+    // Removed transactions are rejected when the dump is loaded, they don't
+    // need to be recorded
+    if (vinfo.empty() && mapDeltas == mapMempoolDumpDeltas) {
+        return true;
+    }
+
+    // Record cleared fee deltas as zero, or loading would keep the ones
+    // written before
+    std::map<uint256, CAmount> mapJournalDeltas = mapDeltas;
+    for (const auto& i : mapMempoolDumpDeltas) {
+        if (!mapDeltas.count(i.first))
+            mapJournalDeltas[i.first] = 0;
+    }
+
+    try {
+        FILE* filestr = fsbridge::fopen(GetMempoolJournalPath(), "ab");
+        if (!filestr) {
+            return false;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        WriteMempoolDump(file, vinfo, mapJournalDeltas);
+        FileCommit(file.Get());
+        file.fclose();
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to append to mempool journal: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    LogPrint(BCLog::MEMPOOL, "Appended %u transactions to the mempool journal\n", vinfo.size());
+
+    nMempoolDumpTime = nDumpTime;
+    nMempoolJournalCount += vinfo.size();
+    mapMempoolDumpDeltas = mapDeltas;
     return true;
 }
 
 void LoadBMMCache()
 {
     fs::path path = GetDataDir() / "bmm.dat";
+
+    std::unique_ptr<HashSnapshot> snapshot(new HashSnapshot());
+    if (snapshot->Open(path)) {
+        // Counting the hashes would check every block, which is left until
+        // they are first looked up
+        LogPrintf("%s: Loaded BMM cache snapshot with %u blocks.\n", __func__, snapshot->GetBlockCount());
+        bmmCache.SetSnapshot(std::move(snapshot));
+        return;
+    }
+
+    // Read the old stream format, DumpBMMCache will replace it with a snapshot
     CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull()) {
         return;
@@ -5575,57 +6327,47 @@ void LoadBMMCache()
 
 void DumpBMMCache()
 {
-    std::vector<uint256> vHashWithdrawal = bmmCache.GetBroadcastedWithdrawalBundleCache();
-    std::vector<uint256> vHashBMM = bmmCache.GetVerifiedBMMCache();
-    std::vector<uint256> vDepositTXID = bmmCache.GetVerifiedDepositCache();
-
-    int nWithdrawal = vHashWithdrawal.size();
-    int nBMM = vHashBMM.size();
-    int nDeposit = vDepositTXID.size();
-
-    fs::path path = GetDataDir() / "bmm.dat.new";
-    CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull()) {
-        return;
-    }
+    std::vector<HashSnapshotBlock> vBlock;
+    vBlock.emplace_back(HASH_SNAPSHOT_WITHDRAWAL_BUNDLE, HASH_SNAPSHOT_SORTED, bmmCache.GetBroadcastedWithdrawalBundleCache());
+    vBlock.emplace_back(HASH_SNAPSHOT_BMM, HASH_SNAPSHOT_SORTED, bmmCache.GetVerifiedBMMCache());
+    vBlock.emplace_back(HASH_SNAPSHOT_DEPOSIT, HASH_SNAPSHOT_SORTED, bmmCache.GetVerifiedDepositCache());
 
-    try {
-        fileout << 160000; // version required to read: 0.16.00 or later
-        fileout << CLIENT_VERSION; // version that wrote the file
-
-        // Broadcasted Withdrawal Bundle hash cache
-        fileout << nWithdrawal; // Number of Withdrawal Bundle hashes in file
-        for (const uint256& u : vHashWithdrawal) {
-            fileout << u;
+    // Append the new hashes to the snapshot we loaded if we can, otherwise
+    // write all of them to a new file
+    const HashSnapshot* snapshot = bmmCache.GetSnapshot();
+    const bool fAppend = snapshot && snapshot->CanAppend();
+    if (snapshot && !fAppend) {
+        for (HashSnapshotBlock& block : vBlock) {
+            std::vector<uint256> vHash = snapshot->Get(block.nType);
+            block.vHash.insert(block.vHash.end(), vHash.begin(), vHash.end());
         }
-        // Verified BMM hash cache
-        fileout << nBMM; // Number of Withdrawal Bundle hashes in file
-        for (const uint256& u : vHashBMM) {
-            fileout << u;
-        }
-
-        // Verified deposit txid cache
-        fileout << nDeposit; // Number of Withdrawal Bundle hashes in file
-        for (const uint256& u : vDepositTXID) {
-            fileout << u;
-        }
-
     }
-    catch (const std::exception& e) {
-        LogPrintf("%s: Error writing BMM cache: %s", __func__, e.what());
+
+    fs::path path = GetDataDir() / "bmm.dat";
+    bool fWritten = fAppend ? AppendHashSnapshot(path, std::move(vBlock)) : WriteHashSnapshot(path, std::move(vBlock));
+    if (!fWritten) {
+        LogPrintf("%s: Error writing BMM cache\n", __func__);
         return;
     }
 
-    FileCommit(fileout.Get());
-    fileout.fclose();
-    RenameOver(GetDataDir() / "bmm.dat.new", GetDataDir() / "bmm.dat");
-
     LogPrintf("%s: Wrote BMM cache.\n", __func__);
 }
 
 void LoadMainBlockCache()
 {
     fs::path path = GetDataDir() / "mainblockhash.dat";
+
+    HashSnapshot snapshot;
+    if (snapshot.Open(path)) {
+        bmmCache.CacheMainBlockHash(snapshot.Get(HASH_SNAPSHOT_MAIN_BLOCK));
+
+        // New hashes can be appended on shutdown unless the file is damaged
+        if (snapshot.CanAppend())
+            bmmCache.SetMainBlockHashesDumped();
+        return;
+    }
+
+    // Read the old stream format, DumpMainBlockCache will replace it
     CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull()) {
         return;
@@ -5653,41 +6395,31 @@ void LoadMainBlockCache()
         return;
     }
 
-    for (const uint256& u : vHash)
-        bmmCache.CacheMainBlockHash(u);
+    bmmCache.CacheMainBlockHash(vHash);
 }
 
 void DumpMainBlockCache()
 {
-    std::vector<uint256> vHash = bmmCache.GetMainBlockHashCache();
+    // Only new hashes are appended unless a reorg removed hashes that we have
+    // already written
+    bool fRewrite = false;
+    std::vector<uint256> vHash = bmmCache.GetMainBlockHashesToDump(fRewrite);
     if (vHash.empty())
         return;
 
-    int count = vHash.size();
+    size_t count = vHash.size();
 
-    fs::path path = GetDataDir() / "mainblockhash.dat.new";
-    CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull()) {
-        return;
-    }
+    std::vector<HashSnapshotBlock> vBlock;
+    vBlock.emplace_back(HASH_SNAPSHOT_MAIN_BLOCK, 0, std::move(vHash));
 
-    try {
-        fileout << 160000; // version required to read: 0.16.00 or later
-        fileout << CLIENT_VERSION; // version that wrote the file
-        fileout << count; // Number of Withdrawal Bundle hashes in file
-
-        for (const uint256& u : vHash) {
-            fileout << u;
-        }
-    }
-    catch (const std::exception& e) {
-        LogPrintf("%s: Error writing main block cache: %s", __func__, e.what());
+    fs::path path = GetDataDir() / "mainblockhash.dat";
+    bool fWritten = fRewrite ? WriteHashSnapshot(path, std::move(vBlock)) : AppendHashSnapshot(path, std::move(vBlock));
+    if (!fWritten) {
+        LogPrintf("%s: Error writing main block cache\n", __func__);
         return;
     }
 
-    FileCommit(fileout.Get());
-    fileout.fclose();
-    RenameOver(GetDataDir() / "mainblockhash.dat.new", GetDataDir() / "mainblockhash.dat");
+    bmmCache.SetMainBlockHashesDumped();
 
     LogPrintf("%s: Wrote %u\n", __func__, count);
 }
@@ -5761,6 +6493,92 @@ void LoadWithdrawalIDCache()
         bmmCache.CacheWithdrawalID(u);
 }
 
+void DumpDepositQueue()
+{
+    std::vector<SidechainDeposit> vDeposit;
+    uint256 hashCursor;
+    uint32_t nCursorBurnIndex = 0;
+    {
+        std::lock_guard<std::mutex> lock(depositQueueMutex);
+        vDeposit = bmmCache.GetDepositQueue();
+        bmmCache.GetDepositCursor(hashCursor, nCursorBurnIndex);
+    }
+
+    fs::path path = GetDataDir() / "depositqueue.dat.new";
+    CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) {
+        return;
+    }
+
+    try {
+        fileout << 160000; // version required to read: 0.16.00 or later
+        fileout << CLIENT_VERSION; // version that wrote the file
+        fileout << hashCursor; // Mainchain txid of the last downloaded deposit
+        fileout << nCursorBurnIndex; // Burn output index of the last downloaded deposit
+        fileout << vDeposit; // Deposits waiting to be connected
+    }
+    catch (const std::exception& e) {
+        LogPrintf("%s: Error writing deposit queue: %s", __func__, e.what());
+        return;
+    }
+
+    FileCommit(fileout.Get());
+    fileout.fclose();
+    RenameOver(GetDataDir() / "depositqueue.dat.new", GetDataDir() / "depositqueue.dat");
+
+    LogPrintf("%s: Wrote %u\n", __func__, vDeposit.size());
+}
+
+void LoadDepositQueue()
+{
+    fs::path path = GetDataDir() / "depositqueue.dat";
+    CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        return;
+    }
+
+    std::vector<SidechainDeposit> vDeposit;
+    uint256 hashCursor;
+    uint32_t nCursorBurnIndex = 0;
+    try {
+        int nVersionRequired, nVersionThatWrote;
+        filein >> nVersionRequired;
+        filein >> nVersionThatWrote;
+        if (nVersionRequired > CLIENT_VERSION) {
+            return;
+        }
+
+        filein >> hashCursor;
+        filein >> nCursorBurnIndex;
+        filein >> vDeposit;
+    }
+    catch (const std::exception& e) {
+        LogPrintf("%s: Error reading deposit queue: %s", __func__, e.what());
+        return;
+    }
+
+    // The queue is checked against the sidechain db on the next update
+    std::lock_guard<std::mutex> lock(depositQueueMutex);
+    bmmCache.SetDepositQueue(vDeposit, hashCursor, nCursorBurnIndex);
+    fDepositQueueSynced = false;
+    nDepositQueueGeneration++;
+}
+
+void LoadMainchainFeeHistory()
+{
+    std::vector<SidechainWithdrawalBundle> vWithdrawalBundle = psidechaintree->GetWithdrawalBundles(THIS_SIDECHAIN);
+
+    // Oldest first, the estimator keeps the most recent outcomes
+    std::sort(vWithdrawalBundle.begin(), vWithdrawalBundle.end(),
+            [](const SidechainWithdrawalBundle& a, const SidechainWithdrawalBundle& b) {
+                return a.nHeight < b.nHeight;
+            });
+
+    mainchainFeeEstimator.Clear();
+    for (const SidechainWithdrawalBundle& withdrawalBundle : vWithdrawalBundle)
+        mainchainFeeEstimator.AddBundleOutcome(withdrawalBundle);
+}
+
 /** Create joined Withdrawal Bundle to be sent to the mainchain */
 bool CreateWithdrawalBundleTx(int nHeight, CTransactionRef& withdrawalBundleTx, CTransactionRef& withdrawalBundleDataTx, bool fReplicationCheck, bool fCheckUnique)
 {
@@ -5834,30 +6652,32 @@ bool CreateWithdrawalBundleTx(int nHeight, CTransactionRef& withdrawalBundleTx,
     wjtx.nVersion = 2;
     wjtx.vin.resize(1); // Dummy vin for serialization...
     wjtx.vin[0].scriptSig = CScript() << OP_0;
+
+    // The Withdrawal Bundle has no witness data so its weight is just its
+    // size scaled. Keep track of the size as outputs are added instead of
+    // serializing the whole transaction again for every output.
+    size_t nSize = ::GetSerializeSize(wjtx, SER_NETWORK, PROTOCOL_VERSION);
     for (const SidechainWithdrawal& withdrawal : vWithdrawal) {
         CAmount amountWithdrawal = withdrawal.amount - withdrawal.mainchainFee;
 
-        amountMainchainFees += withdrawal.mainchainFee;
-
         // TODO check IsValidDestination
         // Output to mainchain keyID
         CTxDestination dest = DecodeDestination(withdrawal.strDestination, true /* fMainchain */);
-        wjtx.vout.push_back(CTxOut(amountWithdrawal, GetScriptForDestination(dest)));
+        CTxOut out(amountWithdrawal, GetScriptForDestination(dest));
 
-        // Add Withdrawal objid to Withdrawal Bundle obj
-        withdrawalBundle.vWithdrawalID.push_back(withdrawal.GetID());
+        // Make sure we have room for more outputs, stop if we would go over
+        size_t nSizeNew = nSize + ::GetSerializeSize(out, SER_NETWORK, PROTOCOL_VERSION)
+            + GetSizeOfCompactSize(wjtx.vout.size() + 1) - GetSizeOfCompactSize(wjtx.vout.size());
+        if (nSizeNew * WITNESS_SCALE_FACTOR > MAX_WITHDRAWAL_BUNDLE_WEIGHT)
+            break;
 
-        // Make sure we have room for more outputs
-        if (GetTransactionWeight(wjtx) > MAX_WITHDRAWAL_BUNDLE_WEIGHT) {
-            // If we went over size, undo this output and stop
-            withdrawalBundle.vWithdrawalID.pop_back();
-            wjtx.vout.pop_back();
+        nSize = nSizeNew;
+        wjtx.vout.push_back(out);
 
-            // Also remove added fees
-            amountMainchainFees -= withdrawal.mainchainFee;
+        amountMainchainFees += withdrawal.mainchainFee;
 
-            break;
-        }
+        // Add Withdrawal objid to Withdrawal Bundle obj
+        withdrawalBundle.vWithdrawalID.push_back(withdrawal.GetID());
     }
 
     // Update mainchain fee encoding output.
@@ -5869,13 +6689,15 @@ bool CreateWithdrawalBundleTx(int nHeight, CTransactionRef& withdrawalBundleTx,
         return false;
     }
 
+    CTransactionRef tx = MakeTransactionRef(std::move(wjtx));
+
     // If the Withdrawal Bundle hash will be the same as a previous Withdrawal Bundle return false. It is
     // possible for a new Withdrawal Bundle to have the same hash as a previous Withdrawal Bundle if all of
     // the outputs (destinations & amounts) are exactly the same. In that case,
     // wait for a new Withdrawal to be added to the database so that this Withdrawal Bundle will have
     // a unique hash. It would also be possible to remove one of the outputs to
     // obtain a unique Withdrawal Bundle hash (TODO?)
-    if (fCheckUnique && psidechaintree->HaveWithdrawalBundle(wjtx.GetHash())) {
+    if (fCheckUnique && psidechaintree->HaveWithdrawalBundle(tx->GetHash())) {
         LogPrintf("%s: ERROR: Withdrawal Bundle is not unique!\n", __func__);
         return false;
     }
@@ -5883,16 +6705,16 @@ bool CreateWithdrawalBundleTx(int nHeight, CTransactionRef& withdrawalBundleTx,
     // Check that the Withdrawal Bundle is valid by mainchain policy
     CFeeRate dust = CFeeRate(DUST_RELAY_TX_FEE);
     std::string strReason = "";
-    if (!CoreIsStandardTx(wjtx, true, dust, strReason)) {
+    if (!CoreIsStandardTx(*tx, true, dust, strReason)) {
         LogPrintf("%s: ERROR: Withdrawal Bundle failed core standardness tests! Reason: %s\n", __func__, strReason);
         return false;
     }
 
     // Add Withdrawal Bundle transaction to the Withdrawal Bundle database object
-    withdrawalBundle.tx = wjtx;
+    withdrawalBundle.tx = tx;
 
     // Return the Withdrawal Bundle transaction itself by reference
-    withdrawalBundleTx = MakeTransactionRef(wjtx);
+    withdrawalBundleTx = tx;
 
     // Output data
     CMutableTransaction mtx;
@@ -5901,7 +6723,7 @@ bool CreateWithdrawalBundleTx(int nHeight, CTransactionRef& withdrawalBundleTx,
     // Return the Withdrawal Bundle data transaction by reference
     withdrawalBundleDataTx = MakeTransactionRef(mtx);
 
-    LogPrintf("%s: Withdrawal Bundle created! Hash: %s\n", __func__, wjtx.GetHash().ToString());
+    LogPrintf("%s: Withdrawal Bundle created! Hash: %s\n", __func__, tx->GetHash().ToString());
     return true;
 }
 
@@ -5956,7 +6778,7 @@ bool VerifyWithdrawalBundles(std::string& strFail, int nHeight, const std::vecto
             }
 
             // Check that there are actually enough outputs for this to be valid
-            if (withdrawalBundle->tx.vout.size() < 3) {
+            if (withdrawalBundle->tx->vout.size() < 3) {
                 strFail = "Invalid Withdrawal Bundle - too few outputs!\n";
                 return false;
             }
@@ -5964,7 +6786,7 @@ bool VerifyWithdrawalBundles(std::string& strFail, int nHeight, const std::vecto
             // Check that the number of outputs equals the number of
             // Withdrawal(s) listed in the Withdrawal Bundle + one encoded mainchain fee output + one
             // encoded change return dest output
-            if (withdrawalBundle->tx.vout.size() != vWithdrawal.size() + 2) {
+            if (withdrawalBundle->tx->vout.size() != vWithdrawal.size() + 2) {
                 strFail = "Invalid Withdrawal Bundle - missing / extra outputs!\n";
                 return false;
             }
@@ -5972,7 +6794,7 @@ bool VerifyWithdrawalBundles(std::string& strFail, int nHeight, const std::vecto
             // Check that the amount in the encoded mainchain fee output is
             // equal to the sum of fees from the withdrawals
             CAmount amountRead = 0;
-            if (!DecodeWithdrawalFees(withdrawalBundle->tx.vout[1].scriptPubKey, amountRead)) {
+            if (!DecodeWithdrawalFees(withdrawalBundle->tx->vout[1].scriptPubKey, amountRead)) {
                 strFail = "Invalid Withdrawal Bundle - failed to decode mainchain fee output!\n";
                 return false;
             }
@@ -5985,7 +6807,7 @@ bool VerifyWithdrawalBundles(std::string& strFail, int nHeight, const std::vecto
             // Check that every Withdrawal listed in the Withdrawal Bundle is included
             for (const SidechainWithdrawal& w : vWithdrawal) {
                 bool fFound = false;
-                for (const CTxOut& out : withdrawalBundle->tx.vout) {
+                for (const CTxOut& out : withdrawalBundle->tx->vout) {
                     if (out.nValue == w.amount - w.mainchainFee &&
                             GetScriptForDestination(DecodeDestination(w.strDestination, true)) == out.scriptPubKey) {
                         fFound = true;
@@ -6001,13 +6823,13 @@ bool VerifyWithdrawalBundles(std::string& strFail, int nHeight, const std::vecto
             // Check if standard by mainchain bitcoin core standards
             CFeeRate dust = CFeeRate(DUST_RELAY_TX_FEE);
             std::string strReason = "";
-            if (!CoreIsStandardTx(withdrawalBundle->tx, true, dust, strReason)) {
+            if (!CoreIsStandardTx(*withdrawalBundle->tx, true, dust, strReason)) {
                 strFail = "Invalid Withdrawal Bundle - failed CoreIsStandardTx!\n";
                 return false;
             }
 
             // Check Withdrawal Bundle weight
-            if (GetTransactionWeight(withdrawalBundle->tx) > MAX_WITHDRAWAL_BUNDLE_WEIGHT) {
+            if (GetTransactionWeight(*withdrawalBundle->tx) > MAX_WITHDRAWAL_BUNDLE_WEIGHT) {
                 strFail = "Invalid Withdrawal Bundle - too large!\n";
                 return false;
             }
@@ -6022,13 +6844,13 @@ bool VerifyWithdrawalBundles(std::string& strFail, int nHeight, const std::vecto
                     return false;
                 }
                 // Verify that our Withdrawal Bundle matches the one in this block
-                if (*withdrawalBundleTx != CTransaction(withdrawalBundle->tx)) {
+                if (*withdrawalBundleTx != *withdrawalBundle->tx) {
                     strFail = "Invalid Withdrawal Bundle - replicated Withdrawal Bundle does not match!\n";
                     return false;
                 }
             }
 
-            hashWithdrawalBundle = withdrawalBundle->tx.GetHash();
+            hashWithdrawalBundle = withdrawalBundle->tx->GetHash();
             hashWithdrawalBundleID = withdrawalBundle->GetID();
 
             // Update the status of withdrawals included in the Withdrawal Bundle - returned by
@@ -6059,18 +6881,18 @@ bool SortDeposits(const std::vector<SidechainDeposit>& vDeposit, std::vector<Sid
     // to check that there is only one missing CTIP input here.
     int nMissingCTIP = 0;
     for (size_t x = 0; x < vDeposit.size(); x++) {
-        const SidechainDeposit dx = vDeposit[x];
+        const SidechainDeposit& dx = vDeposit[x];
 
         // Look for the input of this deposit
         bool fFound = false;
         for (size_t y = 0; y < vDeposit.size(); y++) {
-            const SidechainDeposit dy = vDeposit[y];
+            const SidechainDeposit& dy = vDeposit[y];
 
             // The CTIP output of the deposit that might be the input
-            const COutPoint prevout(dy.dtx.GetHash(), dy.nBurnIndex);
+            const COutPoint prevout(dy.dtx->GetHash(), dy.nBurnIndex);
 
             // Look for the CTIP output
-            for (const CTxIn& in : dx.dtx.vin) {
+            for (const CTxIn& in : dx.dtx->vin) {
                 if (in.prevout == prevout) {
                     fFound = true;
                     break;
@@ -6105,7 +6927,7 @@ bool SortDeposits(const std::vector<SidechainDeposit>& vDeposit, std::vector<Sid
     }
 
     // Track the CTIP output of the latest deposit we have sorted
-    COutPoint prevout(vDepositSorted.back().dtx.GetHash(), vDepositSorted.back().nBurnIndex);
+    COutPoint prevout(vDepositSorted.back().dtx->GetHash(), vDepositSorted.back().nBurnIndex);
 
     // Look for the deposit that spends the last sorted CTIP output and sort it.
     // If we cannot find a deposit spending the CTIP, that should mean we
@@ -6113,14 +6935,14 @@ bool SortDeposits(const std::vector<SidechainDeposit>& vDeposit, std::vector<Sid
     std::vector<SidechainDeposit>::const_iterator it = vDeposit.begin();
     while (it != vDeposit.end()) {
         bool fFound = false;
-        for (const CTxIn& in : it->dtx.vin) {
+        for (const CTxIn& in : it->dtx->vin) {
             if (in.prevout == prevout) {
                 // Add the sorted deposit to the list
                 vDepositSorted.push_back(*it);
 
                 // Update the CTIP output we are looking for
-                const SidechainDeposit deposit = vDepositSorted.back();
-                prevout = COutPoint(deposit.dtx.GetHash(), deposit.nBurnIndex);
+                const SidechainDeposit& deposit = vDepositSorted.back();
+                prevout = COutPoint(deposit.dtx->GetHash(), deposit.nBurnIndex);
 
                 // Start from begin() again
                 fFound = true;
@@ -6154,9 +6976,9 @@ bool SortDeposits(const std::vector<SidechainDeposit>& vDeposit, std::vector<Sid
 
         // Check if the r-next item is the CTIP for the previous deposit
         bool fFound = false;
-        for (const CTxIn& in : prev.dtx.vin) {
-            if (in.prevout.hash == rit->dtx.GetHash()
-                && rit->dtx.vout.size() > in.prevout.n
+        for (const CTxIn& in : prev.dtx->vin) {
+            if (in.prevout.hash == rit->dtx->GetHash()
+                && rit->dtx->vout.size() > in.prevout.n
                 && rit->nBurnIndex == in.prevout.n) {
                 fFound = true;
                 break;
@@ -6175,14 +6997,27 @@ bool SortDeposits(const std::vector<SidechainDeposit>& vDeposit, std::vector<Sid
 
 bool CheckMainchainConnection()
 {
+    // Time of the last successful connection check
+    static std::atomic<int64_t> nLastConnection{0};
+
+    // A check from the future, after the clock went back, has expired
+    const int64_t nTTL = gArgs.GetArg("-mainchainconnectionttl", DEFAULT_MAINCHAIN_CONNECTION_TTL);
+    const int64_t nNow = GetTime();
+    const int64_t nLast = nLastConnection;
+    if (nTTL > 0 && nNow >= nLast && nNow - nLast < nTTL)
+        return true;
+
     SidechainClient client;
 
     int nMainchainBlocks = 0;
     if (!client.GetBlockCount(nMainchainBlocks)) {
         LogPrintf("%s: Mainchain connection not detected!\n", __func__);
+        nLastConnection = 0;
         return false;
     }
 
+    nLastConnection = GetTime();
+
     return true;
 }
 
@@ -6218,7 +7053,7 @@ bool UpdateMainBlockHashCache(bool& fReorg, std::vector<uint256>& vDisconnected)
     // we will cache it.
     //
 
-    SidechainClient client;
+    SidechainClient client(false /* fUseCache */);
 
     // Get the current mainchain block height
     int nMainBlocks = 0;
@@ -6269,12 +7104,19 @@ bool UpdateMainBlockHashCache(bool& fReorg, std::vector<uint256>& vDisconnected)
     // Also add the new mainchain tip
     deqHashNew.push_back(hashMainTip);
 
-    return bmmCache.UpdateMainBlockCache(deqHashNew, fReorg, vDisconnected);
+    if (!bmmCache.UpdateMainBlockCache(deqHashNew, fReorg, vDisconnected))
+        return false;
+
+    // Cached replies about the disconnected blocks may no longer hold
+    if (fReorg)
+        EraseMainchainBlockReplies(vDisconnected);
+
+    return true;
 }
 
 bool VerifyMainBlockCache(std::string& strError)
 {
-    SidechainClient client;
+    SidechainClient client(false /* fUseCache */);
 
     const std::vector<uint256> vHash = bmmCache.GetMainBlockHashCache();
     if (!vHash.size()) {
@@ -6351,6 +7193,15 @@ void HandleMainchainReorg(const std::vector<uint256>& vOrphan)
             vOrphanFinal.push_back(u);
     }
 
+    // Queued deposits may have been included in the orphaned mainchain
+    // blocks. Start over and download them again from the new mainchain tip.
+    if (!vOrphanFinal.empty()) {
+        std::lock_guard<std::mutex> lock(depositQueueMutex);
+        bmmCache.ClearDepositQueue();
+        fDepositQueueSynced = false;
+        nDepositQueueGeneration++;
+    }
+
     // Check if any BMM blocks were created from commitments in this
     // orphaned mainchain block
     for (const uint256& u : vOrphanFinal) {
@@ -6386,6 +7237,275 @@ void HandleMainchainReorg(const std::vector<uint256>& vOrphan)
     }
 }
 
+// Check if the deposit spends the CTIP output created by ctip
+static bool DepositSpendsCTIP(const SidechainDeposit& deposit, const SidechainDeposit& ctip)
+{
+    const COutPoint prevout(ctip.dtx->GetHash(), ctip.nBurnIndex);
+    for (const CTxIn& in : deposit.dtx->vin) {
+        if (in.prevout == prevout)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Replace the deposit queue with the result of an update, unless the queue
+ * was replaced while the update talked to the mainchain.
+ */
+static bool SetUpdatedDepositQueue(uint64_t nGeneration, const std::vector<SidechainDeposit>& vQueue, const uint256& hashCursor, uint32_t nCursorBurnIndex)
+{
+    std::lock_guard<std::mutex> lock(depositQueueMutex);
+    if (nGeneration != nDepositQueueGeneration) {
+        LogPrintf("%s: Deposit queue changed during the update, discarding it\n", __func__);
+        return false;
+    }
+
+    bmmCache.SetDepositQueue(vQueue, hashCursor, nCursorBurnIndex);
+    fDepositQueueSynced = true;
+    nDepositQueueGeneration++;
+
+    return true;
+}
+
+bool UpdateDepositQueue()
+{
+    // Copy the queue, then talk to the mainchain without holding the lock so
+    // that block creation can read the queue in the meantime
+    std::vector<SidechainDeposit> vQueueOld;
+    uint256 hashCursorOld;
+    uint32_t nCursorBurnIndexOld = 0;
+    uint64_t nGeneration;
+    {
+        std::lock_guard<std::mutex> lock(depositQueueMutex);
+        vQueueOld = bmmCache.GetDepositQueue();
+        bmmCache.GetDepositCursor(hashCursorOld, nCursorBurnIndexOld);
+        nGeneration = nDepositQueueGeneration;
+    }
+
+    SidechainDeposit lastDeposit;
+    bool fHaveDeposits = psidechaintree->GetLastDeposit(lastDeposit);
+
+    // Remove deposits that have been connected since the last update
+    std::vector<SidechainDeposit> vQueue;
+    std::set<uint256> setQueued;
+    for (const SidechainDeposit& d : vQueueOld) {
+        uint256 id = d.GetID();
+        if (psidechaintree->HaveDepositNonAmount(id))
+            continue;
+        vQueue.push_back(d);
+        setQueued.insert(id);
+    }
+
+    // The queue must continue from the last connected deposit. If it doesn't
+    // (sidechain reorg or the queue is empty) start over from the last
+    // connected deposit.
+    uint256 hashCursor;
+    uint32_t nCursorBurnIndex = 0;
+    if (vQueue.empty() || (fHaveDeposits && !DepositSpendsCTIP(vQueue.front(), lastDeposit))) {
+        vQueue.clear();
+        setQueued.clear();
+        if (fHaveDeposits) {
+            hashCursor = lastDeposit.dtx->GetHash();
+            nCursorBurnIndex = lastDeposit.nBurnIndex;
+        }
+    } else {
+        hashCursor = hashCursorOld;
+        nCursorBurnIndex = nCursorBurnIndexOld;
+    }
+
+    // Request deposits after the cursor from the mainchain
+    SidechainClient client;
+    std::vector<SidechainDeposit> vIncoming = client.UpdateDeposits(hashCursor, nCursorBurnIndex);
+
+    std::vector<SidechainDeposit> vNew;
+    for (const SidechainDeposit& d : vIncoming) {
+        uint256 id = d.GetID();
+        if (setQueued.count(id) || psidechaintree->HaveDepositNonAmount(id))
+            continue;
+
+        if (!VerifyDeposit(d.hashMainchainBlock, d.dtx->GetHash(), d.nTx)) {
+            LogPrintf("%s: Failed to verify deposit: %s (mainchain txid)\n", __func__, d.dtx->GetHash().ToString());
+            break;
+        }
+
+        vNew.push_back(d);
+        setQueued.insert(id);
+    }
+
+    if (vNew.empty())
+        return SetUpdatedDepositQueue(nGeneration, vQueue, hashCursor, nCursorBurnIndex);
+
+    vQueue.insert(vQueue.end(), vNew.begin(), vNew.end());
+
+    std::vector<SidechainDeposit> vSorted;
+    if (!SortDeposits(vQueue, vSorted) || vSorted.size() != vQueue.size()) {
+        LogPrintf("%s: Error: Failed to sort deposits!\n", __func__);
+        return false;
+    }
+
+    if (fHaveDeposits && !DepositSpendsCTIP(vSorted.front(), lastDeposit)) {
+        LogPrintf("%s: Error: First queued deposit does not spend the CTIP of the last connected deposit!\n", __func__);
+        return false;
+    }
+
+    const SidechainDeposit& back = vSorted.back();
+    if (!SetUpdatedDepositQueue(nGeneration, vSorted, back.dtx->GetHash(), back.nBurnIndex))
+        return false;
+
+    LogPrintf("%s: Queued %u new deposits. Deposits waiting: %u\n", __func__, vNew.size(), vSorted.size());
+
+    return true;
+}
+
+bool GetQueuedDeposits(std::vector<SidechainDeposit>& vDeposit)
+{
+    std::lock_guard<std::mutex> lock(depositQueueMutex);
+
+    for (const SidechainDeposit& d : bmmCache.GetDepositQueue()) {
+        if (!psidechaintree->HaveDepositNonAmount(d.GetID()))
+            vDeposit.push_back(d);
+    }
+
+    SidechainDeposit lastDeposit;
+    bool fHaveDeposits = psidechaintree->GetLastDeposit(lastDeposit);
+
+    // An empty queue only means there are no new deposits if it was synced
+    // up to the last connected deposit
+    if (vDeposit.empty()) {
+        if (!fDepositQueueSynced)
+            return false;
+
+        uint256 hashCursor;
+        uint32_t nCursorBurnIndex = 0;
+        bmmCache.GetDepositCursor(hashCursor, nCursorBurnIndex);
+        if (fHaveDeposits)
+            return hashCursor == lastDeposit.dtx->GetHash() && nCursorBurnIndex == lastDeposit.nBurnIndex;
+        return hashCursor.IsNull();
+    }
+
+    if (fHaveDeposits && !DepositSpendsCTIP(vDeposit.front(), lastDeposit)) {
+        vDeposit.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool VerifyAssumedBMMBlocks()
+{
+    // Height of the last assumed block that has been verified, the genesis
+    // block is never checked with the mainchain
+    static int nHeightVerified = 0;
+
+    const CChainParams& chainparams = Params();
+
+    // Find the assumed blocks which are currently connected
+    std::vector<const CBlockIndex*> vIndex;
+    uint256 hashAssumed;
+    bool fConnected = false;
+    {
+        LOCK(cs_main);
+        if (hashAssumeBMMValid.IsNull())
+            return true;
+
+        hashAssumed = hashAssumeBMMValid;
+
+        BlockMap::const_iterator it = mapBlockIndex.find(hashAssumed);
+        if (it == mapBlockIndex.end())
+            return false;
+
+        const CBlockIndex* pindexFork = chainActive.FindFork(it->second);
+        if (!pindexFork)
+            return false;
+
+        fConnected = pindexFork == it->second;
+
+        for (const CBlockIndex* pindex = pindexFork; pindex && pindex->nHeight > nHeightVerified; pindex = pindex->pprev)
+            vIndex.push_back(pindex);
+    }
+    std::reverse(vIndex.begin(), vIndex.end());
+
+    SidechainClient client;
+    for (const CBlockIndex* pindex : vIndex) {
+        CBlock block;
+        {
+            LOCK(cs_main);
+            if (!chainActive.Contains(pindex))
+                return false;
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                LogPrintf("%s: Cannot verify pruned block: %s\n", __func__, pindex->GetBlockHash().ToString());
+                nHeightVerified = pindex->nHeight;
+                continue;
+            }
+            if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
+                return error("%s: Failed to read block: %s", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        if (!CheckMainchainConnection())
+            return false;
+
+        CValidationState state;
+        bool fValid = CheckBlockMainchain(block, state, false /* fGenesis */);
+
+        // Verify Withdrawal Bundle status updates
+        for (const CTxOut& txout : block.vtx[0]->vout) {
+            if (!fValid)
+                break;
+
+            const CScript& scriptPubKey = txout.scriptPubKey;
+
+            uint256 hashWithdrawalBundle;
+            if (scriptPubKey.IsWithdrawalBundleFailCommit(hashWithdrawalBundle))
+                fValid = client.HaveFailedWithdrawalBundle(hashWithdrawalBundle);
+            else if (scriptPubKey.IsWithdrawalBundleSpentCommit(hashWithdrawalBundle))
+                fValid = client.HaveSpentWithdrawalBundle(hashWithdrawalBundle);
+        }
+
+        if (fValid) {
+            nHeightVerified = pindex->nHeight;
+            continue;
+        }
+
+        // Don't invalidate blocks because the mainchain went away
+        if (!CheckMainchainConnection())
+            return false;
+
+        LogPrintf("%s: Invalidating assumed block: %s which failed mainchain verification: %s\n",
+                __func__, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
+
+        CValidationState stateInvalidate;
+        {
+            LOCK(cs_main);
+            ClearAssumeBMMValid();
+            InvalidateBlock(stateInvalidate, chainparams, const_cast<CBlockIndex*>(pindex));
+        }
+        if (!stateInvalidate.IsValid()) {
+            LogPrintf("%s: Error while invalidating blocks: %s\n",
+                    __func__, FormatStateMessage(stateInvalidate));
+            return true;
+        }
+
+        ActivateBestChain(stateInvalidate, chainparams);
+        if (!stateInvalidate.IsValid()) {
+            LogPrintf("%s: Error activating best chain: %s\n",
+                    __func__, FormatStateMessage(stateInvalidate));
+        }
+        return true;
+    }
+
+    if (!fConnected)
+        return false;
+
+    {
+        LOCK(cs_main);
+        ClearAssumeBMMValid();
+    }
+
+    LogPrintf("%s: Verified mainchain data of assumed BMM block %s and its ancestors.\n", __func__, hashAssumed.ToString());
+
+    return true;
+}
+
 CScript EncodeWithdrawalFees(const CAmount& amount)
 {
     CDataStream s(SER_NETWORK, PROTOCOL_VERSION);
@@ -15,6 +15,7 @@
 #include <fs.h>
 #include <protocol.h> // For CMessageHeader::MessageStartChars
 #include <policy/feerate.h>
+#include <pubkey.h>
 #include <script/script_error.h>
 #include <sidechain.h>
 #include <sync.h>
@@ -42,6 +43,7 @@ class CInv;
 class CConnman;
 class CScriptCheck;
 class CBlockPolicyEstimator;
+class CMainchainFeeEstimator;
 class CTxMemPool;
 class CValidationState;
 struct ChainTxData;
@@ -84,6 +86,14 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of coin prefetching threads allowed */
+static const int MAX_COIN_PREFETCH_THREADS = 16;
+/** -coinprefetchthreads default (number of threads reading the coins a block spends, 0 = disabled) */
+static const int DEFAULT_COIN_PREFETCH_THREADS = 0;
+/** Minimum number of transactions in a block to check them in parallel in CheckBlock */
+static const unsigned int MIN_PARALLEL_TX_CHECKS = 64;
+/** Size in bytes of the withdrawal refund signature cache */
+static const size_t REFUND_CACHE_SIZE = 1 << 20;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -174,6 +184,7 @@ extern CConditionVariable cvBlockChange;
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
 extern int nScriptCheckThreads;
+extern int nCoinPrefetchThreads;
 extern bool fTxIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
@@ -191,6 +202,9 @@ extern bool fEnableReplacement;
 /** Block hash whose ancestors we will assume to have valid scripts without checking them. */
 extern uint256 hashAssumeValid;
 
+/** Block hash whose ancestors we will assume to have valid BMM, prev block commits and deposits until they are verified in the background. */
+extern uint256 hashAssumeBMMValid;
+
 /** Best header we've seen so far (used for getheaders queries' starting points). */
 extern CBlockIndex *pindexBestHeader;
 
@@ -228,10 +242,21 @@ static const char* const SIDECHAIN_TEST_SCRIPT_HEX = "76a914497f7d6b59281591c50b
 
 static const bool DEFAULT_VERIFY_WITHDRAWAL_BUNDLE_ACCEPT_BLOCK = true;
 
+/** Default for -depositsync, download deposits in the background for the miner */
+static const bool DEFAULT_DEPOSIT_SYNC = true;
+/** Default for -depositsyncinterval, seconds between deposit queue updates */
+static const int64_t DEFAULT_DEPOSIT_SYNC_INTERVAL = 10;
+/** Default for -mainchainconnectionttl, seconds to trust the last successful mainchain connection check */
+static const int64_t DEFAULT_MAINCHAIN_CONNECTION_TTL = 10;
+
 extern BMMCache bmmCache;
 
+/** Local estimate of mainchain fees for new withdrawals */
+extern CMainchainFeeEstimator mainchainFeeEstimator;
+
 extern std::mutex mainBlockCacheMutex;
 extern std::mutex mainBlockCacheReorgMutex;
+extern std::mutex depositQueueMutex;
 
 /**
  * Process an incoming block. This only returns after the best known valid
@@ -286,6 +311,19 @@ bool LoadChainTip(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the block transaction checking thread */
+void ThreadTxCheck();
+/** Run an instance of the withdrawal refund checking thread */
+void ThreadRefundCheck();
+/** Run an instance of the coin prefetching thread */
+void ThreadCoinPrefetch();
+/**
+ * Read the coins spent by block that are not in cache from base, the view
+ * cache is backed by, on the coin prefetch threads, and add them to cache.
+ * This turns the serial database reads of connecting a block with a cold
+ * cache into parallel ones.
+ */
+void PrefetchCoins(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& base);
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -390,6 +428,14 @@ public:
 
     bool operator()();
 
+    /**
+     * Evaluate the script with the signatures that are not cached added to
+     * batch instead of being verified. Returns false if the script fails
+     * even when they are all valid. Checks that store their signatures in
+     * the cache are evaluated normally.
+     */
+    bool operator()(CSignatureBatch& batch);
+
     void swap(CScriptCheck &check) {
         std::swap(ptxTo, check.ptxTo);
         std::swap(m_tx_out, check.m_tx_out);
@@ -403,9 +449,100 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Run a batch of script checks from the check queue, verifying all their
+ * signatures together. If that fails, each check's signatures are verified
+ * on their own, and the checks with an invalid signature are evaluated
+ * again normally to find out whether they actually fail.
+ */
+bool RunChecks(std::vector<CScriptCheck>& vChecks);
+
+/**
+ * Closure representing the context-free checks of one block transaction
+ * (CheckTransaction and legacy sigop counting) for the tx check queue.
+ * Note that this stores references to the transaction and results.
+ */
+class CTxCheck
+{
+private:
+    const CTransaction *ptx;
+    CValidationState *pstate;
+    unsigned int *pnSigOps;
+
+public:
+    CTxCheck(): ptx(nullptr), pstate(nullptr), pnSigOps(nullptr) {}
+    CTxCheck(const CTransaction& txIn, CValidationState* pstateIn, unsigned int* pnSigOpsIn) :
+        ptx(&txIn), pstate(pstateIn), pnSigOps(pnSigOpsIn) { }
+
+    bool operator()();
+
+    void swap(CTxCheck &check) {
+        std::swap(ptx, check.ptx);
+        std::swap(pstate, check.pstate);
+        std::swap(pnSigOps, check.pnSigOps);
+    }
+};
+
+/**
+ * Closure representing the read of one coin from a coins view for the coin
+ * prefetch queue. Note that this stores references to the outpoint and the
+ * coin, which is left spent if it can't be read.
+ */
+class CCoinPrefetch
+{
+private:
+    const CCoinsView *pbase;
+    const COutPoint *poutpoint;
+    Coin *pcoin;
+
+public:
+    CCoinPrefetch(): pbase(nullptr), poutpoint(nullptr), pcoin(nullptr) {}
+    CCoinPrefetch(const CCoinsView& baseIn, const COutPoint& outpointIn, Coin& coinIn) :
+        pbase(&baseIn), poutpoint(&outpointIn), pcoin(&coinIn) { }
+
+    bool operator()();
+
+    void swap(CCoinPrefetch &check) {
+        std::swap(pbase, check.pbase);
+        std::swap(poutpoint, check.poutpoint);
+        std::swap(pcoin, check.pcoin);
+    }
+};
+
+/**
+ * Closure representing the signature check of one withdrawal refund request
+ * for the refund check queue: recover the key which signed the refund message
+ * and compare it with the key of the withdrawal's refund address.
+ */
+class CRefundCheck
+{
+private:
+    uint256 id;
+    std::vector<unsigned char> vchSig;
+    CKeyID keyID;
+    bool cacheStore;
+
+public:
+    CRefundCheck(): cacheStore(false) {}
+    CRefundCheck(const uint256& idIn, const std::vector<unsigned char>& vchSigIn, const CKeyID& keyIDIn, bool cacheStoreIn) :
+        id(idIn), vchSig(vchSigIn), keyID(keyIDIn), cacheStore(cacheStoreIn) { }
+
+    bool operator()();
+
+    void swap(CRefundCheck &check) {
+        std::swap(id, check.id);
+        vchSig.swap(check.vchSig);
+        std::swap(keyID, check.keyID);
+        std::swap(cacheStore, check.cacheStore);
+    }
+};
+
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
+/** Initializes the withdrawal refund signature cache */
+void InitRefundCache();
+
 
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
@@ -425,6 +562,14 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 /** Check a block is completely valid from start to finish (only works on top of our current best block, with cs_main held) */
 bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckMerkleRoot = true, bool fChekBMM = false, bool fReorg = false);
 
+/**
+ * Check a new block template like TestBlockValidity without checking BMM.
+ * If the template only adds transactions to the last one that passed on the
+ * same tip, with the same coinbase apart from its value and witness
+ * commitment, only the added transactions are checked in full.
+ */
+bool TestBlockTemplateValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev);
+
 /** Check whether witness commitments are required for block. */
 bool IsWitnessEnabled(const CBlockIndex* pindexPrev, const Consensus::Params& params);
 
@@ -453,8 +598,13 @@ CScript GenerateWithdrawalBundleHashCommit(const uint256& hashWithdrawalBundle);
 /** Produce block version commit */
 CScript GenerateBlockVersionCommit(const int32_t nVersion);
 
-/** Verify the status of withdrawal to refund & check refund signature */
-bool VerifyWithdrawalRefundRequest(const uint256& id, const std::vector<unsigned char>& vchSig, SidechainWithdrawal& withdrawal);
+/**
+ * Verify the status of withdrawal to refund & check refund signature. If
+ * pvChecks is not nullptr the signature check is pushed onto it instead of
+ * being performed inline. Setting cacheStore to false removes a matching entry
+ * from the refund signature cache instead of adding one.
+ */
+bool VerifyWithdrawalRefundRequest(const uint256& id, const std::vector<unsigned char>& vchSig, SidechainWithdrawal& withdrawal, bool cacheStore = true, std::vector<CRefundCheck>* pvChecks = nullptr);
 
 /** RAII wrapper for VerifyDB: Verify consistency of the block and coin databases */
 class CVerifyDB {
@@ -522,6 +672,12 @@ CBlockFileInfo* GetBlockFileInfo(size_t n);
 /** Dump the mempool to disk. */
 bool DumpMempool();
 
+/**
+ * Append the transactions added since the last dump to the mempool journal,
+ * or dump the whole mempool if there was no dump yet or the journal got big.
+ */
+bool DumpMempoolIncremental();
+
 /** Load the mempool from disk. */
 bool LoadMempool();
 
@@ -543,6 +699,15 @@ void DumpWithdrawalIDCache();
 /** Read the cache of users withdrawal IDs */
 void LoadWithdrawalIDCache();
 
+/** Dump the queue of verified deposits and the mainchain deposit cursor */
+void DumpDepositQueue();
+
+/** Load the queue of verified deposits and the mainchain deposit cursor */
+void LoadDepositQueue();
+
+/** Seed the mainchain fee estimator with the withdrawal bundle outcomes in the sidechain db */
+void LoadMainchainFeeHistory();
+
 /** Create joined Withdrawal Bundle to be sent to the mainchain */
 bool CreateWithdrawalBundleTx(int nHeight, CTransactionRef& withdrawalBundleTx, CTransactionRef& withdrawalBundleDataTx, bool fReplicationCheck = false, bool fCheckUnique = false);
 
@@ -557,7 +722,10 @@ bool VerifyWithdrawalBundles(std::string& strFail, int nHeight, const std::vecto
 /** Sort deposits by CTIP spend order */
 bool SortDeposits(const std::vector<SidechainDeposit>& vDeposit, std::vector<SidechainDeposit>& vDepositSorted);
 
-/** Check for RPC connection to mainchain node */
+/**
+ * Check for RPC connection to mainchain node. A successful check is trusted
+ * for -mainchainconnectionttl seconds, failures are never cached.
+ */
 bool CheckMainchainConnection();
 
 /** Enable or disable networking and print log message */
@@ -578,6 +746,26 @@ bool VerifyMainBlockCache(std::string& strError);
 /** Disconnect blocks with a BMM commit from an orphan mainchain block */
 void HandleMainchainReorg(const std::vector<uint256>& vOrphan);
 
+/**
+ * Download deposits after the mainchain deposit cursor, verify them with the
+ * mainchain and add them to the queue of deposits waiting to be connected.
+ */
+bool UpdateDepositQueue();
+
+/**
+ * Get the queued deposits which have not been connected yet. Returns false if
+ * the queue does not continue from the last connected deposit, or is empty
+ * without having been synced up to it.
+ */
+bool GetQueuedDeposits(std::vector<SidechainDeposit>& vDeposit);
+
+/**
+ * Verify the mainchain data of blocks which were connected without it because
+ * of -assumebmmvalid. Invalidates the first block that fails to verify.
+ * Returns false if verification could not be completed.
+ */
+bool VerifyAssumedBMMBlocks();
+
 CScript EncodeWithdrawalFees(const CAmount& amount);
 
 bool DecodeWithdrawalFees(const CScript& script, CAmount& amount);
@@ -3513,6 +3513,7 @@ UniValue createwithdrawal(const JSONRPCRequest& request)
             "3. \"amount\"             (numeric or string, required) The amount in " + CURRENCY_UNIT + " to send. eg 0.1\n"
             "4. \"fee\"                (numeric or string, required) The amount in " + CURRENCY_UNIT + " to be subtracted for fees. eg 0.1\n"
             "5. \"mainchainfee\"       (numeric or string, required) The amount in " + CURRENCY_UNIT + " to be subtracted for fees on the mainchain. eg 0.1\n"
+            "                            See estimatemainchainfee for a local estimate.\n"
             "\nResult:\n"
             "\"txid\"                  (string) The transaction id.\n"
             "\nExamples:\n"